@@ -0,0 +1,32 @@
+#ifndef _HOST_H_
+#define _HOST_H_
+
+/* Machine configuration used by the host stand-ins of the emu_ API. As
+ * for the core, each thread has its own */
+typedef struct
+{
+  ComputerType_T computer;
+  int memory;
+  int sound;
+  bool ntsc;
+  bool wrx;
+  bool lowram;
+  bool m1not;
+  bool qsudg;
+  bool chr128;
+  int turbo;
+  int tracepc;              // Trace triggers, -1 for none
+  int traceaddr;
+} HostConfig_T;
+
+extern MACHINE_STATE HostConfig_T hostcfg;
+extern MACHINE_STATE uint8_t* hostKeyboard;
+extern MACHINE_STATE uint64_t hostFrameHash;
+extern MACHINE_STATE int hostFramesShown;
+extern MACHINE_STATE int hostFramesBlank;
+
+extern void hostSetFile(const char* path);
+extern void hostVideoInit(void);
+extern void hostVideoFree(void);
+
+#endif
@@ -0,0 +1,611 @@
+/* Host (Linux) build of the emulator core, to measure the speed and check
+ * the correctness of the Z80 emulation without flashing a board.
+ *
+ *   picozx81_host zex <zexdoc.com|zexall.com>
+ *       Runs a CP/M instruction exerciser and reports the speed
+ *
+ *   picozx81_host bench [-n frames] [-mem k] [-zx80] [-wrx] ... [file]
+ *       Runs frames of a ZX80/ZX81, optionally loading a program, and
+ *       reports the speed and a hash of the displayed frames
+ *
+ *   picozx81_host batch [-j threads] <jobs>
+ *       Runs each line of bench options in the jobs file on its own
+ *       machine, sharing the jobs between a pool of threads
+ *
+ *   picozx81_host flags
+ *       Runs the flag setting instructions for every operand pair and
+ *       carry, and checks the flags, which come from the flag tables,
+ *       against the arithmetic used before the tables
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "pico.h"
+#include "common.h"
+#include "emuapi.h"
+#include "zx8x.h"
+#include "z80.h"
+#include "host.h"
+
+#define ZX8X_CLOCK_MHZ 3.25
+
+static double now(void)
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void report(double secs, unsigned long long cycles, unsigned long long instructions)
+{
+  double mhz = cycles / secs / 1e6;
+
+  printf("tstates=%llu instructions=%llu time=%.3fs\n", cycles, instructions, secs);
+  printf("emulated=%.2fMHz (x%.2f) host=%.2fns/instruction\n",
+         mhz, mhz / ZX8X_CLOCK_MHZ, instructions ? (secs * 1e9) / instructions : 0.0);
+}
+
+static int zex(const char* file)
+{
+  FILE* f = fopen(file, "rb");
+  unsigned long long cycles;
+  double start;
+
+  if (!f)
+  {
+    fprintf(stderr, "Cannot open %s\n", file);
+    return 1;
+  }
+  hostVideoInit();
+  memset(mem, 0, MEMORYRAM_SIZE);
+  fread(mem + 0x100, 1, MEMORYRAM_SIZE - 0x100, f);
+  fclose(f);
+
+  start = now();
+  cycles = z80_runCPM();
+  printf("\n");
+  report(now() - start, cycles, z80_instructions);
+  return 0;
+}
+
+/* The flags of each instruction, as calculated before the flag tables.
+ * Each returns A in the high byte and the flags in the low byte */
+typedef unsigned short (*FlagRef_T)(unsigned char a, unsigned char z, unsigned char c);
+
+static unsigned char refParity(unsigned char v)
+{
+  return __builtin_parity(v) ? 0 : 4;
+}
+
+static unsigned char refSzp(unsigned char v)
+{
+  return (v & 0xa8) | ((!v) << 6) | refParity(v);
+}
+
+static unsigned short refAdd(unsigned char a, unsigned char z, unsigned char c)
+{
+  unsigned short y = a + z + c;
+  unsigned char f = (y & 0xa8) | (y >> 8) | (((a & 0x0f) + (z & 0x0f) + c > 15) << 4) |
+                    (((~a ^ z) & 0x80 & (y ^ a)) >> 5);
+
+  a = y;
+  return (a << 8) | f | ((!a) << 6);
+}
+
+static unsigned short refSub(unsigned char a, unsigned char z, unsigned char c)
+{
+  unsigned short y = (a - z - c) & 0x1ff;
+  unsigned char f = (y & 0xa8) | (y >> 8) | (((a & 0x0f) < (z & 0x0f) + c) << 4) |
+                    (((a ^ z) & 0x80 & (y ^ a)) >> 5) | 2;
+
+  a = y;
+  return (a << 8) | f | ((!a) << 6);
+}
+
+static unsigned short refAdc(unsigned char a, unsigned char z, unsigned char c) { return refAdd(a, z, c); }
+static unsigned short refAddA(unsigned char a, unsigned char z, unsigned char c) { return refAdd(a, z, 0); }
+static unsigned short refSbc(unsigned char a, unsigned char z, unsigned char c) { return refSub(a, z, c); }
+static unsigned short refSubA(unsigned char a, unsigned char z, unsigned char c) { return refSub(a, z, 0); }
+
+static unsigned short refCp(unsigned char a, unsigned char z, unsigned char c)
+{
+  unsigned short y = (a - z) & 0x1ff;
+
+  return (a << 8) | (y & 0xa8) | (y >> 8) | (((a & 0x0f) < (z & 0x0f)) << 4) |
+         (((a ^ z) & 0x80 & (y ^ a)) >> 5) | 2 | ((!y) << 6);
+}
+
+static unsigned short refAnd(unsigned char a, unsigned char z, unsigned char c) { a &= z; return (a << 8) | refSzp(a) | 0x10; }
+static unsigned short refXor(unsigned char a, unsigned char z, unsigned char c) { a ^= z; return (a << 8) | refSzp(a); }
+static unsigned short refOr(unsigned char a, unsigned char z, unsigned char c) { a |= z; return (a << 8) | refSzp(a); }
+
+static unsigned short refInc(unsigned char a, unsigned char z, unsigned char c)
+{
+  a++;
+  return (a << 8) | c | (a & 0xa8) | ((!(a & 15)) << 4) | ((!a) << 6) | ((a == 128) << 2);
+}
+
+static unsigned short refDec(unsigned char a, unsigned char z, unsigned char c)
+{
+  unsigned char f = c | ((!(a & 15)) << 4) | 2;
+
+  --a;
+  return (a << 8) | f | (a & 0xa8) | ((a == 127) << 2) | ((!a) << 6);
+}
+
+static unsigned short refRlc(unsigned char a, unsigned char z, unsigned char c) { a = (a << 1) | (a >> 7); return (a << 8) | (a & 1) | refSzp(a); }
+static unsigned short refRrc(unsigned char a, unsigned char z, unsigned char c) { unsigned char t = a & 1; a = (a >> 1) | (t << 7); return (a << 8) | t | refSzp(a); }
+static unsigned short refRl(unsigned char a, unsigned char z, unsigned char c) { unsigned char t = a >> 7; a = (a << 1) | c; return (a << 8) | t | refSzp(a); }
+static unsigned short refRr(unsigned char a, unsigned char z, unsigned char c) { unsigned char t = a & 1; a = (a >> 1) | (c << 7); return (a << 8) | t | refSzp(a); }
+static unsigned short refSla(unsigned char a, unsigned char z, unsigned char c) { unsigned char t = a >> 7; a <<= 1; return (a << 8) | t | refSzp(a); }
+static unsigned short refSra(unsigned char a, unsigned char z, unsigned char c) { unsigned char t = a & 1; a = ((signed char)a) >> 1; return (a << 8) | t | refSzp(a); }
+static unsigned short refSll(unsigned char a, unsigned char z, unsigned char c) { unsigned char t = a >> 7; a = (a << 1) | 1; return (a << 8) | t | refSzp(a); }
+static unsigned short refSrl(unsigned char a, unsigned char z, unsigned char c) { unsigned char t = a & 1; a >>= 1; return (a << 8) | t | refSzp(a); }
+
+static unsigned short refNeg(unsigned char a, unsigned char z, unsigned char c)
+{
+  a = -a;
+  return (a << 8) | (a & 0xa8) | ((!a) << 6) | (((a & 15) > 0) << 4) | ((a == 128) << 2) | 2 | (a > 0);
+}
+
+static unsigned short refLdAI(unsigned char a, unsigned char z, unsigned char c)
+{
+  a = z;
+  return (a << 8) | c | (a & 0xa8) | ((!a) << 6) | (c << 2);
+}
+
+static unsigned short refRrd(unsigned char a, unsigned char z, unsigned char c) { a = (a & 0xf0) | (z & 0x0f); return (a << 8) | c | refSzp(a); }
+static unsigned short refRld(unsigned char a, unsigned char z, unsigned char c) { a = (a & 0xf0) | (z >> 4); return (a << 8) | c | refSzp(a); }
+
+static const struct
+{
+  const char* name;
+  unsigned char code[2];
+  FlagRef_T ref;
+} flag_cases[] = {
+  { "add a,b", { 0x80 }, refAddA }, { "adc a,b", { 0x88 }, refAdc },
+  { "sub b", { 0x90 }, refSubA },   { "sbc a,b", { 0x98 }, refSbc },
+  { "and b", { 0xa0 }, refAnd },    { "xor b", { 0xa8 }, refXor },
+  { "or b", { 0xb0 }, refOr },      { "cp b", { 0xb8 }, refCp },
+  { "inc a", { 0x3c }, refInc },    { "dec a", { 0x3d }, refDec },
+  { "rlc a", { 0xcb, 0x07 }, refRlc }, { "rrc a", { 0xcb, 0x0f }, refRrc },
+  { "rl a", { 0xcb, 0x17 }, refRl },   { "rr a", { 0xcb, 0x1f }, refRr },
+  { "sla a", { 0xcb, 0x27 }, refSla }, { "sra a", { 0xcb, 0x2f }, refSra },
+  { "sll a", { 0xcb, 0x37 }, refSll }, { "srl a", { 0xcb, 0x3f }, refSrl },
+  { "neg", { 0xed, 0x44 }, refNeg },   { "ld a,i", { 0xed, 0x57 }, refLdAI },
+  { "rrd", { 0xed, 0x67 }, refRrd },   { "rld", { 0xed, 0x6f }, refRld },
+};
+
+static int flags(void)
+{
+  int failed = 0;
+
+  hostVideoInit();
+  memset(mem, 0, MEMORYRAM_SIZE);
+  z80_flatMemory();
+
+  for (size_t n = 0; n < sizeof(flag_cases) / sizeof(flag_cases[0]); ++n)
+  {
+    int bad = 0;
+
+    mem[0x100] = flag_cases[n].code[0];
+    mem[0x101] = flag_cases[n].code[1];
+    for (int x = 0; x < 256; ++x)
+    {
+      for (int y = 0; y < 256; ++y)
+      {
+        for (int carry = 0; carry < 2; ++carry)
+        {
+          unsigned short got = z80_runFlags(x, y, carry);
+          unsigned short want = flag_cases[n].ref(x, y, carry);
+
+          if ((got != want) && (bad++ < 4))
+          {
+            printf("%s a=%02x z=%02x c=%d: a=%02x f=%02x, expected a=%02x f=%02x\n",
+                   flag_cases[n].name, x, y, carry, got >> 8, got & 0xff, want >> 8, want & 0xff);
+          }
+        }
+      }
+    }
+    printf("%-8s %s\n", flag_cases[n].name, bad ? "FAIL" : "ok");
+    failed += bad;
+  }
+  return failed ? 1 : 0;
+}
+
+#ifdef Z80_BREAK
+static const char* break_names[] = { "exec", "read", "write", "in", "out" };
+
+static const char* breakName(int kind)
+{
+  for (int i = 0; i < 5; ++i)
+  {
+    if (kind == (1 << i)) return break_names[i];
+  }
+  return "-";
+}
+
+/* Sets the next breakpoint from kind:addr, e.g. exec:0x0229 */
+static void breakOption(const char* arg, int* slot)
+{
+  const char* sep = strchr(arg, ':');
+
+  for (int i = 0; sep && (i < 5); ++i)
+  {
+    if ((strlen(break_names[i]) == (size_t)(sep - arg)) && !strncmp(arg, break_names[i], sep - arg))
+    {
+      if (*slot < BREAK_MAX)
+      {
+        z80_breakSet((*slot)++, 1 << i, strtol(sep + 1, NULL, 0));
+      }
+      return;
+    }
+  }
+  fprintf(stderr, "Ignoring breakpoint %s\n", arg);
+}
+#endif
+
+/* Sets the machine configuration of this thread from bench options.
+ * Returns the file to load, or NULL */
+static const char* options(int argc, char** argv, int* frames)
+{
+  const char* file = 0;
+#ifdef Z80_BREAK
+  int slot = 0;
+#endif
+
+  for (int i = 0; i < argc; ++i)
+  {
+    if (!strcmp(argv[i], "-n") && (i + 1 < argc)) *frames = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-mem") && (i + 1 < argc)) hostcfg.memory = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-sound") && (i + 1 < argc)) hostcfg.sound = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-turbo") && (i + 1 < argc)) hostcfg.turbo = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-zx80")) hostcfg.computer = ZX80_4K;
+    else if (!strcmp(argv[i], "-zx808k")) hostcfg.computer = ZX80_8K;
+    else if (!strcmp(argv[i], "-x2")) hostcfg.computer = ZX81X2;
+    else if (!strcmp(argv[i], "-ntsc")) hostcfg.ntsc = true;
+    else if (!strcmp(argv[i], "-wrx")) hostcfg.wrx = true;
+    else if (!strcmp(argv[i], "-lowram")) hostcfg.lowram = true;
+    else if (!strcmp(argv[i], "-m1not")) hostcfg.m1not = true;
+    else if (!strcmp(argv[i], "-qsudg")) hostcfg.qsudg = true;
+    else if (!strcmp(argv[i], "-chr128")) hostcfg.chr128 = true;
+    else if (!strcmp(argv[i], "-tracepc") && (i + 1 < argc)) hostcfg.tracepc = strtol(argv[++i], NULL, 0);
+    else if (!strcmp(argv[i], "-traceaddr") && (i + 1 < argc)) hostcfg.traceaddr = strtol(argv[++i], NULL, 0);
+#ifdef Z80_BREAK
+    else if (!strcmp(argv[i], "-break") && (i + 1 < argc)) breakOption(argv[++i], &slot);
+#endif
+    else file = argv[i];
+  }
+  return file;
+}
+
+/* Starts the machine of this thread, loading file if set */
+static void start(const char* file)
+{
+  hostVideoInit();
+  if (file)
+  {
+    hostSetFile(file);
+    z8x_Start(strrchr(file, '/') ? strrchr(file, '/') + 1 : file);
+  }
+  else
+  {
+    z8x_Start(NULL);
+  }
+  z8x_Init();
+#ifdef Z80_TRACE
+  if ((hostcfg.tracepc >= 0) || (hostcfg.traceaddr >= 0))
+  {
+    z80_traceTrigger(hostcfg.tracepc, hostcfg.traceaddr);
+  }
+#endif
+}
+
+static void run(int frames)
+{
+  for (int i = 0; i < frames; ++i)
+  {
+    z8x_Step();
+#ifdef Z80_BREAK
+    BreakHit_T hit;
+
+    // Report each hit and complete the frame
+    while (z80_breakStopped(&hit))
+    {
+      printf("break %s %04x pc=%04x frame=%d tstates=%lu line=%d\n",
+             breakName(hit.kind), hit.addr, hit.instr, i, hit.tstates, hit.line);
+      z80_breakResume();
+      z8x_Step();
+    }
+#endif
+  }
+}
+
+static int bench(int argc, char** argv)
+{
+  int frames = 1000;
+  const char* file = options(argc, argv, &frames);
+  double begin;
+
+  start(file);
+  begin = now();
+  run(frames);
+  report(now() - begin, (unsigned long long)frames * tsmax, z80_instructions);
+  printf("frames=%d shown=%d blank=%d hash=%016llx\n",
+         frames, hostFramesShown, hostFramesBlank, (unsigned long long)hostFrameHash);
+#ifdef Z80_PROFILE
+  z80_profileDump();
+#endif
+#ifdef PC_PROFILE
+  z80_pcProfileDump();
+#endif
+#ifdef Z80_TRACE
+  // A triggered trace is written when complete
+  if ((hostcfg.tracepc < 0) && (hostcfg.traceaddr < 0))
+  {
+    z80_traceDump();
+  }
+#endif
+#ifdef Z80_BREAK
+  for (int i = 0; i < BREAK_MAX; ++i)
+  {
+    const Breakpoint_T* bp = z80_breakGet(i);
+
+    if (bp->kind)
+    {
+      printf("break %s %04x hits=%lu\n", breakName(bp->kind), bp->addr, bp->hits);
+    }
+  }
+#endif
+#ifdef CALC_VERIFY
+  printf("calc verified=%lu mismatched=%lu\n", calc_verified, calc_mismatched);
+#endif
+#ifdef ROM_HLE
+  for (int i = 0; i < ROM_HLE_ROUTINES; ++i)
+  {
+    printf("rom %-9s enabled=%d calls=%lu tstates=%lu", rom_hle[i].name,
+           rom_hle[i].enabled, rom_hle[i].calls, rom_hle[i].tstates);
+#ifdef ROM_HLE_VERIFY
+    printf(" verified=%lu mismatched=%lu", rom_hle[i].verified, rom_hle[i].mismatched);
+#endif
+    printf("\n");
+  }
+#endif
+  return 0;
+}
+
+/* Batch runs. Each line of the job file holds the options of one bench
+ * run. The jobs are shared out between a pool of threads. A thread takes
+ * the newest job from the back of its own queue, and when that is empty
+ * steals the oldest job from the front of the queue of another thread.
+ * The state of a machine belongs to the thread that runs it, so each job
+ * is run on a new thread, starting from the power on state */
+#define BATCH_MAX_ARGS 32
+
+typedef struct
+{
+  char* line;
+  int frames;
+  int shown;
+  int blank;
+  uint64_t hash;
+  unsigned long long instructions;
+  double secs;
+  int thread;
+} BatchJob_T;
+
+typedef struct
+{
+  pthread_t thread;
+  pthread_mutex_t lock;
+  int* jobs;                // Indices into batch_jobs
+  int head;                 // Oldest job, taken by other threads
+  int tail;                 // One past the newest job, taken by the owner
+  int id;
+  int stolen;
+} BatchQueue_T;
+
+static BatchJob_T* batch_jobs;
+static BatchQueue_T* batch_queues;
+static int batch_threads;
+
+static bool batchTake(BatchQueue_T* q, bool own, int* job)
+{
+  bool found = false;
+
+  pthread_mutex_lock(&q->lock);
+  if (q->tail > q->head)
+  {
+    *job = own ? q->jobs[--q->tail] : q->jobs[q->head++];
+    found = true;
+  }
+  pthread_mutex_unlock(&q->lock);
+  return found;
+}
+
+/* No jobs are added once the pool has started, so when every queue is
+ * empty the thread is done */
+static bool batchNext(BatchQueue_T* q, int* job)
+{
+  if (batchTake(q, true, job))
+    return true;
+
+  for (int n = 1; n < batch_threads; ++n)
+  {
+    if (batchTake(&batch_queues[(q->id + n) % batch_threads], false, job))
+    {
+      q->stolen++;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void* batchRun(void* arg)
+{
+  BatchJob_T* job = (BatchJob_T*)arg;
+  char line[1024];
+  char* argv[BATCH_MAX_ARGS];
+  char* save;
+  int argc = 0;
+  const char* file;
+  double begin;
+
+  strncpy(line, job->line, sizeof(line) - 1);
+  line[sizeof(line) - 1] = 0;
+  for (char* t = strtok_r(line, " \t", &save); t && (argc < BATCH_MAX_ARGS); t = strtok_r(NULL, " \t", &save))
+  {
+    argv[argc++] = t;
+  }
+
+  job->frames = 1000;
+  file = options(argc, argv, &job->frames);
+
+  start(file);
+  begin = now();
+  run(job->frames);
+  job->secs = now() - begin;
+
+  job->shown = hostFramesShown;
+  job->blank = hostFramesBlank;
+  job->hash = hostFrameHash;
+  job->instructions = z80_instructions;
+
+  hostVideoFree();
+  return NULL;
+}
+
+static void* batchWorker(void* arg)
+{
+  BatchQueue_T* q = (BatchQueue_T*)arg;
+  pthread_t machine;
+  int job;
+
+  while (batchNext(q, &job))
+  {
+    batch_jobs[job].thread = q->id;
+    pthread_create(&machine, NULL, batchRun, &batch_jobs[job]);
+    pthread_join(machine, NULL);
+  }
+  return NULL;
+}
+
+static int batch(int argc, char** argv)
+{
+  int threads = sysconf(_SC_NPROCESSORS_ONLN);
+  const char* name = 0;
+  char line[1024];
+  int jobs = 0;
+  int* order;
+  int stolen = 0;
+  unsigned long long cycles = 0, instructions = 0;
+  double begin;
+  FILE* f;
+
+  for (int i = 0; i < argc; ++i)
+  {
+    if (!strcmp(argv[i], "-j") && (i + 1 < argc)) threads = atoi(argv[++i]);
+    else name = argv[i];
+  }
+
+  if (!name || !(f = fopen(name, "r")))
+  {
+    fprintf(stderr, "Cannot open %s\n", name ? name : "job file");
+    return 1;
+  }
+
+  // Read the jobs, skipping blank lines and comments
+  while (fgets(line, sizeof(line), f))
+  {
+    line[strcspn(line, "\r\n")] = 0;
+    if (line[strspn(line, " \t")] && (line[0] != '#'))
+    {
+      batch_jobs = realloc(batch_jobs, (jobs + 1) * sizeof(BatchJob_T));
+      memset(&batch_jobs[jobs], 0, sizeof(BatchJob_T));
+      batch_jobs[jobs++].line = strdup(line);
+    }
+  }
+  fclose(f);
+
+  if (threads < 1) threads = 1;
+  if (threads > jobs) threads = jobs ? jobs : 1;
+  batch_threads = threads;
+
+  // Give each thread a contiguous share of the jobs
+  order = malloc((jobs + 1) * sizeof(int));
+  batch_queues = calloc(threads, sizeof(BatchQueue_T));
+  for (int i = 0; i < jobs; ++i)
+  {
+    order[i] = i;
+  }
+  for (int t = 0; t < threads; ++t)
+  {
+    BatchQueue_T* q = &batch_queues[t];
+
+    pthread_mutex_init(&q->lock, NULL);
+    q->id = t;
+    q->jobs = order;
+    q->head = (jobs * t) / threads;
+    q->tail = (jobs * (t + 1)) / threads;
+  }
+
+  // Geometry of the display is shared by all the machines
+  hostVideoInit();
+
+  begin = now();
+  for (int t = 0; t < threads; ++t)
+  {
+    pthread_create(&batch_queues[t].thread, NULL, batchWorker, &batch_queues[t]);
+  }
+  for (int t = 0; t < threads; ++t)
+  {
+    pthread_join(batch_queues[t].thread, NULL);
+    stolen += batch_queues[t].stolen;
+  }
+
+  for (int i = 0; i < jobs; ++i)
+  {
+    BatchJob_T* job = &batch_jobs[i];
+
+    printf("%s: frames=%d shown=%d blank=%d hash=%016llx time=%.3fs thread=%d\n",
+           job->line, job->frames, job->shown, job->blank,
+           (unsigned long long)job->hash, job->secs, job->thread);
+    cycles += (unsigned long long)job->frames * tsmax;
+    instructions += job->instructions;
+  }
+  printf("jobs=%d threads=%d stolen=%d\n", jobs, threads, stolen);
+  report(now() - begin, cycles, instructions);
+  return 0;
+}
+
+int main(int argc, char** argv)
+{
+  if ((argc >= 3) && !strcmp(argv[1], "zex"))
+  {
+    return zex(argv[2]);
+  }
+  else if ((argc >= 2) && !strcmp(argv[1], "bench"))
+  {
+    return bench(argc - 2, argv + 2);
+  }
+  else if ((argc >= 2) && !strcmp(argv[1], "batch"))
+  {
+    return batch(argc - 2, argv + 2);
+  }
+  else if ((argc >= 2) && !strcmp(argv[1], "flags"))
+  {
+    return flags();
+  }
+
+  fprintf(stderr, "usage: %s zex <file.com>\n", argv[0]);
+  fprintf(stderr, "       %s bench [-n frames] [-mem k] [-sound n] [-turbo n]\n", argv[0]);
+  fprintf(stderr, "             [-zx80|-zx808k|-x2] [-ntsc] [-wrx] [-lowram] [-m1not] [-qsudg] [-chr128]\n");
+  fprintf(stderr, "             [-tracepc addr] [-traceaddr addr] [-break kind:addr] [file]\n");
+  fprintf(stderr, "       %s batch [-j threads] <jobs>\n", argv[0]);
+  fprintf(stderr, "       %s flags\n", argv[0]);
+  return 1;
+}
@@ -0,0 +1,222 @@
+/* Stand-ins for the pico specific parts of the emulator (display, sound,
+ * files and configuration), so that src/z80.c and src/zx8x.c can be
+ * built and run on a Linux host */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "pico.h"
+#include "common.h"
+#include "emuapi.h"
+#include "emuvideo.h"
+#include "display.h"
+#include "loadp.h"
+#include "host.h"
+
+Display_T disp;
+MACHINE_STATE HostConfig_T hostcfg = { ZX81, 16, SOUND_TYPE_NONE, false, false, false, false, false, false, 1, -1, -1 };
+MACHINE_STATE uint8_t* hostKeyboard = 0;
+MACHINE_STATE uint64_t hostFrameHash = 1469598103934665603ULL;
+MACHINE_STATE int hostFramesShown = 0;
+MACHINE_STATE int hostFramesBlank = 0;
+
+static MACHINE_STATE char dir[256] = "";
+static MACHINE_STATE char fname[256] = "";
+static MACHINE_STATE FILE* fp = 0;
+static MACHINE_STATE uint8_t* bufs[4];
+static MACHINE_STATE uint8_t* cbufs[4];
+static MACHINE_STATE int nextbuf = 0;
+
+void hostSetFile(const char* path)
+{
+  const char* s = strrchr(path, '/');
+
+  if (s)
+  {
+    memcpy(dir, path, s - path + 1);
+    dir[s - path + 1] = 0;
+    strcpy(fname, s + 1);
+  }
+  else
+  {
+    dir[0] = 0;
+    strcpy(fname, path);
+  }
+}
+
+/* 320x240 display, as for the default pico configuration. The display
+ * geometry is shared, so is set by the first call, before any threads are
+ * started. Each thread has its own frame buffers */
+void hostVideoInit(void)
+{
+  if (!disp.width)
+  {
+    disp.width = 320;
+    disp.height = 240;
+    disp.stride_bit = (1 + (disp.width >> 3)) << 3;
+    disp.start_x = 46;
+    disp.start_y = 24;
+    disp.adjust_x = 4;
+    disp.stride_byte = disp.stride_bit >> 3;
+    disp.end_x = disp.start_x + disp.width;
+    disp.end_y = disp.height + disp.start_y;
+    disp.offset = -(disp.stride_bit * disp.start_y) - disp.start_x;
+    disp.padding = (disp.stride_bit - disp.width) >> 3;
+    disp.length = disp.stride_byte * disp.height;
+  }
+
+  for (int i = 0; (i < 4) && !bufs[i]; ++i)
+  {
+    bufs[i] = (uint8_t*)calloc(1, 1 + disp.length) + 1;
+    cbufs[i] = (uint8_t*)calloc(1, 1 + disp.length) + 1;
+  }
+}
+
+/* Frees the frame buffers of this thread */
+void hostVideoFree(void)
+{
+  for (int i = 0; (i < 4) && bufs[i]; ++i)
+  {
+    free(bufs[i] - 1);
+    free(cbufs[i] - 1);
+    bufs[i] = cbufs[i] = 0;
+  }
+}
+
+/* FNV-1a of every displayed frame, to compare builds */
+static void hashBuffer(const uint8_t* p, int n)
+{
+  for (int i = 0; i < n; ++i)
+  {
+    hostFrameHash ^= p[i];
+    hostFrameHash *= 1099511628211ULL;
+  }
+}
+
+void displayGetFreeBuffer(uint8_t** buff)
+{
+  *buff = bufs[nextbuf];
+  nextbuf = (nextbuf + 1) & 3;
+}
+
+void displayBuffer(uint8_t* buff, bool sync, bool free, bool chroma)
+{
+  (void)sync;
+  (void)free;
+
+  hostFramesShown++;
+  hashBuffer(buff, disp.length);
+
+  if (chroma)
+  {
+    for (int i = 0; i < 4; ++i)
+    {
+      if (bufs[i] == buff) hashBuffer(cbufs[i], disp.length);
+    }
+  }
+}
+
+void displayGetChromaBuffer(uint8_t** chroma, uint8_t* buff)
+{
+  for (int i = 0; i < 4; ++i)
+  {
+    if (bufs[i] == buff) *chroma = cbufs[i];
+  }
+}
+
+void displayResetChroma(void) {}
+void displayBlank(bool black) { (void)black; hostFramesBlank++; }
+bool displayShowKeyboard(bool zx81) { (void)zx81; return false; }
+bool displayHideKeyboard(void) { return false; }
+void displaySetInterlace(bool on) { (void)on; }
+
+/* Files */
+bool emu_FileOpen(const char* filepath, const char* mode)
+{
+  fp = fopen(filepath, (mode[0] == 'w') ? "wb" : "rb");
+  return fp != 0;
+}
+
+int emu_FileRead(void* buf, int size, int offset)
+{
+  fseek(fp, offset, SEEK_SET);
+  return fread(buf, 1, size, fp);
+}
+
+void emu_FileClose(void)
+{
+  if (fp) fclose(fp);
+  fp = 0;
+}
+
+unsigned int emu_FileSize(const char* filepath)
+{
+  FILE* f = fopen(filepath, "rb");
+  long size;
+
+  if (!f) return 0;
+  fseek(f, 0, SEEK_END);
+  size = ftell(f);
+  fclose(f);
+  return size;
+}
+
+bool emu_EndsWith(const char* s, const char* suffix)
+{
+  size_t ls = strlen(s);
+  size_t lsuffix = strlen(suffix);
+
+  return (ls >= lsuffix) && !strcasecmp(s + ls - lsuffix, suffix);
+}
+
+bool emu_SaveFile(const char* filepath, void* buf, int size) { (void)filepath; (void)buf; (void)size; return true; }
+int emu_FileReadBytes(void* buf, unsigned int size) { return fread(buf, 1, size, fp) == size; }
+int emu_FileWriteBytes(const void* buf, unsigned int size) { return fp ? (fwrite(buf, 1, size, fp) == size) : 1; }
+bool emu_loadSnapshotSpecific(const char* a, const char* b) { (void)a; (void)b; return false; }
+bool emu_loadSnapshotData(const char* a) { (void)a; return false; }
+const char* emu_GetDirectory(void) { return dir; }
+const char* emu_GetFileName(void) { return fname; }
+void emu_SetFileName(const char* name) { (void)name; }
+void emu_SetDirectory(const char* d) { (void)d; }
+void emu_ReadSpecificValues(const char* f) { (void)f; }
+
+/* Configuration */
+int emu_MemoryRequested(void) { return (hostcfg.qsudg && hostcfg.memory > 16) ? 16 : hostcfg.memory; }
+bool emu_ZX80Requested(void) { return (hostcfg.computer == ZX80_4K) || (hostcfg.computer == ZX80_8K); }
+bool emu_ROM4KRequested(void) { return hostcfg.computer == ZX80_4K; }
+ComputerType_T emu_ComputerRequested(void) { return hostcfg.computer; }
+bool emu_M1NOTRequested(void) { return hostcfg.m1not && (hostcfg.memory >= 32) && !hostcfg.qsudg; }
+bool emu_LowRAMRequested(void) { return hostcfg.lowram || hostcfg.chr128; }
+bool emu_QSUDGRequested(void) { return hostcfg.qsudg && !hostcfg.chr128; }
+bool emu_WRXRequested(void) { return (hostcfg.wrx || (hostcfg.memory <= 2)) && !hostcfg.chr128; }
+bool emu_CHR128Requested(void) { return hostcfg.chr128; }
+bool emu_NTSCRequested(void) { return hostcfg.ntsc; }
+int emu_SoundRequested(void) { return hostcfg.sound; }
+bool emu_ExtendFileRequested(void) { return false; }
+bool emu_loadUsingROMRequested(void) { return false; }
+bool emu_saveUsingROMRequested(void) { return false; }
+uint16_t emu_VTol(void) { return VTOL; }
+int emu_TurboRequested(void) { return hostcfg.turbo; }
+int emu_CentreX(void) { return disp.adjust_x + (zx80 ? 6 : 0); }
+int emu_CentreY(void) { return hostcfg.ntsc ? 16 : -8; }
+bool emu_ResetNeeded(void) { return false; }
+FrameSync_T emu_FrameSyncRequested(void) { return SYNC_OFF; }
+bool emu_chromaSupported(void) { return true; }
+void emu_SetRom4K(bool rom4k) { if (rom4k) hostcfg.computer = ZX80_4K; }
+void emu_VideoSetInterlace(void) {}
+
+/* Keyboard and sound */
+void emu_KeyboardInitialise(uint8_t* keyboard) { hostKeyboard = keyboard; }
+void emu_JoystickInitialiseNinePin(void) {}
+void emu_sndInit(bool playSound, bool reset) { (void)playSound; (void)reset; }
+void emu_sndGenerateSamples(void) {}
+void emu_sndSilence(void) {}
+void emu_sndQueueChange(bool playSound, int type) { (void)playSound; (void)type; }
+void sound_ay_write(int reg, int val) { (void)reg; (void)val; }
+void sound_beeper(int on) { (void)on; }
+
+/* Loading and saving through the menus */
+bool loadPInitialise(char* fullpath, int filename, bool ROM4k) { (void)fullpath; (void)filename; (void)ROM4k; return false; }
+int loadPGetBit(void) { return 0; }
+bool loadMenu(void) { return false; }
+bool saveMenu(char* name, uint length, bool zx80) { (void)name; (void)length; (void)zx80; return false; }
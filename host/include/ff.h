@@ -0,0 +1,5 @@
+/* Stand-in for the FatFs header, for the host build */
+#ifndef _FF_H
+#define _FF_H
+typedef int FIL;
+#endif
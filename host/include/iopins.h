@@ -0,0 +1 @@
+/* Stand-in for the board pin definitions, for the host build */
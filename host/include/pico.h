@@ -0,0 +1,17 @@
+/* Stand-in for the pico SDK header, for the host build of the emulator
+ * core. Code placement attributes have no meaning on the host */
+#ifndef _PICO_H
+#define _PICO_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define __not_in_flash_func(f) f
+#define __in_flash(...)
+#define __scratch_x(n)
+#define __scratch_y(n)
+#define __force_inline inline __attribute__((always_inline))
+
+typedef unsigned int uint;
+#endif
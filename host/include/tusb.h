@@ -0,0 +1,12 @@
+/* Stand-in for the TinyUSB header, for the host build */
+#ifndef _TUSB_H_
+#define _TUSB_H_
+#include <stdint.h>
+
+typedef struct
+{
+  uint8_t modifier;
+  uint8_t reserved;
+  uint8_t keycode[6];
+} hid_keyboard_report_t;
+#endif
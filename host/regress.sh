@@ -0,0 +1,147 @@
+#!/bin/sh
+# Runs the example programs on the host build of the core and compares the
+# hash of the displayed frames with the value expected. The skipping of
+# HALT waits and idle loops must not change what is displayed, so a change
+# to the core that alters any frame fails here.
+#
+# usage: regress.sh <picozx81_host>
+#
+# Run by ctest. After a change that is meant to alter the display, the
+# hashes to use are the ones reported for each failing case
+
+host=$1
+top=$(cd "$(dirname "$0")/.." && pwd)
+ex=$top/examples
+failed=0
+
+check()
+{
+  expect=$1
+  shift
+  got=$("$host" bench "$@" | sed -n 's/.*hash=\([0-9a-f]*\).*/\1/p')
+
+  if [ "$got" = "$expect" ]
+  then
+    echo "ok   $*"
+  else
+    echo "FAIL $* hash=$got expected=$expect"
+    failed=1
+  fi
+}
+
+# The tstates taken by a CP/M program, run with zex
+checkTstates()
+{
+  expect=$1
+  got=$("$host" zex "$2" | sed -n 's/.*tstates=\([0-9]*\).*/\1/p')
+
+  if [ "$got" = "$expect" ]
+  then
+    echo "ok   zex $2"
+  else
+    echo "FAIL zex $2 tstates=$got expected=$expect"
+    failed=1
+  fi
+}
+
+# ZX81
+check 11d39f4c45b0f5a8 -n 300
+check bb543464fa12f519 -n 400 "$ex/ZX81/simple.p"
+check 2837e4ebae29cee3 -n 800 "$ex/ZX81/eel.p"
+check 1df8ac4791a52eef -n 400 "$ex/ZX81/flicker.p"
+check 114983d2622fa201 -n 400 -mem 1 "$ex/ZX81/1K/simple.p"
+check 58abfb10942d938c -n 400 -ntsc "$ex/ZX81/NTSC/simple.p"
+check 245198898c30af83 -n 400 -qsudg -sound 1 "$ex/ZX81/UDG/simple.p"
+check fa436beffd5fd5cd -n 400 -wrx -mem 32 "$ex/ZX81/WRX/simple.p"
+check f376cf8b67c07c9a -n 600 -wrx "$ex/ZX81/Demos/head.p"
+check 37b9b3b32c2bc5f7 -n 400 -wrx -lowram "$ex/ZX81/LowRAM/simple.p"
+check 4e4b7225d1fdab87 -n 400 -x2 "$ex/ZX81X2/simple.p"
+
+# Memory maps. The programs in tests are examples/ZX81/simple.p with two
+# lines added in front, 1 REM <code> and 2 RAND USR 16514, run first.
+#
+# himem.p copies this to 0x8000 and calls it. With M1NOT it runs and puts
+# a black square on line 10 of the screen. Without M1NOT the bytes with
+# bit 6 clear are display bytes, so are run as NOPs
+#   ld hl,(D_FILE)
+#   ld de,331
+#   add hl,de
+#   ld (hl),0x80
+#   ret
+#
+# lowchr.p copies the inverse of the ROM character set to 0x2000 and sets
+# I to 0x20. With LowRAM the text is shown inverted, without it every
+# display byte is black
+check b580b62aa6e2182f -n 400 -mem 32 "$top/host/tests/himem.p"
+check 5fe0ee6e2a3c4dcb -n 400 -mem 32 -m1not "$top/host/tests/himem.p"
+check 5fe0ee6e2a3c4dcb -n 400 -mem 48 -m1not "$top/host/tests/himem.p"
+check bf8a6589f2a969b5 -n 400 -lowram "$top/host/tests/lowchr.p"
+check 1899eadabce831c3 -n 400 "$top/host/tests/lowchr.p"
+check e47c22cd5e1e48c3 -n 400 -wrx -lowram "$top/host/tests/lowchr.p"
+
+# Native ROM code, with CALC_HLE. calc.p works out a sum of the maths
+# functions in FAST mode, then shows it in SLOW mode, so the frames about
+# the switch are compared too. ctest also runs it with CALC_VERIFY
+check 64529dfa4eae3c2c -n 400 "$top/host/tests/calc.p"
+check 0a89fd4ba738439c -n 400 -turbo 2 "$top/host/tests/calc.p"
+
+# rom.p runs the routines of ROM_HLE. Its line 1 calls DECODE for each
+# key code that ends the scan, then makes and reclaims room at E_LINE
+#   ld b,0
+# outer:
+#   ld c,0
+# inner:
+#   push bc
+#   call DECODE
+#   pop bc
+#   inc c
+#   ld a,c
+#   inc a
+#   jr nz,inner
+#   inc b
+#   ld a,b
+#   cp 0xfe
+#   jr nz,outer
+#   ld a,32
+# room:
+#   push af
+#   ld c,a
+#   ld b,0
+#   ld hl,(E_LINE)
+#   dec hl
+#   push hl
+#   push bc
+#   call MAKE-ROOM
+#   pop bc
+#   pop de
+#   ld h,d
+#   ld l,e
+#   add hl,bc
+#   call RECLAIM-1
+#   pop af
+#   dec a
+#   jr nz,room
+#   ret
+# and the BASIC after it uses DIM, string slices, GOSUB, PRINT and CLS in
+# FAST mode, then shows the results in SLOW mode. ctest also runs it with
+# ROM_HLE_VERIFY
+check 33a9bbd2316e2bff -n 400 "$top/host/tests/rom.p"
+
+# Idle loops. spin.com counts to 256 in RAM, with the same registers at
+# each backward jump, so no pass can be skipped
+#   di
+#   ld hl,count
+# loop:
+#   ld a,(hl)
+#   inc a
+#   ld (hl),a
+#   jr z,done
+#   xor a
+#   jr loop
+checkTstates 10553 "$top/host/tests/spin.com"
+
+# ZX80
+check 41749e4bfcaf4073 -n 400 -zx80 "$ex/ZX80-4K/simple.o"
+check d56a1fac7cc9af4a -n 300 -zx808k
+
+exit $failed
@@ -0,0 +1,36 @@
+#!/bin/sh
+# Runs a program on a host build with CALC_VERIFY or ROM_HLE_VERIFY, in
+# which each native run of a ROM routine is repeated by the ROM from the
+# same state and compared. Fails if any run differs, if a routine enabled
+# was never run, or if the hash of the displayed frames is not the one
+# the ROM alone gives.
+#
+# usage: verify.sh <picozx81_host> <hash> <bench options> <file>
+#
+# Run by ctest
+
+host=$1
+expect=$2
+shift 2
+out=$("$host" bench "$@")
+echo "$out"
+
+got=$(echo "$out" | sed -n 's/.*hash=\([0-9a-f]*\).*/\1/p')
+if [ "$got" != "$expect" ]
+then
+  echo "FAIL hash=$got expected=$expect"
+  exit 1
+fi
+
+if echo "$out" | grep -q "mismatched=[1-9]"
+then
+  echo "FAIL native and ROM runs differ"
+  exit 1
+fi
+
+if echo "$out" | grep -q "enabled=1 .*verified=0 " ||
+   ! echo "$out" | grep -q "verified=[1-9]"
+then
+  echo "FAIL native routine not run"
+  exit 1
+fi
@@ -0,0 +1,1175 @@
+/* Native execution of the ZX81 ROM floating point calculator (RST 28h).
+ *
+ * The calculator interprets a string of literals, one byte each, through
+ * the dispatch at RE-ENTRY (0x19A7). BASIC programs spend most of their
+ * time there. The dispatch and the routines of the common literals are
+ * written out below, using the instruction macros of hleops.h.
+ *
+ * The trap is the LD (STKEND),DE at RE-ENTRY, so it is in edops.h. A
+ * literal that is not written out here hands back to the ROM at its
+ * routine. Nested calculator calls (e.g. from the series generator) come
+ * back through RE-ENTRY and are caught again.
+ *
+ * A literal is only run here if it is sure to end within the frame, so
+ * that the frame ends at the same instruction as without the trap.
+ * Otherwise it is left to the ROM.
+ *
+ * With CALC_VERIFY each literal is also run by the ROM, and the registers,
+ * tstates and the memory around the stacks, the sysvars and MEM compared.
+ *
+ * Included by hleops.h */
+
+/* More tstates than any literal takes. The longest is division, at up to
+ * about 7700 */
+#define CALC_LITERAL_TSTATES  8192
+
+/* 19EB TEST-5-SP */
+static bool calcTest5Sp(void)
+{
+  push1(d, e); cost(11);                            // push de
+  push1(h, l); cost(11);                            // push hl
+  b = 0; c = 5; cost(10);                           // ld bc,0005
+  ccall(0x19f3, hleTestRoom());                     // call TEST-ROOM
+  pop1(h, l); cost(10);                             // pop hl
+  pop1(d, e); cost(10);                             // pop de
+  cret();
+}
+
+/* 19F6 MOVE-FP, duplicate */
+static bool calcMoveFp(void)
+{
+  ccall(0x19f9, calcTest5Sp());                     // call TEST-5-SP
+  cblock(hleLdir(0x19f9));                          // ldir
+  cret();
+}
+
+/* 19FE STK-CONST, stack the compressed number at (HL) */
+static bool calcStkConst(void)
+{
+  ccall(0x1a01, calcTest5Sp());                     // call TEST-5-SP
+  exx(); cost(4);                                   // exx
+  push1(h, l); cost(11);                            // push hl
+  exx(); cost(4);                                   // exx
+  exsphl(); cost(19);                               // ex (sp),hl
+  push1(b, c); cost(11);                            // push bc
+  a = fetch(hl); cost(7);                           // ld a,(hl)
+  anda(0xc0); cost(7);                              // and c0
+  rlca(); cost(4);                                  // rlca
+  rlca(); cost(4);                                  // rlca
+  c = a; cost(4);                                   // ld c,a
+  inc(c); cost(4);                                  // inc c
+  a = fetch(hl); cost(7);                           // ld a,(hl)
+  anda(0x3f); cost(7);                              // and 3f
+  if (!cjr(!zf))                                    // jr nz,FORM-EXP
+  {
+    inchl(); cost(6);                               // inc hl
+    a = fetch(hl); cost(7);                         // ld a,(hl)
+  }
+  adda(0x50, 0); cost(7);                           // add a,50
+  store(de, a); cost(7);                            // ld (de),a
+  a = 5; cost(7);                                   // ld a,05
+  suba(c, 0); cost(4);                              // sub c
+  inchl(); cost(6);                                 // inc hl
+  incde(); cost(6);                                 // inc de
+  b = 0; cost(7);                                   // ld b,00
+  cblock(hleLdir(0x1a1e));                          // ldir
+  pop1(b, c); cost(10);                             // pop bc
+  exsphl(); cost(19);                               // ex (sp),hl
+  exx(); cost(4);                                   // exx
+  pop1(h, l); cost(10);                             // pop hl
+  exx(); cost(4);                                   // exx
+  b = a; cost(4);                                   // ld b,a
+  xora(a); cost(4);                                 // xor a
+  for (;;)
+  {
+    dec(b); cost(4);                                // dec b
+    cretif(zf);                                     // ret z
+    store(de, a); cost(7);                          // ld (de),a
+    incde(); cost(6);                               // inc de
+    cost(12);                                       // jr STK-ZEROS
+  }
+}
+
+/* 19FC stk-data */
+static bool calcStkData(void)
+{
+  h = d; cost(4);                                   // ld h,d
+  l = e; cost(4);                                   // ld l,e
+  return calcStkConst();
+}
+
+/* 1A2D SKIP-CONS, skip A constants at (HL') */
+static bool calcSkipCons(void)
+{
+  anda(a); cost(4);                                 // and a
+  for (;;)
+  {
+    cretif(zf);                                     // ret z
+    push1(a, getf()); cost(11);                     // push af
+    push1(d, e); cost(11);                          // push de
+    d = e = 0; cost(10);                            // ld de,0000
+    ccall(0x1a37, calcStkConst());                  // call STK-CONST
+    pop1(d, e); cost(10);                           // pop de
+    pop1(a, f); lazyf = LAZY_NONE; cost(10);        // pop af
+    dec(a); cost(4);                                // dec a
+    cost(12);                                       // jr SKIP-NEXT
+  }
+}
+
+/* 1A3C LOC-MEM, HL = HL + 5 * A */
+static bool calcLocMem(void)
+{
+  c = a; cost(4);                                   // ld c,a
+  rlca(); cost(4);                                  // rlca
+  rlca(); cost(4);                                  // rlca
+  adda(c, 0); cost(4);                              // add a,c
+  c = a; cost(4);                                   // ld c,a
+  b = 0; cost(7);                                   // ld b,00
+  addhl(b, c); cost(11);                            // add hl,bc
+  cret();
+}
+
+/* 1A45 get-mem-xx */
+static bool calcGetMem(void)
+{
+  push1(d, e); cost(11);                            // push de
+  h = fetch(0x4020); l = fetch(0x401f); cost(16);   // ld hl,(MEM)
+  ccall(0x1a4c, calcLocMem());                      // call LOC-MEM
+  ccall(0x1a4f, calcMoveFp());                      // call MOVE-FP
+  pop1(h, l); cost(10);                             // pop hl
+  cret();
+}
+
+/* 1A51 stk-const-xx */
+static bool calcStkConstXx(void)
+{
+  h = d; cost(4);                                   // ld h,d
+  l = e; cost(4);                                   // ld l,e
+  exx(); cost(4);                                   // exx
+  push1(h, l); cost(11);                            // push hl
+  h = 0x19; l = 0x15; cost(10);                     // ld hl,1915
+  exx(); cost(4);                                   // exx
+  ccall(0x1a5c, calcSkipCons());                    // call SKIP-CONS
+  ccall(0x1a5f, calcStkConst());                    // call STK-CONST
+  exx(); cost(4);                                   // exx
+  pop1(h, l); cost(10);                             // pop hl
+  exx(); cost(4);                                   // exx
+  cret();
+}
+
+/* 1A63 st-mem-xx */
+static bool calcStMem(void)
+{
+  push1(h, l); cost(11);                            // push hl
+  exdehl(); cost(4);                                // ex de,hl
+  h = fetch(0x4020); l = fetch(0x401f); cost(16);   // ld hl,(MEM)
+  ccall(0x1a6b, calcLocMem());                      // call LOC-MEM
+  exdehl(); cost(4);                                // ex de,hl
+  ccall(0x1a6f, calcMoveFp());                      // call MOVE-FP
+  exdehl(); cost(4);                                // ex de,hl
+  pop1(h, l); cost(10);                             // pop hl
+  cret();
+}
+
+/* 1A72 exchange */
+static bool calcExchange(void)
+{
+  b = 5; cost(7);                                   // ld b,05
+  do
+  {
+    a = fetch(de); cost(7);                         // ld a,(de)
+    c = fetch(hl); cost(7);                         // ld c,(hl)
+    exdehl(); cost(4);                              // ex de,hl
+    store(de, a); cost(7);                          // ld (de),a
+    store(hl, c); cost(7);                          // ld (hl),c
+    inchl(); cost(6);                               // inc hl
+    incde(); cost(6);                               // inc de
+  } while (cdjnz());                                // djnz SWAP-BYTE
+  exdehl(); cost(4);                                // ex de,hl
+  cret();
+}
+
+/* 1AA0 negate */
+static bool calcNegate(void)
+{
+  a = fetch(hl); cost(7);                           // ld a,(hl)
+  anda(a); cost(4);                                 // and a
+  cretif(zf);                                       // ret z
+  inchl(); cost(6);                                 // inc hl
+  a = fetch(hl); cost(7);                           // ld a,(hl)
+  xora(0x80); cost(7);                              // xor 80
+  store(hl, a); cost(7);                            // ld (hl),a
+  dechl(); cost(6);                                 // dec hl
+  cret();
+}
+
+/* 1AAA abs */
+static bool calcAbs(void)
+{
+  inchl(); cost(6);                                 // inc hl
+  resm(7); cost2(15);                               // res 7,(hl)
+  dechl(); cost(6);                                 // dec hl
+  cret();
+}
+
+/* 1AE0 FP-0/1, zero, or one if carry is set */
+static bool calcFp01(void)
+{
+  push1(h, l); cost(11);                            // push hl
+  b = 5; cost(7);                                   // ld b,05
+  do
+  {
+    store(hl, 0); cost(10);                         // ld (hl),00
+    inchl(); cost(6);                               // inc hl
+  } while (cdjnz());                                // djnz FP-loop
+  pop1(h, l); cost(10);                             // pop hl
+  cretif(!cy);                                      // ret nc
+  store(hl, 0x81); cost(10);                        // ld (hl),81
+  cret();
+}
+
+/* 1AAF sgn */
+static bool calcSgn(void)
+{
+  inchl(); cost(6);                                 // inc hl
+  a = fetch(hl); cost(7);                           // ld a,(hl)
+  dechl(); cost(6);                                 // dec hl
+  decm(); cost(11);                                 // dec (hl)
+  incm(); cost(11);                                 // inc (hl)
+  scf(); cost(4);                                   // scf
+  ccallif(!zf, 0x1ab8, calcFp01());                 // call nz,FP-0/1
+  inchl(); cost(6);                                 // inc hl
+  rlca(); cost(4);                                  // rlca
+  rrm(); cost2(15);                                 // rr (hl)
+  dechl(); cost(6);                                 // dec hl
+  cret();
+}
+
+/* 1ADC SIGN-TO-C, then FP-0/1 */
+static bool calcSignToC(void)
+{
+  inchl(); cost(6);                                 // inc hl
+  xora(fetch(hl)); cost(7);                         // xor (hl)
+  dechl(); cost(6);                                 // dec hl
+  rlca(); cost(4);                                  // rlca
+  return calcFp01();
+}
+
+/* 1ACE greater-0 */
+static bool calcGreater0(void)
+{
+  a = fetch(hl); cost(7);                           // ld a,(hl)
+  anda(a); cost(4);                                 // and a
+  cretif(zf);                                       // ret z
+  a = 0xff; cost(7);                                // ld a,ff
+  cost(12);                                         // jr SIGN-TO-C
+  return calcSignToC();
+}
+
+/* 1AD5 not */
+static bool calcNot(void)
+{
+  a = fetch(hl); cost(7);                           // ld a,(hl)
+  neg; cost2(8);                                    // neg
+  ccf(); cost(4);                                   // ccf
+  cost(12);                                         // jr FP-0/1
+  return calcFp01();
+}
+
+/* 1ADB less-0 */
+static bool calcLess0(void)
+{
+  xora(a); cost(4);                                 // xor a
+  return calcSignToC();
+}
+
+/* 1AED or */
+static bool calcOr(void)
+{
+  a = fetch(de); cost(7);                           // ld a,(de)
+  anda(a); cost(4);                                 // and a
+  cretif(zf);                                       // ret z
+  scf(); cost(4);                                   // scf
+  cost(12);                                         // jr FP-0/1
+  return calcFp01();
+}
+
+/* 1AF3 no-&-no */
+static bool calcNoAndNo(void)
+{
+  a = fetch(de); cost(7);                           // ld a,(de)
+  anda(a); cost(4);                                 // and a
+  cretif(!zf);                                      // ret nz
+  cost(12);                                         // jr FP-0/1
+  return calcFp01();
+}
+
+/* 1AF8 str-&-no */
+static bool calcStrAndNo(void)
+{
+  a = fetch(de); cost(7);                           // ld a,(de)
+  anda(a); cost(4);                                 // and a
+  cretif(!zf);                                      // ret nz
+  push1(d, e); cost(11);                            // push de
+  decde(); cost(6);                                 // dec de
+  xora(a); cost(4);                                 // xor a
+  store(de, a); cost(7);                            // ld (de),a
+  decde(); cost(6);                                 // dec de
+  store(de, a); cost(7);                            // ld (de),a
+  pop1(d, e); cost(10);                             // pop de
+  cret();
+}
+
+/* 1C23 jump, and 1C24 JUMP-2 from dec-jr-nz */
+static bool calcJump2(void)
+{
+  e = fetch(hl); cost(7);                           // ld e,(hl)
+  xora(a); cost(4);                                 // xor a
+  bit(7, e); cost2(8);                              // bit 7,e
+  if (!cjr(zf))                                     // jr z,JUMP-3
+  {
+    cpl(); cost(4);                                 // cpl
+  }
+  d = a; cost(4);                                   // ld d,a
+  addhl(d, e); cost(11);                            // add hl,de
+  exx(); cost(4);                                   // exx
+  cret();
+}
+
+static bool calcJump(void)
+{
+  exx(); cost(4);                                   // exx
+  return calcJump2();
+}
+
+/* 1C2F jump-true */
+static bool calcJumpTrue(void)
+{
+  a = fetch(de); cost(7);                           // ld a,(de)
+  anda(a); cost(4);                                 // and a
+  if (cjr(!zf))                                     // jr nz,jump
+    return calcJump();
+  exx(); cost(4);                                   // exx
+  inchl(); cost(6);                                 // inc hl
+  exx(); cost(4);                                   // exx
+  cret();
+}
+
+/* 1C17 dec-jr-nz */
+static bool calcDecJrNz(void)
+{
+  exx(); cost(4);                                   // exx
+  push1(h, l); cost(11);                            // push hl
+  h = 0x40; l = 0x1e; cost(10);                     // ld hl,BREG
+  decm(); cost(11);                                 // dec (hl)
+  pop1(h, l); cost(10);                             // pop hl
+  if (cjr(!zf))                                     // jr nz,JUMP-2
+    return calcJump2();
+  inchl(); cost(6);                                 // inc hl
+  exx(); cost(4);                                   // exx
+  cret();
+}
+
+/* 18E4 truncate */
+static bool calcTruncate(void)
+{
+  a = fetch(hl); cost(7);                           // ld a,(hl)
+  cpa(0x81); cost(7);                               // cp 81
+  if (!cjr(!cy))                                    // jr nc,T-GR-ZERO
+  {
+    store(hl, 0); cost(10);                         // ld (hl),00
+    a = 0x20; cost(7);                              // ld a,20
+    cost(12);                                       // jr NIL-BYTES
+  }
+  else
+  {
+    suba(0xa0, 0); cost(7);                         // sub a0
+    cretif(!sf);                                    // ret p
+    neg; cost2(8);                                  // neg
+  }
+  push1(d, e); cost(11);                            // push de
+  exdehl(); cost(4);                                // ex de,hl
+  dechl(); cost(6);                                 // dec hl
+  b = a; cost(4);                                   // ld b,a
+  srl(b); cost2(8);                                 // srl b
+  srl(b); cost2(8);                                 // srl b
+  srl(b); cost2(8);                                 // srl b
+  if (!cjr(zf))                                     // jr z,BITS-ZERO
+  {
+    do
+    {
+      store(hl, 0); cost(10);                       // ld (hl),00
+      dechl(); cost(6);                             // dec hl
+    } while (cdjnz());                              // djnz BYTE-ZERO
+  }
+  anda(0x07); cost(7);                              // and 07
+  if (!cjr(zf))                                     // jr z,IX-END
+  {
+    b = a; cost(4);                                 // ld b,a
+    a = 0xff; cost(7);                              // ld a,ff
+    do
+    {
+      sla(a); cost2(8);                             // sla a
+    } while (cdjnz());                              // djnz LESS-MASK
+    anda(fetch(hl)); cost(7);                       // and (hl)
+    store(hl, a); cost(7);                          // ld (hl),a
+  }
+  exdehl(); cost(4);                                // ex de,hl
+  pop1(d, e); cost(10);                             // pop de
+  cret();
+}
+
+/* 16D8 PREP-ADD, exponent to zero and the mantissa to two's complement */
+static bool calcPrepAdd(void)
+{
+  a = fetch(hl); cost(7);                           // ld a,(hl)
+  store(hl, 0); cost(10);                           // ld (hl),00
+  anda(a); cost(4);                                 // and a
+  cretif(zf);                                       // ret z
+  inchl(); cost(6);                                 // inc hl
+  bitm(7); cost2(12);                               // bit 7,(hl)
+  setm(7); cost2(15);                               // set 7,(hl)
+  dechl(); cost(6);                                 // dec hl
+  cretif(zf);                                       // ret z
+  push1(b, c); cost(11);                            // push bc
+  b = 0; c = 5; cost(10);                           // ld bc,0005
+  addhl(b, c); cost(11);                            // add hl,bc
+  b = c; cost(4);                                   // ld b,c
+  c = a; cost(4);                                   // ld c,a
+  scf(); cost(4);                                   // scf
+  do
+  {
+    dechl(); cost(6);                               // dec hl
+    a = fetch(hl); cost(7);                         // ld a,(hl)
+    cpl(); cost(4);                                 // cpl
+    adda(0, cy); cost(7);                           // adc a,00
+    store(hl, a); cost(7);                          // ld (hl),a
+  } while (cdjnz());                                // djnz NEG-BYTE
+  a = c; cost(4);                                   // ld a,c
+  pop1(b, c); cost(10);                             // pop bc
+  cret();
+}
+
+/* 16F7 FETCH-TWO */
+static bool calcFetchTwo(void)
+{
+  push1(h, l); cost(11);                            // push hl
+  push1(a, getf()); cost(11);                       // push af
+  c = fetch(hl); cost(7);                           // ld c,(hl)
+  inchl(); cost(6);                                 // inc hl
+  b = fetch(hl); cost(7);                           // ld b,(hl)
+  store(hl, a); cost(7);                            // ld (hl),a
+  inchl(); cost(6);                                 // inc hl
+  a = c; cost(4);                                   // ld a,c
+  c = fetch(hl); cost(7);                           // ld c,(hl)
+  push1(b, c); cost(11);                            // push bc
+  inchl(); cost(6);                                 // inc hl
+  c = fetch(hl); cost(7);                           // ld c,(hl)
+  inchl(); cost(6);                                 // inc hl
+  b = fetch(hl); cost(7);                           // ld b,(hl)
+  exdehl(); cost(4);                                // ex de,hl
+  d = a; cost(4);                                   // ld d,a
+  e = fetch(hl); cost(7);                           // ld e,(hl)
+  push1(d, e); cost(11);                            // push de
+  inchl(); cost(6);                                 // inc hl
+  d = fetch(hl); cost(7);                           // ld d,(hl)
+  inchl(); cost(6);                                 // inc hl
+  e = fetch(hl); cost(7);                           // ld e,(hl)
+  push1(d, e); cost(11);                            // push de
+  exx(); cost(4);                                   // exx
+  pop1(d, e); cost(10);                             // pop de
+  pop1(h, l); cost(10);                             // pop hl
+  pop1(b, c); cost(10);                             // pop bc
+  exx(); cost(4);                                   // exx
+  inchl(); cost(6);                                 // inc hl
+  d = fetch(hl); cost(7);                           // ld d,(hl)
+  inchl(); cost(6);                                 // inc hl
+  e = fetch(hl); cost(7);                           // ld e,(hl)
+  pop1(a, f); lazyf = LAZY_NONE; cost(10);          // pop af
+  pop1(h, l); cost(10);                             // pop hl
+  cret();
+}
+
+/* 1738 ZEROS-4/5 */
+static bool calcZeros(void)
+{
+  l = 0; cost(7);                                   // ld l,00
+  d = a; cost(4);                                   // ld d,a
+  e = l; cost(4);                                   // ld e,l
+  exx(); cost(4);                                   // exx
+  d = e = 0; cost(10);                              // ld de,0000
+  cret();
+}
+
+/* 1741 ADD-BACK */
+static bool calcAddBack(void)
+{
+  inc(e); cost(4);                                  // inc e
+  cretif(!zf);                                      // ret nz
+  inc(d); cost(4);                                  // inc d
+  cretif(!zf);                                      // ret nz
+  exx(); cost(4);                                   // exx
+  inc(e); cost(4);                                  // inc e
+  if (!cjr(!zf))                                    // jr nz,ALL-ADDED
+  {
+    inc(d); cost(4);                                // inc d
+  }
+  exx(); cost(4);                                   // exx
+  cret();
+}
+
+/* 171A SHIFT-FP, shift the addend A places right */
+static bool calcShiftFp(void)
+{
+  anda(a); cost(4);                                 // and a
+  cretif(zf);                                       // ret z
+  cpa(0x21); cost(7);                               // cp 21
+  if (!cjr(!cy))                                    // jr nc,ADDEND-0
+  {
+    push1(b, c); cost(11);                          // push bc
+    b = a; cost(4);                                 // ld b,a
+    do
+    {
+      exx(); cost(4);                               // exx
+      sra(l); cost2(8);                             // sra l
+      rr(d); cost2(8);                              // rr d
+      rr(e); cost2(8);                              // rr e
+      exx(); cost(4);                               // exx
+      rr(d); cost2(8);                              // rr d
+      rr(e); cost2(8);                              // rr e
+    } while (cdjnz());                              // djnz ONE-SHIFT
+    pop1(b, c); cost(10);                           // pop bc
+    cretif(!cy);                                    // ret nc
+    ccall(0x1735, calcAddBack());                   // call ADD-BACK
+    cretif(!zf);                                    // ret nz
+  }
+  exx(); cost(4);                                   // exx
+  xora(a); cost(4);                                 // xor a
+  return calcZeros();
+}
+
+/* 17BC PREP-M/D */
+static bool calcPrepMD(void)
+{
+  scf(); cost(4);                                   // scf
+  decm(); cost(11);                                 // dec (hl)
+  incm(); cost(11);                                 // inc (hl)
+  cretif(zf);                                       // ret z
+  inchl(); cost(6);                                 // inc hl
+  xora(fetch(hl)); cost(7);                         // xor (hl)
+  setm(7); cost2(15);                               // set 7,(hl)
+  dechl(); cost(6);                                 // dec hl
+  cret();
+}
+
+/* 174C subtract, 1755 addition, 17C6 multiply and 1882 division, which
+ * share the normalisation and result code from 1810 */
+static bool calcArith(unsigned short entry)
+{
+  if (entry == 0x1755) goto addition;
+  if (entry == 0x17c6) goto multiply;
+  if (entry == 0x1882) goto division;
+
+  a = fetch(de); cost(7);                           // ld a,(de)
+  anda(a); cost(4);                                 // and a
+  cretif(zf);                                       // ret z
+  incde(); cost(6);                                 // inc de
+  a = fetch(de); cost(7);                           // ld a,(de)
+  xora(0x80); cost(7);                              // xor 80
+  store(de, a); cost(7);                            // ld (de),a
+  decde(); cost(6);                                 // dec de
+
+addition:
+  exx(); cost(4);                                   // exx
+  push1(h, l); cost(11);                            // push hl
+  exx(); cost(4);                                   // exx
+  push1(d, e); cost(11);                            // push de
+  push1(h, l); cost(11);                            // push hl
+  ccall(0x175d, calcPrepAdd());                     // call PREP-ADD
+  b = a; cost(4);                                   // ld b,a
+  exdehl(); cost(4);                                // ex de,hl
+  ccall(0x1762, calcPrepAdd());                     // call PREP-ADD
+  c = a; cost(4);                                   // ld c,a
+  cpa(b); cost(4);                                  // cp b
+  if (!cjr(!cy))                                    // jr nc,SHIFT-LEN
+  {
+    a = b; cost(4);                                 // ld a,b
+    b = c; cost(4);                                 // ld b,c
+    exdehl(); cost(4);                              // ex de,hl
+  }
+  push1(a, getf()); cost(11);                       // push af
+  suba(b, 0); cost(4);                              // sub b
+  ccall(0x176e, calcFetchTwo());                    // call FETCH-TWO
+  ccall(0x1771, calcShiftFp());                     // call SHIFT-FP
+  pop1(a, f); lazyf = LAZY_NONE; cost(10);          // pop af
+  pop1(h, l); cost(10);                             // pop hl
+  store(hl, a); cost(7);                            // ld (hl),a
+  push1(h, l); cost(11);                            // push hl
+  l = b; cost(4);                                   // ld l,b
+  h = c; cost(4);                                   // ld h,c
+  addhl(d, e); cost(11);                            // add hl,de
+  exx(); cost(4);                                   // exx
+  exdehl(); cost(4);                                // ex de,hl
+  adchl(bc); cost2(15);                             // adc hl,bc
+  exdehl(); cost(4);                                // ex de,hl
+  a = h; cost(4);                                   // ld a,h
+  adda(l, cy); cost(4);                             // adc a,l
+  l = a; cost(4);                                   // ld l,a
+  rra(); cost(4);                                   // rra
+  xora(l); cost(4);                                 // xor l
+  exx(); cost(4);                                   // exx
+  exdehl(); cost(4);                                // ex de,hl
+  pop1(h, l); cost(10);                             // pop hl
+  rra(); cost(4);                                   // rra
+  if (!cjr(!cy))                                    // jr nc,TEST-NEG
+  {
+    a = 1; cost(7);                                 // ld a,01
+    ccall(0x178d, calcShiftFp());                   // call SHIFT-FP
+    incm(); cost(11);                               // inc (hl)
+    if (cjr(zf))                                    // jr z,ADD-REP-6
+    {
+      cost(10);                                     // jp z,REPORT-6
+      cexit(0x1880);
+    }
+  }
+  exx(); cost(4);                                   // exx
+  a = l; cost(4);                                   // ld a,l
+  anda(0x80); cost(7);                              // and 80
+  exx(); cost(4);                                   // exx
+  inchl(); cost(6);                                 // inc hl
+  store(hl, a); cost(7);                            // ld (hl),a
+  dechl(); cost(6);                                 // dec hl
+  if (!cjr(zf))                                     // jr z,GO-NC-MLT
+  {
+    a = e; cost(4);                                 // ld a,e
+    neg; cost2(8);                                  // neg
+    ccf(); cost(4);                                 // ccf
+    e = a; cost(4);                                 // ld e,a
+    a = d; cost(4);                                 // ld a,d
+    cpl(); cost(4);                                 // cpl
+    adda(0, cy); cost(7);                           // adc a,00
+    d = a; cost(4);                                 // ld d,a
+    exx(); cost(4);                                 // exx
+    a = e; cost(4);                                 // ld a,e
+    cpl(); cost(4);                                 // cpl
+    adda(0, cy); cost(7);                           // adc a,00
+    e = a; cost(4);                                 // ld e,a
+    a = d; cost(4);                                 // ld a,d
+    cpl(); cost(4);                                 // cpl
+    adda(0, cy); cost(7);                           // adc a,00
+    if (!cjr(!cy))                                  // jr nc,END-COMPL
+    {
+      rra(); cost(4);                               // rra
+      exx(); cost(4);                               // exx
+      incm(); cost(11);                             // inc (hl)
+      cost(10);                                     // jp z,REPORT-6
+      if (zf) cexit(0x1880);
+      exx(); cost(4);                               // exx
+    }
+    d = a; cost(4);                                 // ld d,a
+    exx(); cost(4);                                 // exx
+  }
+  xora(a); cost(4);                                 // xor a
+  cost(12);                                         // jr TEST-NORM
+  goto test_norm;
+
+multiply:
+  xora(a); cost(4);                                 // xor a
+  ccall(0x17ca, calcPrepMD());                      // call PREP-M/D
+  cretif(cy);                                       // ret c
+  exx(); cost(4);                                   // exx
+  push1(h, l); cost(11);                            // push hl
+  exx(); cost(4);                                   // exx
+  push1(d, e); cost(11);                            // push de
+  exdehl(); cost(4);                                // ex de,hl
+  ccall(0x17d3, calcPrepMD());                      // call PREP-M/D
+  exdehl(); cost(4);                                // ex de,hl
+  if (cjr(cy))                                      // jr c,ZERO-RSLT
+    goto zero_rslt;
+  push1(h, l); cost(11);                            // push hl
+  ccall(0x17da, calcFetchTwo());                    // call FETCH-TWO
+  a = b; cost(4);                                   // ld a,b
+  anda(a); cost(4);                                 // and a
+  sbchl(hl); cost2(15);                             // sbc hl,hl
+  exx(); cost(4);                                   // exx
+  push1(h, l); cost(11);                            // push hl
+  sbchl(hl); cost2(15);                             // sbc hl,hl
+  exx(); cost(4);                                   // exx
+  b = 0x21; cost(7);                                // ld b,21
+  cost(12);                                         // jr STRT-MLT
+  goto strt_mlt;
+mlt_loop:
+  if (!cjr(!cy))                                    // jr nc,NO-ADD
+  {
+    addhl(d, e); cost(11);                          // add hl,de
+    exx(); cost(4);                                 // exx
+    adchl(de); cost2(15);                           // adc hl,de
+    exx(); cost(4);                                 // exx
+  }
+  exx(); cost(4);                                   // exx
+  rr(h); cost2(8);                                  // rr h
+  rr(l); cost2(8);                                  // rr l
+  exx(); cost(4);                                   // exx
+  rr(h); cost2(8);                                  // rr h
+  rr(l); cost2(8);                                  // rr l
+strt_mlt:
+  exx(); cost(4);                                   // exx
+  rr(b); cost2(8);                                  // rr b
+  rr(c); cost2(8);                                  // rr c
+  exx(); cost(4);                                   // exx
+  rr(c); cost2(8);                                  // rr c
+  rra(); cost(4);                                   // rra
+  if (cdjnz())                                      // djnz MLT-LOOP
+    goto mlt_loop;
+  exdehl(); cost(4);                                // ex de,hl
+  exx(); cost(4);                                   // exx
+  exdehl(); cost(4);                                // ex de,hl
+  exx(); cost(4);                                   // exx
+  pop1(b, c); cost(10);                             // pop bc
+  pop1(h, l); cost(10);                             // pop hl
+  a = b; cost(4);                                   // ld a,b
+  adda(c, 0); cost(4);                              // add a,c
+  if (!cjr(!zf))                                    // jr nz,MAKE-EXPT
+  {
+    anda(a); cost(4);                               // and a
+  }
+  dec(a); cost(4);                                  // dec a
+  ccf(); cost(4);                                   // ccf
+
+divn_expt:
+  rla(); cost(4);                                   // rla
+  ccf(); cost(4);                                   // ccf
+  rra(); cost(4);                                   // rra
+  cost(10);                                         // jp p,OFLW1-CLR
+  if (sf)
+  {
+    if (cjr(!cy))                                   // jr nc,REPORT-6
+      cexit(0x1880);
+    anda(a); cost(4);                               // and a
+  }
+  inc(a); cost(4);                                  // inc a
+  if (!cjr(!zf) && !cjr(cy))                        // jr nz,OFLW2-CLR
+  {                                                 // jr c,OFLW2-CLR
+    exx(); cost(4);                                 // exx
+    bit(7, d); cost2(8);                            // bit 7,d
+    exx(); cost(4);                                 // exx
+    if (cjr(!zf))                                   // jr nz,REPORT-6
+      cexit(0x1880);
+  }
+  store(hl, a); cost(7);                            // ld (hl),a
+  exx(); cost(4);                                   // exx
+  a = b; cost(4);                                   // ld a,b
+  exx(); cost(4);                                   // exx
+
+test_norm:
+  if (cjr(!cy))                                     // jr nc,NORMALISE
+    goto normalise;
+  a = fetch(hl); cost(7);                           // ld a,(hl)
+  anda(a); cost(4);                                 // and a
+near_zero:
+  a = 0x80; cost(7);                                // ld a,80
+  if (cjr(zf))                                      // jr z,SKIP-ZERO
+    goto skip_zero;
+zero_rslt:
+  xora(a); cost(4);                                 // xor a
+skip_zero:
+  exx(); cost(4);                                   // exx
+  anda(d); cost(4);                                 // and d
+  ccall(0x1836, calcZeros());                       // call ZEROS-4/5
+  rlca(); cost(4);                                  // rlca
+  store(hl, a); cost(7);                            // ld (hl),a
+  if (cjr(cy))                                      // jr c,OFLOW-CLR
+    goto oflow_clr;
+  inchl(); cost(6);                                 // inc hl
+  store(hl, a); cost(7);                            // ld (hl),a
+  dechl(); cost(6);                                 // dec hl
+  cost(12);                                         // jr OFLOW-CLR
+  goto oflow_clr;
+
+normalise:
+  b = 0x20; cost(7);                                // ld b,20
+  do
+  {
+    exx(); cost(4);                                 // exx
+    bit(7, d); cost2(8);                            // bit 7,d
+    exx(); cost(4);                                 // exx
+    if (cjr(!zf))                                   // jr nz,NORML-NOW
+      goto norml_now;
+    rlca(); cost(4);                                // rlca
+    rl(e); cost2(8);                                // rl e
+    rl(d); cost2(8);                                // rl d
+    exx(); cost(4);                                 // exx
+    rl(e); cost2(8);                                // rl e
+    rl(d); cost2(8);                                // rl d
+    exx(); cost(4);                                 // exx
+    decm(); cost(11);                               // dec (hl)
+    if (cjr(zf))                                    // jr z,NEAR-ZERO
+      goto near_zero;
+  } while (cdjnz());                                // djnz SHIFT-ONE
+  cost(12);                                         // jr ZERO-RSLT
+  goto zero_rslt;
+
+norml_now:
+  rla(); cost(4);                                   // rla
+  if (!cjr(!cy))                                    // jr nc,OFLOW-CLR
+  {
+    ccall(0x185f, calcAddBack());                   // call ADD-BACK
+    if (!cjr(!zf))                                  // jr nz,OFLOW-CLR
+    {
+      exx(); cost(4);                               // exx
+      d = 0x80; cost(7);                            // ld d,80
+      exx(); cost(4);                               // exx
+      incm(); cost(11);                             // inc (hl)
+      if (cjr(zf))                                  // jr z,REPORT-6
+        cexit(0x1880);
+    }
+  }
+
+oflow_clr:
+  push1(h, l); cost(11);                            // push hl
+  inchl(); cost(6);                                 // inc hl
+  exx(); cost(4);                                   // exx
+  push1(d, e); cost(11);                            // push de
+  exx(); cost(4);                                   // exx
+  pop1(b, c); cost(10);                             // pop bc
+  a = b; cost(4);                                   // ld a,b
+  rla(); cost(4);                                   // rla
+  rlm(); cost2(15);                                 // rl (hl)
+  rra(); cost(4);                                   // rra
+  store(hl, a); cost(7);                            // ld (hl),a
+  inchl(); cost(6);                                 // inc hl
+  store(hl, c); cost(7);                            // ld (hl),c
+  inchl(); cost(6);                                 // inc hl
+  store(hl, d); cost(7);                            // ld (hl),d
+  inchl(); cost(6);                                 // inc hl
+  store(hl, e); cost(7);                            // ld (hl),e
+  pop1(h, l); cost(10);                             // pop hl
+  pop1(d, e); cost(10);                             // pop de
+  exx(); cost(4);                                   // exx
+  pop1(h, l); cost(10);                             // pop hl
+  exx(); cost(4);                                   // exx
+  cret();
+
+division:
+  exdehl(); cost(4);                                // ex de,hl
+  xora(a); cost(4);                                 // xor a
+  ccall(0x1887, calcPrepMD());                      // call PREP-M/D
+  if (cjr(cy))                                      // jr c,REPORT-6
+    cexit(0x1880);
+  exdehl(); cost(4);                                // ex de,hl
+  ccall(0x188d, calcPrepMD());                      // call PREP-M/D
+  cretif(cy);                                       // ret c
+  exx(); cost(4);                                   // exx
+  push1(h, l); cost(11);                            // push hl
+  exx(); cost(4);                                   // exx
+  push1(d, e); cost(11);                            // push de
+  push1(h, l); cost(11);                            // push hl
+  ccall(0x1896, calcFetchTwo());                    // call FETCH-TWO
+  exx(); cost(4);                                   // exx
+  push1(h, l); cost(11);                            // push hl
+  h = b; cost(4);                                   // ld h,b
+  l = c; cost(4);                                   // ld l,c
+  exx(); cost(4);                                   // exx
+  h = c; cost(4);                                   // ld h,c
+  l = b; cost(4);                                   // ld l,b
+  xora(a); cost(4);                                 // xor a
+  b = 0xdf; cost(7);                                // ld b,df
+  cost(12);                                         // jr DIV-START
+  goto div_start;
+div_loop:
+  rla(); cost(4);                                   // rla
+  rl(c); cost2(8);                                  // rl c
+  exx(); cost(4);                                   // exx
+  rl(c); cost2(8);                                  // rl c
+  rl(b); cost2(8);                                  // rl b
+  exx(); cost(4);                                   // exx
+  addhl(h, l); cost(11);                            // add hl,hl
+  exx(); cost(4);                                   // exx
+  adchl(hl); cost2(15);                             // adc hl,hl
+  exx(); cost(4);                                   // exx
+  if (cjr(cy))                                      // jr c,SUBN-ONLY
+  {
+    anda(a); cost(4);                               // and a
+    sbchl(de); cost2(15);                           // sbc hl,de
+    exx(); cost(4);                                 // exx
+    sbchl(de); cost2(15);                           // sbc hl,de
+    exx(); cost(4);                                 // exx
+    goto no_rstore;
+  }
+div_start:
+  sbchl(de); cost2(15);                             // sbc hl,de
+  exx(); cost(4);                                   // exx
+  sbchl(de); cost2(15);                             // sbc hl,de
+  exx(); cost(4);                                   // exx
+  if (!cjr(!cy))                                    // jr nc,NO-RSTORE
+  {
+    addhl(d, e); cost(11);                          // add hl,de
+    exx(); cost(4);                                 // exx
+    adchl(de); cost2(15);                           // adc hl,de
+    exx(); cost(4);                                 // exx
+    anda(a); cost(4);                               // and a
+    cost(12);                                       // jr COUNT-ONE
+    goto count_one;
+  }
+no_rstore:
+  scf(); cost(4);                                   // scf
+count_one:
+  inc(b); cost(4);                                  // inc b
+  cost(10);                                         // jp m,DIV-LOOP
+  if (sf)
+    goto div_loop;
+  push1(a, getf()); cost(11);                       // push af
+  if (cjr(zf))                                      // jr z,DIV-START
+    goto div_start;
+  e = a; cost(4);                                   // ld e,a
+  d = c; cost(4);                                   // ld d,c
+  exx(); cost(4);                                   // exx
+  e = c; cost(4);                                   // ld e,c
+  d = b; cost(4);                                   // ld d,b
+  pop1(a, f); lazyf = LAZY_NONE; cost(10);          // pop af
+  rr(b); cost2(8);                                  // rr b
+  pop1(a, f); lazyf = LAZY_NONE; cost(10);          // pop af
+  rr(b); cost2(8);                                  // rr b
+  exx(); cost(4);                                   // exx
+  pop1(b, c); cost(10);                             // pop bc
+  pop1(h, l); cost(10);                             // pop hl
+  a = b; cost(4);                                   // ld a,b
+  suba(c, 0); cost(4);                              // sub c
+  cost(10);                                         // jp DIVN-EXPT
+  goto divn_expt;
+}
+
+/* 1B03 the numeric comparisons, the literal is in B. The string
+ * comparisons are left to the ROM */
+static bool calcCompare(void)
+{
+  a = b; cost(4);                                   // ld a,b
+  suba(0x08, 0); cost(7);                           // sub 08
+  bit(2, a); cost2(8);                              // bit 2,a
+  if (!cjr(!zf))                                    // jr nz,EX-OR-NOT
+  {
+    dec(a); cost(4);                                // dec a
+  }
+  rrca(); cost(4);                                  // rrca
+  if (!cjr(!cy))                                    // jr nc,NU-OR-STR
+  {
+    push1(a, getf()); cost(11);                     // push af
+    push1(h, l); cost(11);                          // push hl
+    ccall(0x1b13, calcExchange());                  // call exchange
+    pop1(d, e); cost(10);                           // pop de
+    exdehl(); cost(4);                              // ex de,hl
+    pop1(a, f); lazyf = LAZY_NONE; cost(10);        // pop af
+  }
+  bit(2, a); cost2(8);                              // bit 2,a
+  if (cjr(!zf))                                     // jr nz,STRINGS
+    cexit(0x1b21);
+  rrca(); cost(4);                                  // rrca
+  push1(a, getf()); cost(11);                       // push af
+  ccall(0x1b1f, calcArith(0x174c));                 // call subtract
+  cost(12);                                         // jr END-TESTS
+  pop1(a, f); lazyf = LAZY_NONE; cost(10);          // pop af
+  push1(a, getf()); cost(11);                       // push af
+  ccallif(cy, 0x1b59, calcNot());                   // call c,not
+  ccall(0x1b5c, calcGreater0());                    // call greater-0
+  pop1(a, f); lazyf = LAZY_NONE; cost(10);          // pop af
+  rrca(); cost(4);                                  // rrca
+  ccallif(!cy, 0x1b61, calcNot());                  // call nc,not
+  cret();
+}
+
+/* Run the routine at addr, entered from the dispatch RET. Returns true
+ * when it has returned to RE-ENTRY */
+static bool calcRoutine(unsigned short addr)
+{
+  switch (addr)
+  {
+    case 0x002b:    // end-calc
+      pop1(a, f); lazyf = LAZY_NONE; cost(10);      // pop af
+      exx(); cost(4);                               // exx
+      exsphl(); cost(19);                           // ex (sp),hl
+      exx(); cost(4);                               // exx
+      pop2(pc); cost(10);                           // ret
+      return false;
+
+    case 0x174c:    // subtract
+    case 0x1755:    // addition
+    case 0x17c6:    // multiply
+    case 0x1882:    // division
+      return calcArith(addr);
+
+    case 0x18e4: return calcTruncate();
+    case 0x19e3: cret();                            // delete
+    case 0x19f6: return calcMoveFp();               // duplicate
+    case 0x19fc: return calcStkData();
+    case 0x1a45: return calcGetMem();
+    case 0x1a51: return calcStkConstXx();
+    case 0x1a63: return calcStMem();
+    case 0x1a72: return calcExchange();
+    case 0x1aa0: return calcNegate();
+    case 0x1aaa: return calcAbs();
+    case 0x1aaf: return calcSgn();
+    case 0x1ace: return calcGreater0();
+    case 0x1ad5: return calcNot();
+    case 0x1adb: return calcLess0();
+    case 0x1aed: return calcOr();
+    case 0x1af3: return calcNoAndNo();
+    case 0x1af8: return calcStrAndNo();
+    case 0x1b03: return calcCompare();
+    case 0x1c17: return calcDecJrNz();
+    case 0x1c23: return calcJump();
+    case 0x1c2f: return calcJumpTrue();
+
+    default:
+      cexit(addr);
+  }
+}
+
+/* 19AE SCAN-ENT, with the literal in A and the alternate registers
+ * swapped in. Runs the dispatch up to its RET, and returns the address
+ * of the literal's routine */
+static unsigned short calcScanEnt(void)
+{
+  unsigned short addr;
+
+  push1(h, l); cost(11);                            // push hl
+  anda(a); cost(4);                                 // and a
+  cost(10);                                         // jp p,FIRST-3D
+  if (sf)
+  {
+    d = a; cost(4);                                 // ld d,a
+    anda(0x60); cost(7);                            // and 60
+    rrca(); cost(4);                                // rrca
+    rrca(); cost(4);                                // rrca
+    rrca(); cost(4);                                // rrca
+    rrca(); cost(4);                                // rrca
+    adda(0x72, 0); cost(7);                         // add a,72
+    l = a; cost(4);                                 // ld l,a
+    a = d; cost(4);                                 // ld a,d
+    anda(0x1f); cost(7);                            // and 1f
+    cost(12);                                       // jr ENT-TABLE
+  }
+  else
+  {
+    cpa(0x18); cost(7);                             // cp 18
+    if (!cjr(!cy))                                  // jr nc,DOUBLE-A
+    {
+      exx(); cost(4);                               // exx
+      b = 0xff; c = 0xfb; cost(10);                 // ld bc,fffb
+      d = h; cost(4);                               // ld d,h
+      e = l; cost(4);                               // ld e,l
+      addhl(b, c); cost(11);                        // add hl,bc
+      exx(); cost(4);                               // exx
+    }
+    rlca(); cost(4);                                // rlca
+    l = a; cost(4);                                 // ld l,a
+  }
+  d = 0x19; e = 0x23; cost(10);                     // ld de,tbl-addrs
+  h = 0; cost(7);                                   // ld h,00
+  addhl(d, e); cost(11);                            // add hl,de
+  e = fetch(hl); cost(7);                           // ld e,(hl)
+  inchl(); cost(6);                                 // inc hl
+  d = fetch(hl); cost(7);                           // ld d,(hl)
+  h = 0x19; l = 0xa7; cost(10);                     // ld hl,RE-ENTRY
+  exsphl(); cost(19);                               // ex (sp),hl
+  push1(d, e); cost(11);                            // push de
+  exx(); cost(4);                                   // exx
+  c = fetch(0x401d); b = fetch(0x401e); cost2(20);  // ld bc,(STKEND_hi)
+  pop2(addr); cost(10);                             // ret
+  return addr;
+}
+
+/* One literal, from 19AB after RE-ENTRY has stored STKEND. pc is left at
+ * 19AB for the next literal, or where the ROM is to continue */
+static void calcLiteral(void)
+{
+  unsigned short addr;
+
+  exx(); cost(4);                                   // exx
+  a = fetch(hl); cost(7);                           // ld a,(hl)
+  inchl(); cost(6);                                 // inc hl
+  addr = calcScanEnt();
+
+  // 19E4 fp-calc-2, the literal in BREG is run in its place
+  while (addr == 0x19e4)
+  {
+    pop1(a, f); lazyf = LAZY_NONE; cost(10);        // pop af
+    a = fetch(0x401e); cost(13);                    // ld a,(BREG)
+    exx(); cost(4);                                 // exx
+    cost(12);                                       // jr SCAN-ENT
+    addr = calcScanEnt();
+  }
+
+  if (calcRoutine(addr))
+  {
+    store2b(0x401c, d, e); cost2(20);               // 19A7 ld (STKEND),de
+    pc = CALC_NEXT;
+  }
+}
+
+#ifdef CALC_VERIFY
+/* Memory compared: the sysvars, the top of the calculator stack, the
+ * calculator memory and the machine stack below SP */
+#define CALC_WINDOWS  4
+#define CALC_WINDOW   128
+
+MACHINE_STATE unsigned long calc_verified = 0;
+MACHINE_STATE unsigned long calc_mismatched = 0;
+
+/* Run one literal natively, then again in the ROM from the same state,
+ * and compare. The ROM result is kept */
+static void calcVerify(void)
+{
+  HleWindow_T window[CALC_WINDOWS];
+  unsigned short ptr = (h1 << 8) | l1;
+  unsigned long start = tstates;
+  char label[32];
+
+  window[0].start = 0x4000;
+  window[1].start = ((fetch(0x401d) << 8) | fetch(0x401c)) - (CALC_WINDOW / 2);
+  window[2].start = (fetch(0x4020) << 8) | fetch(0x401f);
+  window[3].start = sp - CALC_WINDOW + 8;
+  for (int w = 0; w < CALC_WINDOWS; w++)
+    window[w].length = CALC_WINDOW;
+
+  snprintf(label, sizeof(label), "calc: literal %02x at %04x", fetch(ptr), ptr);
+  if (!hleVerify(calcLiteral, window, CALC_WINDOWS, label))
+  {
+    calc_mismatched++;
+  }
+  else if (tstates - start > CALC_LITERAL_TSTATES)
+  {
+    hleReport(label, "tstates limit", tstates - start, CALC_LITERAL_TSTATES);
+    calc_mismatched++;
+  }
+  else
+  {
+    calc_verified++;
+  }
+}
+#endif
+
+/* Trap at 19AB, after RE-ENTRY has stored STKEND. Returns the tstates
+ * the ULA has stepped, of those since tstore */
+static unsigned long calculateROM(unsigned long tstore)
+{
+  bool turbo;
+
+#ifdef HLE_VERIFY
+  if (hle_verifying)
+    return 0;
+#endif
+  if (zx80 || NMI_generator || iff1)
+    return 0;
+
+  hleStart(tstore);
+  turbo = hle_turbo;
+  while ((pc == CALC_NEXT) && (tstates + CALC_LITERAL_TSTATES < tsexit))
+  {
+#ifdef CALC_VERIFY
+    calcVerify();
+#else
+    calcLiteral();
+#endif
+  }
+  return hleEnd(tstore, turbo);
+}
@@ -19,16 +19,16 @@
 #define var_t   unsigned char t
 #define rlc(x)  (x=(x<<1)|(x>>7),rflags(x,x&1))
 #define rrc(x)  do{var_t=x&1;x=(x>>1)|(t<<7);rflags(x,t);}while(0)
-#define rl(x)   do{var_t=x>>7;x=(x<<1)|(f&1);rflags(x,t);}while(0)
-#define rr(x)   do{var_t=x&1;x=(x>>1)|(f<<7);rflags(x,t);}while(0)
+#define rl(x)   do{var_t=x>>7;x=(x<<1)|(getf()&1);rflags(x,t);}while(0)
+#define rr(x)   do{var_t=x&1;x=(x>>1)|(getf()<<7);rflags(x,t);}while(0)
 #define sla(x)  do{var_t=x>>7;x<<=1;rflags(x,t);}while(0)
 #define sra(x)  do{var_t=x&1;x=((signed char)x)>>1;rflags(x,t);}while(0)
 #define sll(x)  do{var_t=x>>7;x=(x<<1)|1;rflags(x,t);}while(0)
 #define srl(x)  do{var_t=x&1;x>>=1;rflags(x,t);}while(0)
 
-#define rflags(x,c) (f=(c)|(x&0xa8)|((!x)<<6)|parity(x))
+#define rflags(x,c) (lazyf=LAZY_NONE,f=(c)|szptable[x])
 
-#define bit(n,x) (f=(f&1)|((x&(1<<n))?0x10:0x54)|(x&0x28))
+#define bit(n,x) (f=(getf()&1)|((x&(1<<n))?0x10:0x54)|(x&0x28))
 #define set(n,x) (x|=(1<<n))
 #define res(n,x) (x&=~(1<<n))
 
@@ -36,125 +36,141 @@
    /* reg/val are initialised to stop gcc's (incorrect) warning,
     * and static to save initialising them every time.
     */
-   static unsigned char reg=0,val=0;
+   static MACHINE_STATE unsigned char reg=0,val=0;
    unsigned short addr;
-   unsigned char op;
-   if(ixoriy){
-      addr=(ixoriy==1?ix:iy)+(signed char)fetchm(pc);
+   unsigned char cbop;
+   if(Z80_XMODE){
+      addr=(Z80_XMODE==1?ix:iy)+(signed char)fetchm(pc);
       pc++;
       tstates+=8;
-      op=fetchm(pc);
-      reg=op&7;
-      op=(op&0xf8)|6;
+      cbop=fetchm(pc);
+      reg=cbop&7;
+      cbop=(cbop&0xf8)|6;
    }
    else{
-      op=fetchm(pc);
+      cbop=fetchm(pc);
       tstates+=4;
       radjust++;
       addr=hl;
    }
    pc++;
 
-   if(op<64)switch(op){
-   case  0: rlc(b); break;
-   case  1: rlc(c); break;
-   case  2: rlc(d); break;
-   case  3: rlc(e); break;
-   case  4: rlc(h); break;
-   case  5: rlc(l); break;
-   case  6: tstates+=7;val=fetch(addr);rlc(val);store(addr,val);break;
-   case  7: rlc(a); break;
-   case  8: rrc(b); break;
-   case  9: rrc(c); break;
-   case 10: rrc(d);
+#ifdef Z80_THREADED
+#undef Z80_PAGE
+#define Z80_PAGE Z80_CBPAGE
+   do{
+   unsigned char n=(cbop>>3)&7;
+   goto *Z80_CBOPS[cbop];
+#else
+   if(cbop<64)switch(cbop){
+#endif
+   opcase( 0): rlc(b); break;
+   opcase( 1): rlc(c); break;
+   opcase( 2): rlc(d); break;
+   opcase( 3): rlc(e); break;
+   opcase( 4): rlc(h); break;
+   opcase( 5): rlc(l); break;
+   opcase( 6): tstates+=7;val=fetch(addr);rlc(val);store(addr,val);break;
+   opcase( 7): rlc(a); break;
+   opcase( 8): rrc(b); break;
+   opcase( 9): rrc(c); break;
+   opcase(10): rrc(d);
 #ifdef LOAD_AND_SAVE
-     if ((pc == LOAD_START_8K) && (!rom4k)) loadAndSaveROM();
+     if ((pc == LOAD_START_8K) && rom_traps && (!rom4k)) loadAndSaveROM();
 #endif
    break;
-   case 11: rrc(e); break;
-   case 12: rrc(h); break;
-   case 13: rrc(l); break;
-   case 14: tstates+=7;val=fetch(addr);rrc(val);store(addr,val);break;
-   case 15: rrc(a); break;
-   case 0x10: rl(b); break;
-   case 0x11: rl(c); break;
-   case 0x12: rl(d); break;
-   case 0x13: rl(e); break;
-   case 0x14: rl(h); break;
-   case 0x15: rl(l); break;
-   case 0x16: tstates+=7;val=fetch(addr);rl(val);store(addr,val);break;
-   case 0x17: rl(a); break;
-   case 0x18: rr(b); break;
-   case 0x19: rr(c); break;
-   case 0x1a: rr(d); break;
-   case 0x1b: rr(e); break;
-   case 0x1c: rr(h); break;
-   case 0x1d: rr(l); break;
-   case 0x1e: tstates+=7;val=fetch(addr);rr(val);store(addr,val);break;
-   case 0x1f: rr(a); break;
-   case 0x20: sla(b); break;
-   case 0x21: sla(c); break;
-   case 0x22: sla(d); break;
-   case 0x23: sla(e); break;
-   case 0x24: sla(h); break;
-   case 0x25: sla(l); break;
-   case 0x26: tstates+=7;val=fetch(addr);sla(val);store(addr,val);break;
-   case 0x27: sla(a); break;
-   case 0x28: sra(b); break;
-   case 0x29: sra(c); break;
-   case 0x2a: sra(d); break;
-   case 0x2b: sra(e); break;
-   case 0x2c: sra(h); break;
-   case 0x2d: sra(l); break;
-   case 0x2e: tstates+=7;val=fetch(addr);sra(val);store(addr,val);break;
-   case 0x2f: sra(a); break;
-   case 0x30: sll(b); break;
-   case 0x31: sll(c); break;
-   case 0x32: sll(d); break;
-   case 0x33: sll(e); break;
-   case 0x34: sll(h); break;
-   case 0x35: sll(l); break;
-   case 0x36: tstates+=7;val=fetch(addr);sll(val);store(addr,val);break;
-   case 0x37: sll(a); break;
-   case 0x38: srl(b); break;
-   case 0x39: srl(c); break;
-   case 0x3a: srl(d); break;
-   case 0x3b: srl(e); break;
-   case 0x3c: srl(h); break;
-   case 0x3d: srl(l); break;
-   case 0x3e: tstates+=7;val=fetch(addr);srl(val);store(addr,val);break;
-   case 0x3f: srl(a); break;
+   opcase(11): rrc(e); break;
+   opcase(12): rrc(h); break;
+   opcase(13): rrc(l); break;
+   opcase(14): tstates+=7;val=fetch(addr);rrc(val);store(addr,val);break;
+   opcase(15): rrc(a); break;
+   opcase(0x10): rl(b); break;
+   opcase(0x11): rl(c); break;
+   opcase(0x12): rl(d); break;
+   opcase(0x13): rl(e); break;
+   opcase(0x14): rl(h); break;
+   opcase(0x15): rl(l); break;
+   opcase(0x16): tstates+=7;val=fetch(addr);rl(val);store(addr,val);break;
+   opcase(0x17): rl(a); break;
+   opcase(0x18): rr(b); break;
+   opcase(0x19): rr(c); break;
+   opcase(0x1a): rr(d); break;
+   opcase(0x1b): rr(e); break;
+   opcase(0x1c): rr(h); break;
+   opcase(0x1d): rr(l); break;
+   opcase(0x1e): tstates+=7;val=fetch(addr);rr(val);store(addr,val);break;
+   opcase(0x1f): rr(a); break;
+   opcase(0x20): sla(b); break;
+   opcase(0x21): sla(c); break;
+   opcase(0x22): sla(d); break;
+   opcase(0x23): sla(e); break;
+   opcase(0x24): sla(h); break;
+   opcase(0x25): sla(l); break;
+   opcase(0x26): tstates+=7;val=fetch(addr);sla(val);store(addr,val);break;
+   opcase(0x27): sla(a); break;
+   opcase(0x28): sra(b); break;
+   opcase(0x29): sra(c); break;
+   opcase(0x2a): sra(d); break;
+   opcase(0x2b): sra(e); break;
+   opcase(0x2c): sra(h); break;
+   opcase(0x2d): sra(l); break;
+   opcase(0x2e): tstates+=7;val=fetch(addr);sra(val);store(addr,val);break;
+   opcase(0x2f): sra(a); break;
+   opcase(0x30): sll(b); break;
+   opcase(0x31): sll(c); break;
+   opcase(0x32): sll(d); break;
+   opcase(0x33): sll(e); break;
+   opcase(0x34): sll(h); break;
+   opcase(0x35): sll(l); break;
+   opcase(0x36): tstates+=7;val=fetch(addr);sll(val);store(addr,val);break;
+   opcase(0x37): sll(a); break;
+   opcase(0x38): srl(b); break;
+   opcase(0x39): srl(c); break;
+   opcase(0x3a): srl(d); break;
+   opcase(0x3b): srl(e); break;
+   opcase(0x3c): srl(h); break;
+   opcase(0x3d): srl(l); break;
+   opcase(0x3e): tstates+=7;val=fetch(addr);srl(val);store(addr,val);break;
+   opcase(0x3f): srl(a); break;
+#ifndef Z80_THREADED
    }
    else{
-      unsigned char n=(op>>3)&7;
-      switch(op&0xc7){
-      case 0x40: bit(n,b); break;
-      case 0x41: bit(n,c); break;
-      case 0x42: bit(n,d); break;
-      case 0x43: bit(n,e); break;
-      case 0x44: bit(n,h); break;
-      case 0x45: bit(n,l); break;
-      case 0x46: tstates+=4;val=fetch(addr);bit(n,val);break;
-      case 0x47: bit(n,a); break;
-      case 0x80: res(n,b); break;
-      case 0x81: res(n,c); break;
-      case 0x82: res(n,d); break;
-      case 0x83: res(n,e); break;
-      case 0x84: res(n,h); break;
-      case 0x85: res(n,l); break;
-      case 0x86: tstates+=7;val=fetch(addr);res(n,val);store(addr,val);break;
-      case 0x87: res(n,a); break;
-      case 0xc0: set(n,b); break;
-      case 0xc1: set(n,c); break;
-      case 0xc2: set(n,d); break;
-      case 0xc3: set(n,e); break;
-      case 0xc4: set(n,h); break;
-      case 0xc5: set(n,l); break;
-      case 0xc6: tstates+=7;val=fetch(addr);set(n,val);store(addr,val);break;
-      case 0xc7: set(n,a); break;
+      unsigned char n=(cbop>>3)&7;
+      switch(cbop&0xc7){
+#endif
+      opcase(0x40): bit(n,b); break;
+      opcase(0x41): bit(n,c); break;
+      opcase(0x42): bit(n,d); break;
+      opcase(0x43): bit(n,e); break;
+      opcase(0x44): bit(n,h); break;
+      opcase(0x45): bit(n,l); break;
+      opcase(0x46): tstates+=4;val=fetch(addr);bit(n,val);break;
+      opcase(0x47): bit(n,a); break;
+      opcase(0x80): res(n,b); break;
+      opcase(0x81): res(n,c); break;
+      opcase(0x82): res(n,d); break;
+      opcase(0x83): res(n,e); break;
+      opcase(0x84): res(n,h); break;
+      opcase(0x85): res(n,l); break;
+      opcase(0x86): tstates+=7;val=fetch(addr);res(n,val);store(addr,val);break;
+      opcase(0x87): res(n,a); break;
+      opcase(0xc0): set(n,b); break;
+      opcase(0xc1): set(n,c); break;
+      opcase(0xc2): set(n,d); break;
+      opcase(0xc3): set(n,e); break;
+      opcase(0xc4): set(n,h); break;
+      opcase(0xc5): set(n,l); break;
+      opcase(0xc6): tstates+=7;val=fetch(addr);set(n,val);store(addr,val);break;
+      opcase(0xc7): set(n,a); break;
+#ifdef Z80_THREADED
+   }while(0);
+#undef Z80_PAGE
+#define Z80_PAGE Z80_XPAGE
+#else
       }
    }
-   if(ixoriy)switch(reg){
+#endif
+   if(Z80_XMODE)switch(reg){
       case 0:b=val; break;
       case 1:c=val; break;
       case 2:d=val; break;
@@ -5,6 +5,15 @@
 
 typedef unsigned char  byte;
 
+/* Storage of the state of the emulated machine. The pico runs a single
+ * machine. The host build can run a machine on each of several threads,
+ * so there each thread has its own copy */
+#ifdef Z80_HOST
+#define MACHINE_STATE _Thread_local
+#else
+#define MACHINE_STATE
+#endif
+
 #ifdef LOAD_AND_SAVE
 
 /* ROM Patching */
@@ -32,7 +41,51 @@ typedef struct
     uint16_t   rstrtAddr;
 } RomPatches_T;
 
-extern RomPatches_T rom_patches;
+extern MACHINE_STATE RomPatches_T rom_patches;
+#endif
+
+#ifdef CALC_HLE
+/* ZX81 ROM calculator, run natively by calcops.h */
+#define CALC_RE_ENTRY       0x19a7      // LD ($401C),DE    ED 53 1C 40
+#define CALC_NEXT           0x19ab      // EXX              D9
+
+extern MACHINE_STATE bool calc_native;
+#endif
+
+#ifdef ROM_HLE
+/* ZX81 ROM routines run natively by romops.h, when reached by CALL or RET */
+#define ROM_HLE_DECODE      0           // 07BD DECODE
+#define ROM_HLE_MAKE_ROOM   1           // 099E MAKE-ROOM
+#define ROM_HLE_LINE_ADDR   2           // 09D8 LINE-ADDR
+#define ROM_HLE_CLS         3           // 0A2A CLS
+#define ROM_HLE_RECLAIM_1   4           // 0A5D RECLAIM-1
+#define ROM_HLE_RECLAIM_2   5           // 0A60 RECLAIM-2
+#define ROM_HLE_ROUTINES    6
+
+/* The routines to run natively, one bit each */
+#ifndef ROM_HLE_MASK
+#define ROM_HLE_MASK        0x3f
+#endif
+
+typedef struct
+{
+    uint16_t start;                     // address of the first instruction
+    uint16_t code[2][2];                // ROM the native version follows
+    const char* name;
+    bool enabled;
+    unsigned long calls;
+    unsigned long tstates;              // tstates of the native runs
+#ifdef ROM_HLE_VERIFY
+    unsigned long verified;
+    unsigned long mismatched;
+#endif
+} RomHLE_T;
+
+extern MACHINE_STATE RomHLE_T rom_hle[ROM_HLE_ROUTINES];
+extern MACHINE_STATE unsigned char rom_hle_map[0x2000 >> 3];
+
+/* True if an enabled native routine starts at x */
+#define ROM_HLE_AT(x) (((x) < 0x2000) && (rom_hle_map[(x) >> 3] & (1 << ((x) & 7))))
 #endif
 
 /* SOUND board types */
@@ -44,33 +97,42 @@ extern RomPatches_T rom_patches;
 
 #define MEMORYRAM_SIZE 0x10000
 
-extern unsigned char mem[MEMORYRAM_SIZE];
-extern unsigned char *memptr[64];
-extern int memattr[64];
-extern int sound_type;
-extern unsigned long tstates;
+/* Write handler for each 1K page */
+#define MEMWRITE_RAM  0
+#define MEMWRITE_ROM  1
+#define MEMWRITE_QS   2
+#define MEMWRITE_UDG  3
+#define MEMWRITE_WATCH 4    // RAM, while the idle loop detector looks for writes
+
+extern MACHINE_STATE unsigned char mem[MEMORYRAM_SIZE];
+extern MACHINE_STATE unsigned char *memptr[64];
+extern MACHINE_STATE unsigned char *memfetch[64];
+extern MACHINE_STATE unsigned char memdisplay[64];
+extern MACHINE_STATE unsigned char memwrite[64];
+extern MACHINE_STATE int sound_type;
+extern MACHINE_STATE unsigned long tstates;
 extern const unsigned long tsmax;
-extern int ramsize;
-extern int autoload;
-extern int zx80;
-extern int rom4k;
-extern bool m1not;
-extern bool useWRX;
-extern bool useQSUDG;
-extern bool UDGEnabled;
-extern bool LowRAM;
-extern bool chr128;
-extern bool useNTSC;
-extern bool frameSync;
-extern bool running_rom;
+extern MACHINE_STATE int ramsize;
+extern MACHINE_STATE int autoload;
+extern MACHINE_STATE int zx80;
+extern MACHINE_STATE int rom4k;
+extern MACHINE_STATE bool m1not;
+extern MACHINE_STATE bool useWRX;
+extern MACHINE_STATE bool useQSUDG;
+extern MACHINE_STATE bool UDGEnabled;
+extern MACHINE_STATE bool LowRAM;
+extern MACHINE_STATE bool chr128;
+extern MACHINE_STATE bool useNTSC;
+extern MACHINE_STATE bool frameSync;
+extern MACHINE_STATE bool running_rom;
 
 /* Chroma variables */
-extern int chromamode;
+extern MACHINE_STATE int chromamode;
 #ifdef SUPPORT_CHROMA
-extern unsigned char chroma_set;
-extern unsigned char bordercolour;
-extern unsigned char bordercolournew;
-extern unsigned char fullcolour;
+extern MACHINE_STATE unsigned char chroma_set;
+extern MACHINE_STATE unsigned char bordercolour;
+extern MACHINE_STATE unsigned char bordercolournew;
+extern MACHINE_STATE unsigned char fullcolour;
 #endif
 
 #ifdef __cplusplus
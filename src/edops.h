@@ -19,7 +19,7 @@
 #define input(var) {  unsigned short u;\
                       var=u=in(b,c);\
                       tstates+=u>>8;\
-                      f=(f&1)|(var&0xa8)|((!var)<<6)|parity(var);\
+                      f=(getf()&1)|szptable[var];\
                    }
 #define sbchl(x) {    unsigned short z=(x);\
                       unsigned long t=(hl-z-cy)&0x1ffff;\
@@ -41,14 +41,27 @@
                       h=t>>8;\
                  }
 
-#define neg (a=-a,\
-            f=(a&0xa8)|((!a)<<6)|(((a&15)>0)<<4)|((a==128)<<2)|2|(a>0))
+/* Repeat a block instruction without returning to the exec loop, as long
+ * as the next iteration (21 tstates) stays within limit, the frame does
+ * not end and no maskable interrupt would be accepted */
+#define blockrepeat(limit) (tstates<tsmax && tstates+21<=(limit) && \
+                            !(iff1 && !((radjust-1)&0x40)))
+
+#define neg (a=-a,lazyf=LAZY_NONE,\
+            f=sztable[a]|(((a&15)>0)<<4)|((a==128)<<2)|2|(a>0))
 
 {
-   unsigned char op=fetchm(pc);
+   unsigned char edop=fetchm(pc);
    pc++;
    radjust++;
-   switch(op){
+#ifdef Z80_THREADED
+#undef Z80_PAGE
+#define Z80_PAGE ed_
+   do{
+   goto *ed_ops[edop];
+#else
+   switch(edop){
+#endif
 instr(0x40,8);
    input(b);
 endinstr;
@@ -138,6 +151,9 @@ instr(0x53,16);
    {unsigned short addr=fetch2(pc);
     pc+=2;
     store2b(addr,d,e);
+#ifdef CALC_HLE
+    if ((pc == CALC_NEXT) && calc_native) tstore += calculateROM(tstore);
+#endif
    }
 endinstr;
 
@@ -155,7 +171,7 @@ endinstr;
 
 instr(0x57,5);
    a=i;
-   f=(f&1)|(a&0xa8)|((!a)<<6)|(iff2<<2);
+   f=(getf()&1)|sztable[a]|(iff2<<2);
 endinstr;
 
 instr(0x58,8);
@@ -193,7 +209,7 @@ endinstr;
 instr(0x5f,5);
    r=(r&0x80)|(radjust&0x7f);
    a=r;
-   f=(f&1)|(a&0xa8)|((!a)<<6)|(iff2<<2);
+   f=(getf()&1)|sztable[a]|(iff2<<2);
 endinstr;
 
 instr(0x60,8);
@@ -232,7 +248,7 @@ instr(0x67,14);
     unsigned char u=(a<<4)|(t>>4);
     a=(a&0xf0)|(t&0x0f);
     store(hl,u);
-    f=(f&1)|(a&0xa8)|((!a)<<6)|parity(a);
+    f=(getf()&1)|szptable[a];
    }
 endinstr;
 
@@ -273,7 +289,7 @@ instr(0x6f,5);
     unsigned char u=(a&0x0f)|(t<<4);
     a=(a&0xf0)|(t>>4);
     store(hl,u);
-    f=(f&1)|(a&0xa8)|((!a)<<6)|parity(a);
+    f=(getf()&1)|szptable[a];
    }
 endinstr;
 
@@ -345,7 +361,7 @@ instr(0xa0,12);
     if(!++l)h++;
     if(!++e)d++;
     if(!c--)b--;
-    f=(f&0xc1)|(x&0x28)|(((b|c)>0)<<2);
+    f=(getf()&0xc1)|(x&0x28)|(((b|c)>0)<<2);
    }
 endinstr;
 
@@ -354,7 +370,7 @@ instr(0xa1,12);
     cpa(fetch(hl));
     if(!++l)h++;
     if(!c--)b--;
-    f=(f&0xfa)|carry|(((b|c)>0)<<2);
+    f=(getf()&0xfa)|carry|(((b|c)>0)<<2);
    }
 endinstr;
 
@@ -364,6 +380,7 @@ instr(0xa2,12);
     tstates+=t>>8;
     if(!++l)h++;
     b--;
+    lazyf=LAZY_NONE;
     f=(b&0xa8)|((b>0)<<6)|2|((parity(b)^c)&4);
    }
 endinstr;
@@ -376,7 +393,7 @@ instr(0xa3,12); /* I can't determine the correct flags outcome for the
     out(b,c,x);
     if(!++l)h++;
     b--;
-    f=(f&1)|0x12|(b&0xa8)|((b==0)<<6);
+    f=(getf()&1)|0x12|(b&0xa8)|((b==0)<<6);
    }
 endinstr;
 
@@ -386,7 +403,7 @@ instr(0xa8,12);
     if(!l--)h--;
     if(!e--)d--;
     if(!c--)b--;
-    f=(f&0xc1)|(x&0x28)|(((b|c)>0)<<2);
+    f=(getf()&0xc1)|(x&0x28)|(((b|c)>0)<<2);
    }
 endinstr;
 
@@ -395,7 +412,7 @@ instr(0xa9,12);
     cpa(fetch(hl));
     if(!l--)h--;
     if(!c--)b--;
-    f=(f&0xfa)|carry|(((b|c)>0)<<2);
+    f=(getf()&0xfa)|carry|(((b|c)>0)<<2);
    }
 endinstr;
 
@@ -405,6 +422,7 @@ instr(0xaa,12);
     tstates+=t>>8;
     if(!l--)h--;
     b--;
+    lazyf=LAZY_NONE;
     f=(b&0xa8)|((b>0)<<6)|2|((parity(b)^c^4)&4);
    }
 endinstr;
@@ -414,7 +432,7 @@ instr(0xab,12);
     out(b,c,x);
     if(!l--)h--;
     b--;
-    f=(f&1)|0x12|(b&0xa8)|((b==0)<<6);
+    f=(getf()&1)|0x12|(b&0xa8)|((b==0)<<6);
    }
 endinstr;
 
@@ -422,23 +440,46 @@ endinstr;
    to change this... */
 
 instr(0xb0,12);
-   {unsigned char x=fetch(hl);
-    store(de,x);
-    if(!++l)h++;
-    if(!++e)d++;
-    if(!c--)b--;
-    f=(f&0xc1)|(x&0x28)|(((b|c)>0)<<2);
-    if(b|c)pc-=2,tstates+=5;
+   {unsigned long limit=eventLimit(tstore);
+    unsigned short start=pc-2;
+    /* The bytes the instruction is fetched from, which are not at start
+       for code mirrored into 0xC000-0xFFFF with M1NOT */
+    const unsigned char* op0=&fetchm(start);
+    const unsigned char* op1=&fetchm((unsigned short)(start+1));
+    unsigned char x;
+    for(;;){
+       unsigned short dst=de;
+       x=fetch(hl);
+       store(dst,x);
+       if(!++l)h++;
+       if(!++e)d++;
+       if(!c--)b--;
+       if(!(b|c))break;
+       tstates+=5;
+       /* Stop if the instruction has overwritten itself */
+       {const unsigned char* w=&memptr[dst>>10][dst&0x3FF];
+        if(!blockrepeat(limit) || w==op0 || w==op1){pc-=2;break;}}
+       tstates+=16;
+       radjust+=2;
+    }
+    f=(getf()&0xc1)|(x&0x28)|(((b|c)>0)<<2);
    }
 endinstr;
 
 instr(0xb1,12);
-   {unsigned char carry=cy;
-    cpa(fetch(hl));
-    if(!++l)h++;
-    if(!c--)b--;
-    f=(f&0xfa)|carry|(((b|c)>0)<<2);
-    if((f&0x44)==4)pc-=2,tstates+=5;
+   {unsigned long limit=eventLimit(tstore);
+    unsigned char carry=cy;
+    for(;;){
+       cpa(fetch(hl));
+       if(!++l)h++;
+       if(!c--)b--;
+       f=(getf()&0xfa)|carry|(((b|c)>0)<<2);
+       if((getf()&0x44)!=4)break;
+       tstates+=5;
+       if(!blockrepeat(limit)){pc-=2;break;}
+       tstates+=16;
+       radjust+=2;
+    }
    }
 endinstr;
 
@@ -448,6 +489,7 @@ instr(0xb2,12);
     tstates+=t>>8;
     if(!++l)h++;
     b--;
+    lazyf=LAZY_NONE;
     f=(b&0xa8)|((b>0)<<6)|2|((parity(b)^c)&4);
     if(b)pc-=2,tstates+=5;
    }
@@ -458,29 +500,52 @@ instr(0xb3,12);
     out(b,c,x);
     if(!++l)h++;
     b--;
-    f=(f&1)|0x12|(b&0xa8)|((b==0)<<6);
+    f=(getf()&1)|0x12|(b&0xa8)|((b==0)<<6);
     if(b)pc-=2,tstates+=5;
    }
 endinstr;
 
 instr(0xb8,12);
-   {unsigned char x=fetch(hl);
-    store(de,x);
-    if(!l--)h--;
-    if(!e--)d--;
-    if(!c--)b--;
-    f=(f&0xc1)|(x&0x28)|(((b|c)>0)<<2);
-    if(b|c)pc-=2,tstates+=5;
+   {unsigned long limit=eventLimit(tstore);
+    unsigned short start=pc-2;
+    /* The bytes the instruction is fetched from, which are not at start
+       for code mirrored into 0xC000-0xFFFF with M1NOT */
+    const unsigned char* op0=&fetchm(start);
+    const unsigned char* op1=&fetchm((unsigned short)(start+1));
+    unsigned char x;
+    for(;;){
+       unsigned short dst=de;
+       x=fetch(hl);
+       store(dst,x);
+       if(!l--)h--;
+       if(!e--)d--;
+       if(!c--)b--;
+       if(!(b|c))break;
+       tstates+=5;
+       /* Stop if the instruction has overwritten itself */
+       {const unsigned char* w=&memptr[dst>>10][dst&0x3FF];
+        if(!blockrepeat(limit) || w==op0 || w==op1){pc-=2;break;}}
+       tstates+=16;
+       radjust+=2;
+    }
+    f=(getf()&0xc1)|(x&0x28)|(((b|c)>0)<<2);
    }
 endinstr;
 
 instr(0xb9,12);
-   {unsigned char carry=cy;
-    cpa(fetch(hl));
-    if(!l--)h--;
-    if(!c--)b--;
-    f=(f&0xfa)|carry|(((b|c)>0)<<2);
-    if((f&0x44)==4)pc-=2,tstates+=5;
+   {unsigned long limit=eventLimit(tstore);
+    unsigned char carry=cy;
+    for(;;){
+       cpa(fetch(hl));
+       if(!l--)h--;
+       if(!c--)b--;
+       f=(getf()&0xfa)|carry|(((b|c)>0)<<2);
+       if((getf()&0x44)!=4)break;
+       tstates+=5;
+       if(!blockrepeat(limit)){pc-=2;break;}
+       tstates+=16;
+       radjust+=2;
+    }
    }
 endinstr;
 
@@ -490,6 +555,7 @@ instr(0xba,12);
     tstates+=t>>8;
     if(!l--)h--;
     b--;
+    lazyf=LAZY_NONE;
     f=(b&0xa8)|((b>0)<<6)|2|((parity(b)^c^4)&4);
     if(b)pc-=2,tstates+=5;
    }
@@ -500,7 +566,7 @@ instr(0xbb,12);
     out(b,c,x);
     if(!l--)h--;
     b--;
-    f=(f&1)|0x12|(b&0xa8)|((b==0)<<6);
+    f=(getf()&1)|0x12|(b&0xa8)|((b==0)<<6);
     if(b)pc-=2,tstates+=5;
    }
 endinstr;
@@ -517,7 +583,16 @@ instr(0xfd,4);
 endinstr;
 #endif
 
+#ifdef Z80_THREADED
+ed_default: tstates+=4;
+
+   }while(0);
+#undef Z80_PAGE
+#define Z80_PAGE op_
+}
+#else
 default: tstates+=4;
 
 }}
+#endif
 
@@ -278,6 +278,7 @@ typedef struct
   ComputerType_T computer;
   bool NTSC;
   uint16_t VTol;
+  int turbo;
   bool centre;
   bool WRX;
   bool QSUDG;
@@ -403,6 +404,11 @@ uint16_t emu_VTol(void)
   return specific.VTol;
 }
 
+int emu_TurboRequested(void)
+{
+  return specific.turbo;
+}
+
 bool emu_WRXRequested(void)
 {
   // WRX always enabled if no memory expansion
@@ -714,6 +720,12 @@ void emu_SetWRX(bool wrx)
   specific.WRX = wrx;
 }
 
+void emu_SetTurbo(int turbo)
+{
+  general.turbo = turbo;
+  specific.turbo = turbo;
+}
+
 void emu_SetCentre(bool centre)
 {
   general.centre = centre;
@@ -964,6 +976,12 @@ static int handler(void *user, const char *section, const char *name,
       }
       c->conf->VTol = (uint16_t)res;
     }
+    else if (!strcasecmp(name, "Turbo"))
+    {
+      // CPU clock multiplier, 1, 2 or 4. Any other value is treated as 1
+      long res=strtol(value, NULL, 10);
+      c->conf->turbo = ((res == 2) || (res == 4)) ? (int)res : 1;
+    }
     else if (!strcasecmp(name, "Centre"))
     {
       // Defaults to on, set to Off or 0 to turn off
@@ -1179,6 +1197,7 @@ void emu_ReadDefaultValues(void)
     general.memory = 16;
     general.NTSC = false;
     general.VTol = VTOL;
+    general.turbo = 1;
     general.centre = true;
     general.doubleShift = true;
     general.extendFile = true;
@@ -1296,7 +1315,7 @@ void emu_ReadSpecificValues(const char *filename)
  * Snapshot
  ********************************/
 #define SNAPSHOT_ID       0x50414E53          // Little endian 'SNAP'
-#define SUPPORTED_VERSION 0x00010001          // Major and minor versions
+#define SUPPORTED_VERSION 0x00010003          // Major and minor versions
 #define SECOND_OFFSET     57                  // Start of second data section
 
 #ifdef __cplusplus
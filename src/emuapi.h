@@ -76,6 +76,7 @@ extern bool emu_loadUsingROMRequested(void);
 extern bool emu_saveUsingROMRequested(void);
 extern int emu_MenuBorderRequested(void);
 extern uint16_t emu_VTol(void);
+extern int emu_TurboRequested(void);
 extern bool emu_ACBRequested(void);
 extern bool emu_ACBPossible(void);
 extern bool emu_Centre(void);
@@ -101,6 +102,7 @@ extern void emu_SetFrameSync(FrameSync_T fsync);
 extern void emu_SetNTSC(bool ntsc);
 extern void emu_SetVTol(uint16_t vTol);
 extern void emu_SetWRX(bool wrx);
+extern void emu_SetTurbo(int turbo);
 extern void emu_SetCentre(bool centre);
 extern void emu_SetSound(int soundType);
 extern void emu_SetACB(bool stereo);
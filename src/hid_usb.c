@@ -470,6 +470,9 @@ bool hidReadUsbKeyboard(uint8_t* special, bool usedouble)
             {
                 // Check for non Sinclair keys here:
                 if (((report.keycode[i] >= HID_KEY_F1) && (report.keycode[i] <= HID_KEY_F9)) ||
+#ifdef Z80_TRACE
+                    (report.keycode[i] == HID_KEY_F10) ||
+#endif
                     (report.keycode[i] == HID_KEY_ESCAPE))
                 {
                     *special = report.keycode[i];
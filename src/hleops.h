@@ -0,0 +1,486 @@
+/* Native execution of ZX81 ROM routines.
+ *
+ * The routines in calcops.h (the floating point calculator) and romops.h
+ * (the hot routines of the BASIC interpreter) are written out instruction
+ * by instruction, on the real registers and memory, so that the flags,
+ * the stack contents, R and the tstates are exactly those the ROM would
+ * leave. Only the instruction fetch and decode is saved. A path which is
+ * not written out, or an error exit, hands back to the ROM at that
+ * address, with the state the ROM would have there.
+ *
+ * The routines only run while the display is off (FAST mode), with
+ * interrupts disabled. The ULA is stepped for each instruction as it is
+ * for the ROM, so the sync and display state also follow, and a routine
+ * or literal hands back to the ROM once the frame is about to end.
+ *
+ * With CALC_VERIFY or ROM_HLE_VERIFY each native run is repeated by the
+ * ROM from the same state, and any difference in the registers, tstates,
+ * instruction timings or memory is reported.
+ *
+ * Included in z80.c after z80_op, for the instruction macros */
+
+#undef Z80_XMODE
+#define Z80_XMODE 0
+
+#if defined(CALC_VERIFY) || defined(ROM_HLE_VERIFY)
+#define HLE_VERIFY
+#endif
+
+#ifdef HLE_VERIFY
+#define HLE_VERIFY_LOG  0x8000
+
+/* The tstates of each instruction of a native run, to compare with the
+ * ROM. Negative when not logging */
+static MACHINE_STATE unsigned char hle_log[HLE_VERIFY_LOG];
+static MACHINE_STATE long hle_logged = -1;
+#endif
+
+/* The instruction whose tstates the ULA has still to step, and whether it
+ * runs in turbo. The ULA runs one instruction behind, so that the exec
+ * loop steps the last, as for the ROM */
+static MACHINE_STATE unsigned long hle_pending;
+static MACHINE_STATE bool hle_turbo;
+
+static void hleTick(unsigned long t)
+{
+  tstates += t;
+#ifdef HLE_VERIFY
+  if (hle_logged >= 0)
+  {
+    if (hle_logged < HLE_VERIFY_LOG)
+      hle_log[hle_logged] = t;
+    hle_logged++;
+  }
+#endif
+  ts = hle_pending;
+  if (hle_turbo)
+  {
+    turbo_frac += ts;
+    ts = turbo_frac >> turbo_shift;
+    turbo_frac -= ts << turbo_shift;
+    tstates -= hle_pending - ts;
+  }
+  syncInstruction();
+  hle_pending = t;
+  hle_turbo = turbo_shift && turboAllowed();
+}
+
+/* Start a native run, in the instruction begun at tstore */
+static void hleStart(unsigned long tstore)
+{
+  hle_pending = tstates - tstore;
+  hle_turbo = turbo_shift && turboAllowed();
+}
+
+/* End a native run, in the instruction begun at tstore, for which the
+ * exec loop took the turbo state turbo. Returns the tstates the ULA has
+ * stepped, leaving the last instruction for the exec loop */
+static unsigned long hleEnd(unsigned long tstore, bool turbo)
+{
+  if (hle_turbo && !turbo)
+  {
+    // Scaled here, as the exec loop does not
+    unsigned long cpu_ts = hle_pending;
+
+    turbo_frac += cpu_ts;
+    hle_pending = turbo_frac >> turbo_shift;
+    turbo_frac -= hle_pending << turbo_shift;
+    tstates -= cpu_ts - hle_pending;
+  }
+  else if (!hle_turbo && turbo)
+  {
+    // Scaled by the exec loop back to what it is
+    tstates += (hle_pending << turbo_shift) - hle_pending;
+    hle_pending <<= turbo_shift;
+  }
+  return tstates - tstore - hle_pending;
+}
+
+/* tstates and R for an unprefixed, and a CB, ED or index prefixed,
+ * instruction */
+#define cost(t)   (radjust++,hleTick(t))
+#define cost2(t)  (radjust+=2,hleTick(t))
+
+/* RET, conditional RET, CALL and conditional CALL of a routine which is
+ * also written out. The routines return false once the ROM is to take
+ * over, with pc set */
+#define cret()          do{sp+=2;cost(10);return true;}while(0)
+#define cretif(cond)    do{if(cond){sp+=2;cost(11);return true;}cost(5);}while(0)
+#define ccall(next,fn)  do{push2(next);cost(17);if(!(fn))return false;}while(0)
+#define ccallif(cond,next,fn) do{if(cond)ccall(next,fn);else cost(10);}while(0)
+#define cexit(addr)     do{pc=(addr);return false;}while(0)
+
+/* More tstates than a ROM routine runs between two checks of cstep, so
+ * that it cannot pass the end of the frame */
+#define HLE_STEP        512
+#define cstep(addr)     do{if(tstates+HLE_STEP>=tsexit)cexit(addr);}while(0)
+
+/* LDIR, LDDR and CPIR at addr, which hand back to the ROM there between
+ * two iterations */
+#define cblock(fn)      do{if(!(fn))return false;}while(0)
+
+/* JR cc and DJNZ, true when taken */
+#define cjr(cond)   ((cond)?(cost(12),1):(cost(7),0))
+#define cdjnz()     (--b?(cost(13),1):(cost(8),0))
+
+#define zf  (getf()&0x40)
+#define sf  (getf()&0x80)
+#define pvf (getf()&0x04)
+
+#define exx()     do{swap(b,b1);swap(c,c1);swap(d,d1);swap(e,e1);\
+                     swap(h,h1);swap(l,l1);}while(0)
+#define exdehl()  do{swap(d,h);swap(e,l);}while(0)
+#define exsphl()  do{unsigned short t=fetch2(sp);store2b(sp,h,l);\
+                     l=t;h=t>>8;}while(0)
+
+#define incbc()   do{if(!++c)b++;}while(0)
+#define inchl()   do{if(!++l)h++;}while(0)
+#define dechl()   do{if(!l--)h--;}while(0)
+#define incde()   do{if(!++e)d++;}while(0)
+#define decde()   do{if(!e--)d--;}while(0)
+#define incm()    do{unsigned char t=fetch(hl);inc(t);store(hl,t);}while(0)
+#define decm()    do{unsigned char t=fetch(hl);dec(t);store(hl,t);}while(0)
+#define decat(x)  do{unsigned char t=fetch(x);dec(t);store(x,t);}while(0)
+
+/* The accumulator rotates and flag operations, as in z80ops.h */
+#define rlca()  (a=(a<<1)|(a>>7),f=(getf()&0xc4)|(a&0x29))
+#define rrca()  (f=(getf()&0xc4)|(a&1),a=(a>>1)|(a<<7),f|=a&0x28)
+#define rla()   do{int t=a>>7;a=(a<<1)|(getf()&1);\
+                   f=(getf()&0xc4)|(a&0x28)|t;}while(0)
+#define rra()   do{int t=a&1;a=(a>>1)|(getf()<<7);\
+                   f=(getf()&0xc4)|(a&0x28)|t;}while(0)
+#define cpl()   (a=~a,f=(getf()&0xc5)|(a&0x28)|0x12)
+#define scf()   (f=(getf()&0xc4)|1|(a&0x28))
+#define ccf()   (f=(getf()&0xc4)|(cy^1)|(cy<<4)|(a&0x28))
+
+/* The CB operations used, as in cbops.h. The at forms are for (HL) and
+ * (IY+d) */
+#define rflags(x,c) (lazyf=LAZY_NONE,f=(c)|szptable[x])
+#define rl(x)   do{unsigned char t=x>>7;x=(x<<1)|(getf()&1);rflags(x,t);}while(0)
+#define rr(x)   do{unsigned char t=x&1;x=(x>>1)|(getf()<<7);rflags(x,t);}while(0)
+#define sla(x)  do{unsigned char t=x>>7;x<<=1;rflags(x,t);}while(0)
+#define sra(x)  do{unsigned char t=x&1;x=((signed char)x)>>1;rflags(x,t);}while(0)
+#define srl(x)  do{unsigned char t=x&1;x>>=1;rflags(x,t);}while(0)
+#define bit(n,x) (f=(getf()&1)|((x&(1<<n))?0x10:0x54)|(x&0x28))
+#define rrm()   do{unsigned char v=fetch(hl);rr(v);store(hl,v);}while(0)
+#define rlm()   do{unsigned char v=fetch(hl);rl(v);store(hl,v);}while(0)
+#define bitat(n,x) do{unsigned char v=fetch(x);bit(n,v);}while(0)
+#define setat(n,x) store(x,fetch(x)|(1<<(n)))
+#define resat(n,x) store(x,fetch(x)&~(1<<(n)))
+#define bitm(n) bitat(n,hl)
+#define setm(n) setat(n,hl)
+#define resm(n) resat(n,hl)
+
+/* LDIR, 21 tstates for each byte but the last */
+static bool hleLdir(unsigned short addr)
+{
+  unsigned char x;
+
+  for (;;)
+  {
+    x = fetch(hl);
+    store(de, x);
+    inchl();
+    incde();
+    if (!c--) b--;
+    if (!(b | c)) break;
+    cost2(21);
+    if (tstates + HLE_STEP >= tsexit)
+    {
+      f = (getf() & 0xc1) | (x & 0x28) | 4;
+      cexit(addr);
+    }
+  }
+  cost2(16);
+  f = (getf() & 0xc1) | (x & 0x28);
+  return true;
+}
+
+#ifdef ROM_HLE
+/* LDDR, 21 tstates for each byte but the last */
+static bool hleLddr(unsigned short addr)
+{
+  unsigned char x;
+
+  for (;;)
+  {
+    x = fetch(hl);
+    store(de, x);
+    dechl();
+    decde();
+    if (!c--) b--;
+    if (!(b | c)) break;
+    cost2(21);
+    if (tstates + HLE_STEP >= tsexit)
+    {
+      f = (getf() & 0xc1) | (x & 0x28) | 4;
+      cexit(addr);
+    }
+  }
+  cost2(16);
+  f = (getf() & 0xc1) | (x & 0x28);
+  return true;
+}
+
+/* CPIR, 21 tstates for each byte but the last */
+static bool hleCpir(unsigned short addr)
+{
+  unsigned char carry = cy;
+
+  for (;;)
+  {
+    cpa(fetch(hl));
+    inchl();
+    if (!c--) b--;
+    f = (getf() & 0xfa) | carry | (((b | c) > 0) << 2);
+    if ((getf() & 0x44) != 4) break;
+    cost2(21);
+    if (tstates + HLE_STEP >= tsexit)
+      cexit(addr);
+  }
+  cost2(16);
+  return true;
+}
+#endif
+
+/* 0EC5 TEST-ROOM, for BC bytes */
+static bool hleTestRoom(void)
+{
+  cstep(0x0ec5);
+  h = fetch(0x401d); l = fetch(0x401c); cost(16);   // ld hl,(STKEND)
+  addhl(b, c); cost(11);                            // add hl,bc
+  if (cjr(cy)) cexit(0x0ed3);                       // jr c,REPORT-4
+  exdehl(); cost(4);                                // ex de,hl
+  h = 0x00; l = 0x24; cost(10);                     // ld hl,0024
+  addhl(d, e); cost(11);                            // add hl,de
+  sbchl(sp); cost2(15);                             // sbc hl,sp
+  cretif(cy);                                       // ret c
+  cexit(0x0ed3);
+}
+
+#ifdef HLE_VERIFY
+#define HLE_VERIFY_INSTRUCTIONS 1000000
+#define HLE_VERIFY_REPORTS      20
+#define HLE_VERIFY_BYTES        0x4000
+
+/* Memory compared after a native run */
+typedef struct
+{
+  unsigned short start;
+  unsigned short length;
+} HleWindow_T;
+
+static MACHINE_STATE bool hle_verifying = false;
+static MACHINE_STATE unsigned long hle_reports = 0;
+
+static int hleSave(const HleWindow_T* window, int windows, unsigned char* buf)
+{
+  int count = 0;
+
+  for (int w = 0; w < windows; w++)
+    for (int n = 0; n < window[w].length; n++)
+      buf[count++] = fetch((unsigned short)(window[w].start + n));
+  return count;
+}
+
+static void hleRestore(const HleWindow_T* window, int windows, const unsigned char* buf)
+{
+  for (int w = 0; w < windows; w++)
+    for (int n = 0; n < window[w].length; n++)
+      store((unsigned short)(window[w].start + n), *buf++);
+}
+
+#define HLE_REGISTERS  22
+
+static const char* const hle_register_names[HLE_REGISTERS] = {
+  "a", "f", "b", "c", "d", "e", "h", "l",
+  "a'", "f'", "b'", "c'", "d'", "e'", "h'", "l'",
+  "r", "radjust", "pc", "sp", "ix", "iy"
+};
+
+static void hleRegisters(unsigned short* v)
+{
+  v[0] = a; v[1] = getf(); v[2] = b; v[3] = c;
+  v[4] = d; v[5] = e; v[6] = h; v[7] = l;
+  v[8] = a1; v[9] = f1; v[10] = b1; v[11] = c1;
+  v[12] = d1; v[13] = e1; v[14] = h1; v[15] = l1;
+  v[16] = r; v[17] = radjust; v[18] = pc; v[19] = sp;
+  v[20] = ix; v[21] = iy;
+}
+
+static void hleReport(const char* label, const char* what, unsigned long native, unsigned long rom)
+{
+  if (hle_reports++ < HLE_VERIFY_REPORTS)
+    printf("%s: %s native %lx rom %lx\n", label, what, native, rom);
+}
+
+/* Run natively, then again in the ROM from the same state, up to the
+ * same pc and sp (and tstates, for a loop left part way). The ROM result
+ * is kept, but the ULA is only stepped by the native run, so the timings
+ * of its instructions are compared instead. Returns false, after
+ * reporting the differences, if the results are not the same, or if the
+ * native run reached the end of the frame */
+static bool hleVerify(void (*native)(void), const HleWindow_T* window, int windows,
+                      const char* label)
+{
+  static MACHINE_STATE unsigned char before[HLE_VERIFY_BYTES];
+  static MACHINE_STATE unsigned char after[HLE_VERIFY_BYTES];
+  unsigned short nat[HLE_REGISTERS], rom[HLE_REGISTERS];
+  Z80State_T cpu_before, cpu_native, cpu_rom;
+  unsigned long ts_before, ts_native, ts_cpu;
+  unsigned short stop_pc, stop_sp;
+  bool same = true;
+  long n, logged;
+  int w, bytes;
+
+  getf();
+  cpu_before = zx.cpu;
+  ts_before = tstates;
+  bytes = hleSave(window, windows, before);
+
+  hle_logged = 0;
+  native();
+  logged = hle_logged;
+  hle_logged = -1;
+  getf();
+  cpu_native = zx.cpu;
+  stop_pc = pc;
+  stop_sp = sp;
+  ts_native = tstates;
+  hleSave(window, windows, after);
+
+  // In turbo tstates runs slower than the ROM counts it
+  ts_cpu = ts_before;
+  for (n = 0; (n < logged) && (n < HLE_VERIFY_LOG); n++)
+    ts_cpu += hle_log[n];
+
+  zx.cpu = cpu_before;
+  tstates = ts_before;
+  hleRestore(window, windows, before);
+
+  hle_verifying = true;
+  for (n = 0; ((pc != stop_pc) || (sp != stop_sp) || (tstates < ts_cpu)) &&
+              (n < HLE_VERIFY_INSTRUCTIONS); n++)
+  {
+    unsigned long t;
+
+    op = fetchm(pc);
+    t = z80_op();
+    if (same && ((n >= logged) || (n >= HLE_VERIFY_LOG) || (hle_log[n] != t)))
+    {
+      hleReport(label, "instruction tstates", (n < logged) && (n < HLE_VERIFY_LOG) ? hle_log[n] : 0, t);
+      same = false;
+    }
+  }
+  hle_verifying = false;
+  if (n != logged)
+  {
+    hleReport(label, "instructions", logged, n);
+    same = false;
+  }
+  getf();
+  cpu_rom = zx.cpu;
+
+  hleRegisters(rom);
+  zx.cpu = cpu_native;
+  hleRegisters(nat);
+  zx.cpu = cpu_rom;
+
+  for (n = 0; n < HLE_REGISTERS; n++)
+  {
+    if (rom[n] != nat[n])
+    {
+      hleReport(label, hle_register_names[n], nat[n], rom[n]);
+      same = false;
+    }
+  }
+
+  if (tstates != ts_cpu)
+  {
+    hleReport(label, "tstates", ts_cpu - ts_before, tstates - ts_before);
+    same = false;
+  }
+  tstates = ts_native;
+
+  if (ts_native >= tsexit)
+  {
+    hleReport(label, "frame end", ts_native, tsexit);
+    same = false;
+  }
+
+  // Report the first memory difference
+  hleSave(window, windows, before);
+  for (n = 0, w = 0; n < bytes; w++)
+  {
+    for (int k = 0; k < window[w].length; k++, n++)
+    {
+      if (before[n] != after[n])
+      {
+        char what[12];
+
+        snprintf(what, sizeof(what), "(%04x)", (unsigned short)(window[w].start + k));
+        hleReport(label, what, after[n], before[n]);
+        return false;
+      }
+    }
+  }
+  return same;
+}
+#endif
+
+#ifdef CALC_HLE
+#include "calcops.h"
+#endif
+
+#ifdef ROM_HLE
+#include "romops.h"
+#endif
+
+#undef cost
+#undef cost2
+#undef cret
+#undef cretif
+#undef ccall
+#undef ccallif
+#undef cexit
+#undef HLE_STEP
+#undef cstep
+#undef cblock
+#undef cjr
+#undef cdjnz
+#undef zf
+#undef sf
+#undef pvf
+#undef exx
+#undef exdehl
+#undef exsphl
+#undef incbc
+#undef inchl
+#undef dechl
+#undef incde
+#undef decde
+#undef incm
+#undef decm
+#undef decat
+#undef rlca
+#undef rrca
+#undef rla
+#undef rra
+#undef cpl
+#undef scf
+#undef ccf
+#undef rflags
+#undef rl
+#undef rr
+#undef sla
+#undef sra
+#undef srl
+#undef bit
+#undef rrm
+#undef rlm
+#undef bitat
+#undef setat
+#undef resat
+#undef bitm
+#undef setm
+#undef resm
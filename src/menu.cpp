@@ -8,6 +8,7 @@
 #include "zx80rom.h"
 #include "zx81rom.h"
 #include "zx8x.h"
+#include "z80.h"
 
 #include "hid_usb.h"
 #include "display.h"
@@ -23,12 +24,13 @@ typedef enum
     PCENTRE = PNTSC + PINCF6,
     PVTOL = PCENTRE + PINCF6,
     PWRX = PVTOL + PINCF6,
+    PTURBO = PWRX + PINCF6,
 #ifndef PICO_NO_SOUND
-    PSOUNDTYPE = PWRX + PINCF6,
+    PSOUNDTYPE = PTURBO + PINCF6,
     PSTEREOACB = PSOUNDTYPE + PINCF6,
     PBOTTOMF6 = PSTEREOACB
 #else
-    PBOTTOMF6 = PWRX
+    PBOTTOMF6 = PTURBO
 #endif
 } PositionF6_T;
 
@@ -58,6 +60,7 @@ typedef struct
     bool        centre;
     uint16_t    vTol;
     bool        wrx;
+    int         turbo;
     uint16_t    sound;
     bool        stereo;
 } ModifyF6_T;
@@ -447,6 +450,228 @@ bool saveMenu(char* save, uint length, bool zx80)
     return (change);
 }
 
+#ifdef PC_PROFILE
+#define PC_PROFILE_ROWS 16
+
+// Displays the routines where the sampled PC was found most often
+static void showPcProfile(const char* message)
+{
+    PcProfileEntry_T top[PC_PROFILE_ROWS];
+    uint32_t total;
+    uint lcount = (disp.height >> 4) - 14;
+    int lhs = (disp.width >> 4) - 10;
+    int rhs = lhs + 13;
+    char c[20];
+    int entries = z80_pcProfileTop(top, PC_PROFILE_ROWS, &total);
+
+    memset(menuscreen, 0x00, disp.stride_byte * disp.height);
+    writeString("PC Profile", lhs + 5, lcount++);
+    writeString("==========", lhs + 5, lcount++);
+
+    writeString("Samples:", lhs, ++lcount);
+    sprintf(c, "%lu", (unsigned long)total);
+    writeString(c, rhs, lcount++);
+    ++lcount;
+
+    for (int i = 0; i < entries; ++i)
+    {
+        if (top[i].name)
+        {
+            writeString(top[i].name, lhs, lcount);
+        }
+        else
+        {
+            sprintf(c, "%s %04X", (top[i].addr < 0x2000) ? "ROM" : "RAM", top[i].addr);
+            writeString(c, lhs, lcount);
+        }
+        // Share in tenths, the font has no percent sign
+        uint32_t tenths = total ? (uint32_t)(((uint64_t)top[i].samples * 1000) / total) : 0;
+        sprintf(c, "%lu.%lu", (unsigned long)(tenths / 10), (unsigned long)(tenths % 10));
+        writeString(c, rhs, lcount++);
+    }
+
+    lcount = (disp.height >> 4) - 14 + PC_PROFILE_ROWS + 6;
+    writeString(message ? message : "S:Save Left:Clear", lhs, lcount);
+}
+#endif
+
+#ifdef Z80_BREAK
+static const char breakKinds[] = "-ERWIO";
+
+static char breakChar(int kind)
+{
+    for (int i = 0; i < 5; ++i)
+    {
+        if (kind == (1 << i))
+            return breakKinds[i + 1];
+    }
+    return breakKinds[0];
+}
+
+static int breakKind(char c)
+{
+    for (int i = 0; i < 5; ++i)
+    {
+        if (c == breakKinds[i + 1])
+            return (1 << i);
+    }
+    return 0;
+}
+
+// Displays the breakpoints being edited, with the cursor at col of slot
+static void showBreak(const uint8_t* kinds, const uint16_t* addrs, int slot, int col)
+{
+    BreakHit_T hit;
+    uint lcount = (disp.height >> 4) - 9;
+    int lhs = (disp.width >> 4) - 11;
+    char c[24];
+
+    memset(menuscreen, 0x00, disp.stride_byte * disp.height);
+    writeString("Breakpoints", lhs + 5, lcount++);
+    writeString("===========", lhs + 5, lcount++);
+    ++lcount;
+
+    if (z80_breakStopped(&hit))
+    {
+        sprintf(c, "%c %04X PC %04X", breakChar(hit.kind), hit.addr, hit.instr);
+        writeString(c, lhs, lcount++);
+        sprintf(c, "Line %d T %lu", hit.line, hit.tstates);
+        writeString(c, lhs, lcount++);
+    }
+    else
+    {
+        writeString("Running", lhs, lcount++);
+        ++lcount;
+    }
+    ++lcount;
+
+    for (int i = 0; i < BREAK_MAX; ++i)
+    {
+        sprintf(c, "%d %c %04X %lu", i, breakChar(kinds[i]), addrs[i], z80_breakGet(i)->hits);
+        writeString(c, lhs, lcount);
+        if (i == slot)
+        {
+            // Kind at column 0, then the 4 hex digits
+            invertChar(c[2 + col + (col ? 1 : 0)], lhs + 2 + col + (col ? 1 : 0), lcount);
+        }
+        ++lcount;
+    }
+    ++lcount;
+    writeString("E R W I O X:Kind  0-F:Addr", lhs - 2, lcount++);
+    writeString("New Line:Next  ESC:Run", lhs, lcount);
+}
+
+// Edits the execution, memory and port breakpoints, and continues
+// execution after a breakpoint is hit
+void breakMenu(void)
+{
+    uint8_t key = 0;
+    uint8_t lastKey = 4;
+    uint8_t kinds[BREAK_MAX];
+    uint16_t addrs[BREAK_MAX];
+    int slot = 0;
+    int col = 0;
+    bool exit = false;
+
+    if (!buildMenu(false))
+        return;
+
+    for (int i = 0; i < BREAK_MAX; ++i)
+    {
+        kinds[i] = z80_breakGet(i)->kind;
+        addrs[i] = z80_breakGet(i)->addr;
+    }
+    showBreak(kinds, addrs, slot, col);
+
+    do
+    {
+        tuh_task();
+        hidSaveMenu(&key);
+
+        bool detected = (key != 0);
+
+        // Debounce keys
+        if (detected && (key == lastKey))
+        {
+            detected = false;
+        }
+        else if (!detected)
+        {
+            lastKey = 0;
+        }
+        else
+        {
+            lastKey = key;
+        }
+
+        if (detected)
+        {
+            switch (key)
+            {
+                case 2:     // Cursor right
+                    if (col < 4) col++;
+                break;
+
+                case 3:     // Cursor left
+                case 8:     // Backspace
+                    if (col > 0)
+                    {
+                        col--;
+                    }
+                    else if (key == 8)
+                    {
+                        kinds[slot] = 0;
+                    }
+                break;
+
+                case 4:     // Enter
+                    slot = (slot + 1) % BREAK_MAX;
+                    col = 0;
+                break;
+
+                case 27:    // Escape
+                    exit = true;
+                break;
+
+                default:
+                    if (col == 0)
+                    {
+                        if ((key == 'X') || breakKind(key))
+                        {
+                            kinds[slot] = breakKind(key);
+                            col = 1;
+                        }
+                    }
+                    else if (((key >= '0') && (key <= '9')) || ((key >= 'A') && (key <= 'F')))
+                    {
+                        int shift = (4 - col) << 2;
+                        int digit = (key <= '9') ? (key - '0') : (key - 'A' + 10);
+
+                        addrs[slot] = (addrs[slot] & ~(0xf << shift)) | (digit << shift);
+                        if (col < 4) col++;
+                    }
+                break;
+            }
+            showBreak(kinds, addrs, slot, col);
+        }
+        emu_WaitFor50HzTimer();
+    } while (!exit);
+
+    debounceExit(false);
+
+    // Only set changed slots, so that the hit counts are kept
+    for (int i = 0; i < BREAK_MAX; ++i)
+    {
+        if ((kinds[i] != z80_breakGet(i)->kind) || (addrs[i] != z80_breakGet(i)->addr))
+        {
+            z80_breakSet(i, kinds[i], addrs[i]);
+        }
+    }
+    z80_breakResume();
+    endMenu(false);
+}
+#endif
+
 // Displays the status of the emulator, pausing execution
 // ESC to exit (f3)
 bool statusMenu(void)
@@ -585,10 +810,35 @@ bool statusMenu(void)
     //writeString("Fn Key Map:", lhs, ++lcount);
     //writeString(emu_DoubleShiftRequested() ? "Yes" : "No", rhs, lcount++);
 
+#ifdef PC_PROFILE
+    writeString("Right:PC Profile", lhs, ++lcount);
+    uint8_t last = 0;
+#endif
+
     do
     {
         tuh_task();
         hidNavigateMenu(&key);
+#ifdef PC_PROFILE
+        // Act once per key press
+        if (key != last)
+        {
+            if (key == HID_KEY_ARROW_RIGHT)
+            {
+                showPcProfile(NULL);
+            }
+            else if (key == HID_KEY_ARROW_LEFT)
+            {
+                z80_pcProfileReset();
+                showPcProfile(NULL);
+            }
+            else if (key == HID_KEY_S)
+            {
+                showPcProfile(z80_pcProfileDump() ? "Saved /pcprof.csv" : "Save failed");
+            }
+            last = key;
+        }
+#endif
         emu_WaitFor50HzTimer();
     } while ((key != HID_KEY_ESCAPE) && (key != HID_KEY_ENTER));
 
@@ -615,6 +865,9 @@ void pauseMenu(void)
 
     // Wait for Enter or ESC to be pressed - or to capture an image
     bool captured = false;
+#ifdef Z80_BREAK
+    bool breakpoints = false;
+#endif
 
     char bmp_path[MAX_FULLPATH_LEN];
 
@@ -701,9 +954,24 @@ void pauseMenu(void)
             }
             while (key == HID_KEY_S);
         }
+#ifdef Z80_BREAK
+        else if (key == HID_KEY_ARROW_RIGHT)
+        {
+            breakpoints = true;
+            break;
+        }
+#endif
         emu_WaitFor50HzTimer();
     } while ((key != HID_KEY_ENTER) && (key != HID_KEY_ESCAPE));
 
+#ifdef Z80_BREAK
+    if (breakpoints)
+    {
+        endMenu(false);
+        breakMenu();
+        return;
+    }
+#endif
     debounceExit(key == HID_KEY_ENTER);
     endMenu(false);
 }
@@ -721,6 +989,7 @@ bool modifyMenu(void)
     modify.centre = emu_Centre();
     modify.vTol = emu_VTol();
     modify.wrx = emu_WRXRequested();
+    modify.turbo = emu_TurboRequested();
     modify.sound = emu_SoundRequested();
     modify.stereo = emu_ACBRequested();
 
@@ -803,6 +1072,13 @@ bool modifyMenu(void)
                     {
                         modify.wrx = !modify.wrx;
                     }
+                    else if (field == PTURBO)
+                    {
+                        if (modify.turbo < 4)
+                        {
+                            modify.turbo <<= 1;
+                        }
+                    }
 #ifndef PICO_NO_SOUND
                     else if (field == PSOUNDTYPE)
                     {
@@ -844,6 +1120,13 @@ bool modifyMenu(void)
                             modify.vTol -=5;
                         }
                     }
+                    else if (field == PTURBO)
+                    {
+                        if (modify.turbo > 1)
+                        {
+                            modify.turbo >>= 1;
+                        }
+                    }
 #ifndef PICO_NO_SOUND
                     else if (field == PSOUNDTYPE)
                     {
@@ -872,6 +1155,7 @@ bool modifyMenu(void)
         emu_SetCentre(modify.centre);
         emu_SetVTol(modify.vTol);
         emu_SetWRX(modify.wrx);
+        emu_SetTurbo(modify.turbo);
         emu_SetSound(modify.sound);
         emu_SetACB(modify.stereo);
     }
@@ -1199,9 +1483,11 @@ void snapMenu(void)
 /* Build the menu. If clone is true, then copy the current menu, including any possible chroma buffer */
 static bool buildMenu(bool clone)
 {
-    // Obtain a display buffer
+    // Obtain a display buffer, which the emulator must clear in full
+    // when it next draws a frame in it
     displayGetFreeBuffer(&menuscreen);
     menuchroma = 0;
+    resetFrameLines();
 
     // Store the current display state
     wasBlank = displayIsBlank(&wasBlack);
@@ -1310,6 +1596,10 @@ static void showModify(PositionF6_T pos, ModifyF6_T* modify)
     writeInvertString("WRX RAM:", lhs, lcount + PositionF6_T::PWRX, pos == PositionF6_T::PWRX);
     writeString(modify->wrx ? "YES" : "NO ", rhs , lcount + PositionF6_T::PWRX);
 
+    writeInvertString("Turbo:", lhs, lcount + PositionF6_T::PTURBO, pos == PositionF6_T::PTURBO);
+    sprintf(c,"x%d\n",modify->turbo);
+    writeString(c, rhs , lcount + PositionF6_T::PTURBO);
+
 #ifndef PICO_NO_SOUND
     writeInvertString("Sound:", lhs, lcount + PositionF6_T::PSOUNDTYPE, pos == PositionF6_T::PSOUNDTYPE);
     switch (modify->sound)
@@ -13,6 +13,9 @@ extern bool restartMenu(void);
 extern void rebootMenu(void);
 extern void snapMenu(void);
 extern bool saveMenu(char* save, uint length, bool zx80);
+#ifdef Z80_BREAK
+extern void breakMenu(void);
+#endif
 #ifdef __cplusplus
 }
 #endif
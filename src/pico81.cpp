@@ -10,6 +10,7 @@
 #include "emuvideo.h"
 #include "emukeyboard.h"
 #include "zx8x.h"
+#include "z80.h"
 #include "display.h"
 #include "menu.h"
 
@@ -128,6 +129,12 @@ static void mainLoop(void)
                         snapMenu();
                     break;
 
+#ifdef Z80_TRACE
+                    case HID_KEY_F10:
+                        z80_traceDump();
+                    break;
+#endif
+
                 }
             }
         }
@@ -138,6 +145,13 @@ static void mainLoop(void)
             displayHideKeyboard();
             return;
         }
+#ifdef Z80_BREAK
+        if (z80_breakStopped(NULL))
+        {
+            emu_sndSilence();
+            breakMenu();
+        }
+#endif
         emu_WaitFor50HzTimer();
     }
 }
@@ -0,0 +1,445 @@
+/* Native execution of the hot routines of the ZX81 ROM BASIC interpreter.
+ *
+ * The routines in the rom_hle registry (zx8x.c) are trapped when a CALL,
+ * or the RET of the command dispatch, reaches their first instruction.
+ * Each runs to its RET, using the instruction macros of hleops.h, so that
+ * the result is the one the ROM gives. A path that is not written out
+ * (e.g. expanding a collapsed display line, or an error) hands back to
+ * the ROM there, as does each routine and loop (cstep) when the frame is
+ * about to end.
+ *
+ * With ROM_HLE_VERIFY each routine is also run by the ROM, and the
+ * registers, tstates and RAM up to RAMTOP compared. The ROM result is
+ * kept, so a routine can be checked before it is relied on.
+ *
+ * Included by hleops.h */
+
+/* 07BD DECODE, the address in HL of the character for the key in BC */
+static bool romDecode(void)
+{
+  cstep(0x07bd);
+  d = 0; cost(7);                                   // ld d,00
+  sra(b); cost2(8);                                 // sra b
+  suba(a, cy); cost(4);                             // sbc a,a
+  ora(0x26); cost(7);                               // or 26
+  l = 5; cost(7);                                   // ld l,05
+  suba(l, 0); cost(4);                              // sub l
+  for (;;)
+  {
+    // With no key line low the ROM scans for ever
+    if (c == 0xff) cexit(0x07c7);
+    cstep(0x07c7);
+    adda(l, 0); cost(4);                            // add a,l      KEY-LINE
+    scf(); cost(4);                                 // scf
+    rr(c); cost2(8);                                // rr c
+    if (cjr(cy)) continue;                          // jr c,KEY-LINE
+    inc(c); cost(4);                                // inc c
+    cretif(!zf);                                    // ret nz
+    c = b; cost(4);                                 // ld c,b
+    dec(l); cost(4);                                // dec l
+    l = 1; cost(7);                                 // ld l,01
+    if (!cjr(!zf)) break;                           // jr nz,KEY-LINE
+  }
+  h = 0x00; l = 0x7d; cost(10);                     // ld hl,K-UNSHIFT
+  e = a; cost(4);                                   // ld e,a
+  addhl(d, e); cost(11);                            // add hl,de
+  scf(); cost(4);                                   // scf
+  cret();
+}
+
+/* 09AD POINTERS, add BC to the sysvar pointers at or above HL */
+static bool romPointers(void)
+{
+  cstep(0x09ad);
+  push1(a, getf()); cost(11);                       // push af
+  push1(h, l); cost(11);                            // push hl
+  h = 0x40; l = 0x0c; cost(10);                     // ld hl,D_FILE
+  a = 9; cost(7);                                   // ld a,09
+  do
+  {
+    cstep(0x09b4);
+    e = fetch(hl); cost(7);                         // ld e,(hl)    NEXT-PTR
+    inchl(); cost(6);                               // inc hl
+    d = fetch(hl); cost(7);                         // ld d,(hl)
+    exsphl(); cost(19);                             // ex (sp),hl
+    anda(a); cost(4);                               // and a
+    sbchl(de); cost2(15);                           // sbc hl,de
+    addhl(d, e); cost(11);                          // add hl,de
+    exsphl(); cost(19);                             // ex (sp),hl
+    if (!cjr(!cy))                                  // jr nc,PTR-DONE
+    {
+      push1(d, e); cost(11);                        // push de
+      exdehl(); cost(4);                            // ex de,hl
+      addhl(b, c); cost(11);                        // add hl,bc
+      exdehl(); cost(4);                            // ex de,hl
+      store(hl, d); cost(7);                        // ld (hl),d
+      dechl(); cost(6);                             // dec hl
+      store(hl, e); cost(7);                        // ld (hl),e
+      inchl(); cost(6);                             // inc hl
+      pop1(d, e); cost(10);                         // pop de
+    }
+    inchl(); cost(6);                               // inc hl       PTR-DONE
+    dec(a); cost(4);                                // dec a
+  } while (cjr(!zf));                               // jr nz,NEXT-PTR
+  exdehl(); cost(4);                                // ex de,hl
+  pop1(d, e); cost(10);                             // pop de
+  pop1(a, f); lazyf = LAZY_NONE; cost(10);          // pop af
+  anda(a); cost(4);                                 // and a
+  sbchl(de); cost2(15);                             // sbc hl,de
+  b = h; cost(4);                                   // ld b,h
+  c = l; cost(4);                                   // ld c,l
+  incbc(); cost(6);                                 // inc bc
+  addhl(d, e); cost(11);                            // add hl,de
+  exdehl(); cost(4);                                // ex de,hl
+  cret();
+}
+
+/* 099E MAKE-ROOM, open BC bytes before HL */
+static bool romMakeRoom(void)
+{
+  cstep(0x099e);
+  push1(h, l); cost(11);                            // push hl
+  ccall(0x09a2, hleTestRoom());                     // call TEST-ROOM
+  pop1(h, l); cost(10);                             // pop hl
+  ccall(0x09a6, romPointers());                     // call POINTERS
+  h = fetch(0x401d); l = fetch(0x401c); cost(16);   // ld hl,(STKEND)
+  exdehl(); cost(4);                                // ex de,hl
+  cblock(hleLddr(0x09aa));                          // lddr
+  cret();
+}
+
+/* 0A17 DIFFER, BC = HL - DE */
+static bool romDiffer(void)
+{
+  cstep(0x0a17);
+  anda(a); cost(4);                                 // and a
+  sbchl(de); cost2(15);                             // sbc hl,de
+  b = h; cost(4);                                   // ld b,h
+  c = l; cost(4);                                   // ld c,l
+  addhl(d, e); cost(11);                            // add hl,de
+  exdehl(); cost(4);                                // ex de,hl
+  cret();
+}
+
+/* 09EA CP-LINES, compare the line number at HL with BC */
+static bool romCpLines(void)
+{
+  cstep(0x09ea);
+  a = fetch(hl); cost(7);                           // ld a,(hl)
+  cpa(b); cost(4);                                  // cp b
+  cretif(!zf);                                      // ret nz
+  inchl(); cost(6);                                 // inc hl
+  a = fetch(hl); cost(7);                           // ld a,(hl)
+  dechl(); cost(6);                                 // dec hl
+  cpa(c); cost(4);                                  // cp c
+  cret();
+}
+
+/* 09F2 NEXT-ONE, step HL over the line or variable there */
+static bool romNextOne(void)
+{
+  cstep(0x09f2);
+  push1(h, l); cost(11);                            // push hl
+  a = fetch(hl); cost(7);                           // ld a,(hl)
+  cpa(0x40); cost(7);                               // cp 40
+  if (cjr(cy)) goto lines;                          // jr c,LINES
+  bit(5, a); cost2(8);                              // bit 5,a
+  if (cjr(zf)) goto next_o_4;                       // jr z,NEXT-O-4
+  adda(a, 0); cost(4);                              // add a,a
+  cost(10);                                         // jp m,NEXT+FIVE
+  if (!sf)
+  {
+    ccf(); cost(4);                                 // ccf
+  }
+  b = 0x00; c = 0x05; cost(10);                     // ld bc,0005   NEXT+FIVE
+  if (!cjr(!cy))                                    // jr nc,NEXT-LETT
+  {
+    c = 0x11; cost(7);                              // ld c,11
+  }
+  do
+  {
+    cstep(0x0a08);
+    rla(); cost(4);                                 // rla          NEXT-LETT
+    inchl(); cost(6);                               // inc hl
+    a = fetch(hl); cost(7);                         // ld a,(hl)
+  } while (cjr(!cy));                               // jr nc,NEXT-LETT
+  cost(12);                                         // jr NEXT-ADD
+  goto next_add;
+
+lines:
+  inchl(); cost(6);                                 // inc hl
+next_o_4:
+  inchl(); cost(6);                                 // inc hl
+  c = fetch(hl); cost(7);                           // ld c,(hl)
+  inchl(); cost(6);                                 // inc hl
+  b = fetch(hl); cost(7);                           // ld b,(hl)
+  inchl(); cost(6);                                 // inc hl
+next_add:
+  addhl(b, c); cost(11);                            // add hl,bc
+  pop1(d, e); cost(10);                             // pop de
+  return romDiffer();
+}
+
+/* 09D8 LINE-ADDR, the address of line HL, or of the line after it */
+static bool romLineAddr(void)
+{
+  cstep(0x09d8);
+  push1(h, l); cost(11);                            // push hl
+  h = 0x40; l = 0x7d; cost(10);                     // ld hl,PROG
+  d = h; cost(4);                                   // ld d,h
+  e = l; cost(4);                                   // ld e,l
+  for (;;)
+  {
+    cstep(0x09de);
+    pop1(b, c); cost(10);                           // pop bc       NEXT-TEST
+    ccall(0x09e2, romCpLines());                    // call CP-LINES
+    cretif(!cy);                                    // ret nc
+    push1(b, c); cost(11);                          // push bc
+    ccall(0x09e7, romNextOne());                    // call NEXT-ONE
+    exdehl(); cost(4);                              // ex de,hl
+    cost(12);                                       // jr NEXT-TEST
+  }
+}
+
+/* 0A60 RECLAIM-2, remove BC bytes from DE */
+static bool romReclaim2(void)
+{
+  cstep(0x0a60);
+  push1(b, c); cost(11);                            // push bc
+  a = b; cost(4);                                   // ld a,b
+  cpl(); cost(4);                                   // cpl
+  b = a; cost(4);                                   // ld b,a
+  a = c; cost(4);                                   // ld a,c
+  cpl(); cost(4);                                   // cpl
+  c = a; cost(4);                                   // ld c,a
+  incbc(); cost(6);                                 // inc bc
+  ccall(0x0a6b, romPointers());                     // call POINTERS
+  exdehl(); cost(4);                                // ex de,hl
+  pop1(h, l); cost(10);                             // pop hl
+  addhl(d, e); cost(11);                            // add hl,de
+  push1(d, e); cost(11);                            // push de
+  cblock(hleLdir(0x0a6f));                          // ldir
+  pop1(h, l); cost(10);                             // pop hl
+  cret();
+}
+
+/* 0A5D RECLAIM-1, remove the bytes from DE to HL */
+static bool romReclaim1(void)
+{
+  cstep(0x0a5d);
+  ccall(0x0a60, romDiffer());                       // call DIFFER
+  return romReclaim2();
+}
+
+/* 0918 LOC-ADDR, set DF_CC for the print position in BC. A collapsed
+ * line is expanded by the ROM */
+static bool romLocAddr(void)
+{
+  cstep(0x0918);
+  store2b(0x4039, b, c); cost2(20);                 // ld (S_POSN),bc
+  h = fetch(0x4011); l = fetch(0x4010); cost(16);   // ld hl,(VARS)
+  d = c; cost(4);                                   // ld d,c
+  a = 0x22; cost(7);                                // ld a,22
+  suba(c, 0); cost(4);                              // sub c
+  c = a; cost(4);                                   // ld c,a
+  a = 0x76; cost(7);                                // ld a,76
+  inc(b); cost(4);                                  // inc b
+  do
+  {
+    do
+    {
+      cstep(0x0927);
+      dechl(); cost(6);                             // dec hl       LOOK-BACK
+      cpa(fetch(hl)); cost(7);                      // cp (hl)
+    } while (cjr(!zf));                             // jr nz,LOOK-BACK
+  } while (cdjnz());                                // djnz LOOK-BACK
+  inchl(); cost(6);                                 // inc hl
+  cblock(hleCpir(0x092e));                          // cpir
+  dechl(); cost(6);                                 // dec hl
+  store2b(0x400e, h, l); cost(16);                  // ld (DF_CC),hl
+  scf(); cost(4);                                   // scf
+  cretif(!pvf);                                     // ret po
+  cexit(0x0936);
+}
+
+/* 0808 ENTER-CH, put the character in A at DF_CC. NEWLINE, a collapsed
+ * line and the screen filling are left to the ROM */
+static bool romEnterCh(void)
+{
+  cstep(0x0808);
+  d = a; cost(4);                                   // ld d,a
+  c = fetch(0x4039); b = fetch(0x403a); cost2(20);  // ld bc,(S_POSN)
+  a = c; cost(4);                                   // ld a,c
+  cpa(0x21); cost(7);                               // cp 21
+  if (cjr(zf)) goto test_low;                       // jr z,TEST-LOW
+
+test_nl:
+  cstep(0x0812);
+  a = 0x76; cost(7);                                // ld a,76      TEST-N/L
+  cpa(d); cost(4);                                  // cp d
+  if (cjr(zf)) cexit(0x0847);                       // jr z,WRITE-N/L
+  h = fetch(0x400f); l = fetch(0x400e); cost(16);   // ld hl,(DF_CC)
+  cpa(fetch(hl)); cost(7);                          // cp (hl)
+  a = d; cost(4);                                   // ld a,d
+  if (cjr(!zf)) goto write_ch;                      // jr nz,WRITE-CH
+  dec(c); cost(4);                                  // dec c
+  if (cjr(!zf)) cexit(0x083a);                      // jr nz,EXPAND-1
+  inchl(); cost(6);                                 // inc hl
+  store2b(0x400e, h, l); cost(16);                  // ld (DF_CC),hl
+  c = 0x21; cost(7);                                // ld c,21
+  dec(b); cost(4);                                  // dec b
+  store2b(0x4039, b, c); cost2(20);                 // ld (S_POSN),bc
+
+test_low:
+  a = b; cost(4);                                   // ld a,b       TEST-LOW
+  cpa(fetch((unsigned short)(iy + 0x22))); cost2(19); // cp (iy+DF_SZ)
+  if (cjr(zf)) cexit(0x0835);                       // jr z,REPORT-5
+  anda(a); cost(4);                                 // and a
+  if (cjr(!zf)) goto test_nl;                       // jr nz,TEST-N/L
+  cexit(0x0835);
+
+write_ch:
+  store(hl, a); cost(7);                            // ld (hl),a    WRITE-CH
+  inchl(); cost(6);                                 // inc hl
+  store2b(0x400e, h, l); cost(16);                  // ld (DF_CC),hl
+  decat((unsigned short)(iy + 0x39)); cost2(23);    // dec (iy+S_POSN)
+  cret();
+}
+
+/* 07F5 PRINT-SP, print A to the display. The printer is left to the ROM */
+static bool romPrintSp(void)
+{
+  cstep(0x07f5);
+  exx(); cost(4);                                   // exx
+  push1(h, l); cost(11);                            // push hl
+  bitat(1, (unsigned short)(iy + 0x01)); cost2(20); // bit 1,(FLAGS)
+  if (cjr(!zf)) cexit(0x0802);                      // jr nz,LPRINT-CH
+  ccall(0x0800, romEnterCh());                      // call ENTER-CH
+  cost(12);                                         // jr PRINT-EXX
+  pop1(h, l); cost(10);                             // pop hl       PRINT-EXX
+  exx(); cost(4);                                   // exx
+  cret();
+}
+
+/* 0A2A CLS */
+static bool romCls(void)
+{
+  cstep(0x0a2a);
+  b = 0x18; cost(7);                                // ld b,18
+  resat(1, (unsigned short)(iy + 0x01)); cost2(23); // res 1,(FLAGS) B-LINES
+  c = 0x21; cost(7);                                // ld c,21
+  push1(b, c); cost(11);                            // push bc
+  ccall(0x0a36, romLocAddr());                      // call LOC-ADDR
+  pop1(b, c); cost(10);                             // pop bc
+  a = fetch(0x4005); cost(13);                      // ld a,(RAMTOP_hi)
+  cpa(0x4d); cost(7);                               // cp 4d
+  if (cjr(cy))                                      // jr c,COLLAPSED
+  {
+    d = h; cost(4);                                 // ld d,h       COLLAPSED
+    e = l; cost(4);                                 // ld e,l
+    dechl(); cost(6);                               // dec hl
+    c = b; cost(4);                                 // ld c,b
+    b = 0; cost(7);                                 // ld b,00
+    cblock(hleLdir(0x0a58));                        // ldir
+    h = fetch(0x4011); l = fetch(0x4010); cost(16); // ld hl,(VARS)
+    return romReclaim1();
+  }
+  setat(7, (unsigned short)(iy + 0x3a)); cost2(23); // set 7,(S_POSN_hi)
+  do
+  {
+    cstep(0x0a42);
+    xora(a); cost(4);                               // xor a        CLEAR-LOC
+    ccall(0x0a46, romPrintSp());                    // call PRINT-SP
+    h = fetch(0x403a); l = fetch(0x4039); cost(16); // ld hl,(S_POSN)
+    a = l; cost(4);                                 // ld a,l
+    ora(h); cost(4);                                // or h
+    anda(0x7e); cost(7);                            // and 7e
+  } while (cjr(!zf));                               // jr nz,CLEAR-LOC
+  cost(10);                                         // jp LOC-ADDR
+  return romLocAddr();
+}
+
+static bool romRoutine(unsigned short addr)
+{
+  switch (addr)
+  {
+    case 0x07bd: return romDecode();
+    case 0x099e: return romMakeRoom();
+    case 0x09d8: return romLineAddr();
+    case 0x0a2a: return romCls();
+    case 0x0a5d: return romReclaim1();
+    case 0x0a60: return romReclaim2();
+
+    default:
+      cexit(addr);
+  }
+}
+
+/* Run the routine at pc to its RET, or to where the ROM takes over */
+static void romRun(void)
+{
+  unsigned short back = fetch2(sp);
+
+  if (romRoutine(pc))
+    pc = back;
+}
+
+#ifdef ROM_HLE_VERIFY
+/* Run a routine natively, then again in the ROM from the same state, and
+ * compare RAM up to RAMTOP and the stack. The ROM result is kept */
+static void romVerify(RomHLE_T* routine)
+{
+  HleWindow_T window[2];
+  unsigned short ramtop = fetch2(0x4004);
+  char label[32];
+
+  window[0].start = 0x4000;
+  window[0].length = HLE_VERIFY_BYTES - 0x100;
+  if ((ramtop > 0x4000) && ((unsigned short)(ramtop - 0x4000) < window[0].length))
+    window[0].length = ramtop - 0x4000;
+  window[1].start = sp - 0x80;
+  window[1].length = 0x100;
+
+  snprintf(label, sizeof(label), "rom: %s from %04x", routine->name, fetch2(sp));
+  if (hleVerify(romRun, window, 2, label))
+    routine->verified++;
+  else
+    routine->mismatched++;
+}
+#endif
+
+/* Trap at the first instruction of a routine in the registry. Returns
+ * the tstates the ULA has stepped, of those since tstore */
+static unsigned long romHLE(unsigned long tstore)
+{
+  RomHLE_T* routine = 0;
+  unsigned long start = tstates;
+  bool turbo;
+
+#ifdef HLE_VERIFY
+  if (hle_verifying)
+    return 0;
+#endif
+  if (zx80 || NMI_generator || iff1 || (tstates + HLE_STEP >= tsexit))
+    return 0;
+
+  for (int n = 0; n < ROM_HLE_ROUTINES; n++)
+  {
+    if (rom_hle[n].start == pc)
+      routine = &rom_hle[n];
+  }
+  if (!routine || !routine->enabled)
+    return 0;
+
+  hleStart(tstore);
+  turbo = hle_turbo;
+
+#ifdef ROM_HLE_VERIFY
+  romVerify(routine);
+#else
+  romRun();
+#endif
+  routine->calls++;
+  routine->tstates += tstates - start;
+  return hleEnd(tstore, turbo);
+}
@@ -0,0 +1,164 @@
+/* Entry points of the ZX80 and ZX81 ROM routines, used to label the
+ * sampled PC profile. Each table is in address order, and a sample is
+ * credited to the last entry at or below it. Names follow the usual
+ * ROM disassemblies, in lower case for the calculator literals */
+#ifndef _ROMSYMS_H_
+#define _ROMSYMS_H_
+
+typedef struct
+{
+  uint16_t addr;
+  const char* name;
+} RomSymbol_T;
+
+static const RomSymbol_T zx81_symbols[] = {
+  {0x0000, "START"},
+  {0x0008, "ERROR-1"},
+  {0x0010, "PRINT-A"},
+  {0x0018, "GET-CHAR"},
+  {0x0020, "NEXT-CHAR"},
+  {0x0028, "FP-CALC"},
+  {0x002b, "end-calc"},
+  {0x0030, "BC-SPACES"},
+  {0x0038, "INTERRUPT"},
+  {0x0049, "CH-ADD+1"},
+  {0x0056, "ERROR-2"},
+  {0x0066, "NMI"},
+  {0x006f, "NMI-CONT"},
+  {0x007e, "KEY-TABLES"},
+  {0x0207, "SLOW/FAST"},
+  {0x0229, "DISPLAY-1"},
+  {0x0292, "DISPLAY-3"},
+  {0x02b5, "DISPLAY-5"},
+  {0x02bb, "KEYBOARD"},
+  {0x02e7, "SET-FAST"},
+  {0x02f6, "SAVE"},
+  {0x0340, "LOAD"},
+  {0x03c3, "NEW"},
+  {0x03cb, "RAM-CHECK"},
+  {0x03e5, "SET-TOP"},
+  {0x0419, "UPPER"},
+  {0x0472, "LOWER"},
+  {0x04c1, "SLOW-DISP"},
+  {0x0730, "LIST"},
+  {0x07bd, "DECODE"},
+  {0x07f1, "PRINT-CH"},
+  {0x07f5, "PRINT-SP"},
+  {0x0808, "ENTER-CH"},
+  {0x0869, "COPY"},
+  {0x08f5, "PRINT-AT"},
+  {0x0918, "LOC-ADDR"},
+  {0x099e, "MAKE-ROOM"},
+  {0x09ad, "POINTERS"},
+  {0x09d8, "LINE-ADDR"},
+  {0x09ea, "CP-LINES"},
+  {0x09f2, "NEXT-ONE"},
+  {0x0a17, "DIFFER"},
+  {0x0a2a, "CLS"},
+  {0x0a5d, "RECLAIM-1"},
+  {0x0a60, "RECLAIM-2"},
+  {0x0a73, "E-LINE-NO"},
+  {0x0a98, "OUT-NUM"},
+  {0x0acf, "PRINT"},
+  {0x0baf, "PLOT/UNP"},
+  {0x0cdc, "STOP"},
+  {0x0db9, "FOR"},
+  {0x0e2e, "NEXT"},
+  {0x0e6c, "RAND"},
+  {0x0e81, "GOTO"},
+  {0x0ea7, "FIND-INT"},
+  {0x0eb5, "GOSUB"},
+  {0x0ec5, "TEST-ROOM"},
+  {0x0ed8, "RETURN"},
+  {0x0f23, "FAST"},
+  {0x0f2b, "SLOW"},
+  {0x0f32, "PAUSE"},
+  {0x0f46, "BREAK-1"},
+  {0x0f55, "SCANNING"},
+  {0x12c3, "STK-STORE"},
+  {0x1321, "LET"},
+  {0x13f8, "STK-FETCH"},
+  {0x149a, "CLEAR"},
+  {0x14bc, "SET-MEM"},
+  {0x1520, "STACK-BC"},
+  {0x155a, "e-to-fp"},
+  {0x15db, "PRINT-FP"},
+  {0x16d8, "PREP-ADD"},
+  {0x16f7, "FETCH-TWO"},
+  {0x171a, "SHIFT-FP"},
+  {0x1738, "ZEROS-4/5"},
+  {0x1741, "ADD-BACK"},
+  {0x174c, "subtract"},
+  {0x1755, "addition"},
+  {0x17bc, "PREP-M/D"},
+  {0x17c6, "multiply"},
+  {0x1882, "division"},
+  {0x18e4, "truncate"},
+  {0x199d, "CALCULATE"},
+  {0x19ae, "SCAN-ENT"},
+  {0x19e3, "delete"},
+  {0x19e4, "fp-calc-2"},
+  {0x19eb, "TEST-5-SP"},
+  {0x19f6, "duplicate"},
+  {0x19fc, "stk-data"},
+  {0x19fe, "STK-CONST"},
+  {0x1a2d, "SKIP-CONS"},
+  {0x1a3c, "LOC-MEM"},
+  {0x1a45, "get-mem-xx"},
+  {0x1a51, "stk-const-xx"},
+  {0x1a63, "st-mem-xx"},
+  {0x1a72, "exchange"},
+  {0x1a7f, "series-xx"},
+  {0x1aa0, "negate"},
+  {0x1aaa, "abs"},
+  {0x1aaf, "sgn"},
+  {0x1abe, "peek"},
+  {0x1ac5, "usr-no"},
+  {0x1ace, "greater-0"},
+  {0x1ad5, "not"},
+  {0x1adb, "less-0"},
+  {0x1ae0, "FP-0/1"},
+  {0x1aed, "or"},
+  {0x1af3, "no-&-no"},
+  {0x1af8, "str-&-no"},
+  {0x1b03, "compare"},
+  {0x1b62, "strs-add"},
+  {0x1b85, "STK-PNTRS"},
+  {0x1b8f, "chrs"},
+  {0x1ba4, "val"},
+  {0x1bd5, "str$"},
+  {0x1c06, "code"},
+  {0x1c11, "len"},
+  {0x1c17, "dec-jr-nz"},
+  {0x1c23, "jump"},
+  {0x1c2f, "jump-true"},
+  {0x1c37, "n-mod-m"},
+  {0x1c46, "int"},
+  {0x1c5b, "exp"},
+  {0x1ca9, "ln"},
+  {0x1d18, "get-argt"},
+  {0x1d3e, "cos"},
+  {0x1d49, "sin"},
+  {0x1d6e, "tan"},
+  {0x1d76, "atn"},
+  {0x1dc4, "asn"},
+  {0x1dd4, "acs"},
+  {0x1ddb, "sqr"},
+  {0x1de2, "to-power"},
+  {0x1e00, "CHAR-SET"},
+};
+
+static const RomSymbol_T zx80_symbols[] = {
+  {0x0000, "START"},
+  {0x0008, "ERROR-1"},
+  {0x0010, "PRINT-A"},
+  {0x0038, "INTERRUPT"},
+  {0x013c, "DISPLAY-1"},
+  {0x014a, "KEYBOARD"},
+  {0x01ad, "DISPLAY-3"},
+  {0x01b6, "SAVE"},
+  {0x0206, "LOAD"},
+  {0x0261, "RAM-CHECK"},
+};
+
+#endif // _ROMSYMS_H_
@@ -0,0 +1,467 @@
+/* Emulations of the Z80 CPU instruction set - part of xz80.
+ * Copyright (C) 1994 Ian Collier.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/* The instructions which are changed by a DD or FD prefix. Included by
+ * z80ops.h with Z80_XMODE 0 (HL), and by z80_op with Z80_XMODE 1 (IX)
+ * and 2 (IY) for the prefixed handler sets. Any other opcode following
+ * a prefix runs the unprefixed handler */
+#ifdef Z80_THREADED
+#undef Z80_PAGE
+#undef Z80_XPAGE
+#undef Z80_CBPAGE
+#undef Z80_CBOPS
+#if Z80_XMODE == 1
+#define Z80_XPAGE dd_
+#define Z80_CBPAGE ddcb_
+#define Z80_CBOPS ddcb_ops
+#elif Z80_XMODE == 2
+#define Z80_XPAGE fd_
+#define Z80_CBPAGE fdcb_
+#define Z80_CBOPS fdcb_ops
+#else
+#define Z80_XPAGE op_
+#define Z80_CBPAGE cb_
+#define Z80_CBOPS cb_ops
+#endif
+#define Z80_PAGE Z80_XPAGE
+#endif
+
+instr(9,11);
+   addhl(b,c);
+endinstr;
+
+instr(25,11);
+   addhl(d,e);
+endinstr;
+
+instr(33,10);
+   if(!Z80_XMODE){
+      l=fetch(pc),pc++;
+      h=fetch(pc),pc++;
+#ifdef LOAD_AND_SAVE
+      if ((pc == LOAD_SAVE_RET_8K) && rom_traps && (!rom4k)) loadAndSaveROM();
+#endif
+   }
+   else {
+      if(Z80_XMODE==1)
+        ix=fetch2(pc);
+      else iy=fetch2(pc);
+      pc+=2;
+   }
+endinstr;
+
+instr(34,16);
+   {unsigned short addr=fetch2(pc);
+    pc+=2;
+    if(!Z80_XMODE)store2b(addr,h,l);
+    else if(Z80_XMODE==1)store2(addr,ix);
+    else store2(addr,iy);
+   }
+endinstr;
+
+instr(35,6);
+   if(!Z80_XMODE){if(!++l)h++;}
+   else if(Z80_XMODE==1)ix++;
+   else iy++;
+endinstr;
+
+instr(36,4);
+   if(Z80_XMODE==0)inc(h);
+   else{unsigned char t;
+      t=(Z80_XMODE==1?ix:iy)>>8;
+      inc(t);
+      if(Z80_XMODE==1)ix=(ix&0xff)|(t<<8);
+      else iy=(iy&0xff)|(t<<8);
+   }
+endinstr;
+
+instr(37,4);
+   if(Z80_XMODE==0)dec(h);
+   else{unsigned char t;
+      t=(Z80_XMODE==1?ix:iy)>>8;
+      dec(t);
+      if(Z80_XMODE==1)ix=(ix&0xff)|(t<<8);
+      else iy=(iy&0xff)|(t<<8);
+   }
+endinstr;
+
+instr(38,7);
+   setxh(fetch(pc));
+   pc++;
+endinstr;
+
+instr(41,11);
+   if(!Z80_XMODE)addhl(h,l);
+   else if(Z80_XMODE==1)addhl((ix>>8),(ix&0xff));
+   else addhl((iy>>8),(iy&0xff));
+endinstr;
+
+instr(42,16);
+  {unsigned short addr=fetch2(pc);
+   pc+=2;
+   if(!Z80_XMODE){
+      l=fetch(addr);
+      h=fetch(addr+1);
+   }
+   else if(Z80_XMODE==1)ix=fetch2(addr);
+   else iy=fetch2(addr);
+  }
+endinstr;
+
+instr(43,6);
+   if(!Z80_XMODE){if(!l--)h--;}
+   else if(Z80_XMODE==1)ix--;
+   else iy--;
+endinstr;
+
+instr(44,4);
+   if(!Z80_XMODE)inc(l);
+   else {unsigned char t;
+      t=(Z80_XMODE==1?ix:iy);
+      inc(t);
+      if(Z80_XMODE==1)ix=(ix&0xff00)|t;
+      else iy=(iy&0xff00)|t;
+   }
+endinstr;
+
+instr(45,4);
+   if(!Z80_XMODE)dec(l);
+   else {unsigned char t;
+      t=(Z80_XMODE==1?ix:iy);
+      dec(t);
+      if(Z80_XMODE==1)ix=(ix&0xff00)|t;
+      else iy=(iy&0xff00)|t;
+   }
+endinstr;
+
+instr(46,7);
+   setxl(fetch(pc));
+   pc++;
+endinstr;
+
+HLinstr(52,11,8);
+  {unsigned char t=fetch(addr);
+   inc(t);
+   store(addr,t);
+  }
+endinstr;
+
+HLinstr(53,11,8);
+  {unsigned char t=fetch(addr);
+   dec(t);
+   store(addr,t);
+  }
+endinstr;
+
+HLinstr(54,10,5);
+   store(addr,fetch(pc));
+   pc++;
+endinstr;
+
+instr(57,11);
+   addhl((sp>>8),(sp&0xff));
+endinstr;
+
+instr(0x44,4);
+   b=xh;
+endinstr;
+
+instr(0x45,4);
+   b=xl;
+endinstr;
+
+HLinstr(0x46,7,8);
+   b=fetch(addr);
+endinstr;
+
+instr(0x4c,4);
+   c=xh;
+endinstr;
+
+instr(0x4d,4);
+   c=xl;
+endinstr;
+
+HLinstr(0x4e,7,8);
+   c=fetch(addr);
+endinstr;
+
+instr(0x54,4);
+   d=xh;
+endinstr;
+
+instr(0x55,4);
+   d=xl;
+endinstr;
+
+HLinstr(0x56,7,8);
+   d=fetch(addr);
+endinstr;
+
+instr(0x5c,4);
+   e=xh;
+endinstr;
+
+instr(0x5d,4);
+   e=xl;
+endinstr;
+
+HLinstr(0x5e,7,8);
+   e=fetch(addr);
+endinstr;
+
+instr(0x60,4);
+   setxh(b);
+endinstr;
+
+instr(0x61,4);
+   setxh(c);
+endinstr;
+
+instr(0x62,4);
+   setxh(d);
+endinstr;
+
+instr(0x63,4);
+   setxh(e);
+endinstr;
+
+instr(0x65,4);
+   setxh(xl);
+endinstr;
+
+HLinstr(0x66,7,8);
+   h=fetch(addr);
+endinstr;
+
+instr(0x67,4);
+   setxh(a);
+endinstr;
+
+instr(0x68,4);
+   setxl(b);
+endinstr;
+
+instr(0x69,4);
+   setxl(c);
+endinstr;
+
+instr(0x6a,4);
+   setxl(d);
+endinstr;
+
+instr(0x6b,4);
+   setxl(e);
+endinstr;
+
+instr(0x6c,4);
+   setxl(xh);
+endinstr;
+
+HLinstr(0x6e,7,8);
+   l=fetch(addr);
+endinstr;
+
+instr(0x6f,4);
+   setxl(a);
+endinstr;
+
+HLinstr(0x70,7,8);
+   store(addr,b);
+endinstr;
+
+HLinstr(0x71,7,8);
+   store(addr,c);
+endinstr;
+
+HLinstr(0x72,7,8);
+   store(addr,d);
+endinstr;
+
+HLinstr(0x73,7,8);
+   store(addr,e);
+endinstr;
+
+HLinstr(0x74,7,8);
+   store(addr,h);
+endinstr;
+
+HLinstr(0x75,7,8);
+   store(addr,l);
+endinstr;
+
+HLinstr(0x77,7,8);
+   store(addr,a);
+endinstr;
+
+instr(0x7c,4);
+   a=xh;
+endinstr;
+
+instr(0x7d,4);
+   a=xl;
+endinstr;
+
+HLinstr(0x7e,7,8);
+   a=fetch(addr);
+endinstr;
+
+instr(0x84,4);
+   adda(xh,0);
+endinstr;
+
+instr(0x85,4);
+   adda(xl,0);
+endinstr;
+
+HLinstr(0x86,7,8);
+   adda(fetch(addr),0);
+endinstr;
+
+instr(0x8c,4);
+   adda(xh,cy);
+endinstr;
+
+instr(0x8d,4);
+   adda(xl,cy);
+endinstr;
+
+HLinstr(0x8e,7,8);
+   adda(fetch(addr),cy);
+endinstr;
+
+instr(0x94,4);
+   suba(xh,0);
+endinstr;
+
+instr(0x95,4);
+   suba(xl,0);
+endinstr;
+
+HLinstr(0x96,7,8);
+   suba(fetch(addr),0);
+endinstr;
+
+instr(0x9c,4);
+   suba(xh,cy);
+endinstr;
+
+instr(0x9d,4);
+   suba(xl,cy);
+endinstr;
+
+HLinstr(0x9e,7,8);
+   suba(fetch(addr),cy);
+endinstr;
+
+instr(0xa4,4);
+   anda(xh);
+endinstr;
+
+instr(0xa5,4);
+   anda(xl);
+endinstr;
+
+HLinstr(0xa6,7,8);
+   anda(fetch(addr));
+endinstr;
+
+instr(0xac,4);
+   xora(xh);
+endinstr;
+
+instr(0xad,4);
+   xora(xl);
+endinstr;
+
+HLinstr(0xae,7,8);
+   xora(fetch(addr));
+endinstr;
+
+instr(0xb4,4);
+   ora(xh);
+endinstr;
+
+instr(0xb5,4);
+   ora(xl);
+endinstr;
+
+HLinstr(0xb6,7,8);
+   ora(fetch(addr));
+endinstr;
+
+instr(0xbc,4);
+   cpa(xh);
+endinstr;
+
+instr(0xbd,4);
+   cpa(xl);
+endinstr;
+
+HLinstr(0xbe,7,8);
+   cpa(fetch(addr));
+endinstr;
+
+instr(0xcb,4);
+   m1cycles++;
+#include "cbops.h"
+endinstr;
+
+instr(0xe1,10);
+   if(!Z80_XMODE)
+   {pop1(h,l);
+#if (defined LOAD_AND_SAVE)
+   if ((pc == LOAD_SAVE_RET_4K) && rom_traps && rom4k) loadAndSaveROM();
+#endif
+   }
+   else if(Z80_XMODE==1)pop2(ix);
+   else pop2(iy);
+endinstr;
+
+instr(0xe3,19);
+   if(!Z80_XMODE){
+      unsigned short t=fetch2(sp);
+      store2b(sp,h,l);
+      l=t;
+      h=t>>8;
+   }
+   else if(Z80_XMODE==1){
+      unsigned short t=fetch2(sp);
+      store2(sp,ix);
+      ix=t;
+   }
+   else{
+      unsigned short t=fetch2(sp);
+      store2(sp,iy);
+      iy=t;
+   }
+endinstr;
+
+instr(0xe5,11);
+   if(!Z80_XMODE)push1(h,l);
+   else if(Z80_XMODE==1)push2(ix);
+   else push2(iy);
+endinstr;
+
+instr(0xe9,4);
+   pc=!Z80_XMODE?hl:Z80_XMODE==1?ix:iy;
+endinstr;
+
+instr(0xf9,6);
+   sp=!Z80_XMODE?hl:Z80_XMODE==1?ix:iy;
+endinstr;
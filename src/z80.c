@@ -21,16 +21,27 @@
 
 #include <string.h>   /* for memset */
 #include "pico.h"     /* For not in flash */
+#ifdef Z80_THREADED
+// gcc assumes any computed goto can reach any label, so reports locals
+// in the CB and ED pages as possibly used before being initialised
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
 #include "z80.h"
 #include <stdio.h>
 #include "emuapi.h"
 #include "emuvideo.h"
 #include "emusound.h"
 #include "display.h"
+#ifdef PC_PROFILE
+#include "romsyms.h"
+#endif
 
 #define parity(a) (partable[a])
 
-unsigned char partable[256] = {     // Constant, but want to be in RAM
+/* Flag tables. Constant, but want to be in RAM */
+
+/* Parity */
+unsigned char __scratch_y("z80_flags") partable[256] = {
       4, 0, 0, 4, 0, 4, 4, 0, 0, 4, 4, 0, 4, 0, 0, 4,
       0, 4, 4, 0, 4, 0, 0, 4, 4, 0, 0, 4, 0, 4, 4, 0,
       0, 4, 4, 0, 4, 0, 0, 4, 4, 0, 0, 4, 0, 4, 4, 0,
@@ -49,20 +60,256 @@ unsigned char partable[256] = {     // Constant, but want to be in RAM
       4, 0, 0, 4, 0, 4, 4, 0, 0, 4, 4, 0, 4, 0, 0, 4
    };
 
-unsigned long tstates = 0;
+/* Sign, zero and undocumented bits 3 and 5 */
+static unsigned char __scratch_y("z80_flags") sztable[256] = {
+      0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08,
+      0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28,
+      0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08,
+      0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28,
+      0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28,
+      0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88,
+      0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88,
+      0xa0, 0xa0, 0xa0, 0xa0, 0xa0, 0xa0, 0xa0, 0xa0, 0xa8, 0xa8, 0xa8, 0xa8, 0xa8, 0xa8, 0xa8, 0xa8,
+      0xa0, 0xa0, 0xa0, 0xa0, 0xa0, 0xa0, 0xa0, 0xa0, 0xa8, 0xa8, 0xa8, 0xa8, 0xa8, 0xa8, 0xa8, 0xa8,
+      0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88,
+      0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88,
+      0xa0, 0xa0, 0xa0, 0xa0, 0xa0, 0xa0, 0xa0, 0xa0, 0xa8, 0xa8, 0xa8, 0xa8, 0xa8, 0xa8, 0xa8, 0xa8,
+      0xa0, 0xa0, 0xa0, 0xa0, 0xa0, 0xa0, 0xa0, 0xa0, 0xa8, 0xa8, 0xa8, 0xa8, 0xa8, 0xa8, 0xa8, 0xa8
+   };
+
+/* As sztable, plus parity */
+static unsigned char __scratch_y("z80_flags") szptable[256] = {
+      0x44, 0x00, 0x00, 0x04, 0x00, 0x04, 0x04, 0x00, 0x08, 0x0c, 0x0c, 0x08, 0x0c, 0x08, 0x08, 0x0c,
+      0x00, 0x04, 0x04, 0x00, 0x04, 0x00, 0x00, 0x04, 0x0c, 0x08, 0x08, 0x0c, 0x08, 0x0c, 0x0c, 0x08,
+      0x20, 0x24, 0x24, 0x20, 0x24, 0x20, 0x20, 0x24, 0x2c, 0x28, 0x28, 0x2c, 0x28, 0x2c, 0x2c, 0x28,
+      0x24, 0x20, 0x20, 0x24, 0x20, 0x24, 0x24, 0x20, 0x28, 0x2c, 0x2c, 0x28, 0x2c, 0x28, 0x28, 0x2c,
+      0x00, 0x04, 0x04, 0x00, 0x04, 0x00, 0x00, 0x04, 0x0c, 0x08, 0x08, 0x0c, 0x08, 0x0c, 0x0c, 0x08,
+      0x04, 0x00, 0x00, 0x04, 0x00, 0x04, 0x04, 0x00, 0x08, 0x0c, 0x0c, 0x08, 0x0c, 0x08, 0x08, 0x0c,
+      0x24, 0x20, 0x20, 0x24, 0x20, 0x24, 0x24, 0x20, 0x28, 0x2c, 0x2c, 0x28, 0x2c, 0x28, 0x28, 0x2c,
+      0x20, 0x24, 0x24, 0x20, 0x24, 0x20, 0x20, 0x24, 0x2c, 0x28, 0x28, 0x2c, 0x28, 0x2c, 0x2c, 0x28,
+      0x80, 0x84, 0x84, 0x80, 0x84, 0x80, 0x80, 0x84, 0x8c, 0x88, 0x88, 0x8c, 0x88, 0x8c, 0x8c, 0x88,
+      0x84, 0x80, 0x80, 0x84, 0x80, 0x84, 0x84, 0x80, 0x88, 0x8c, 0x8c, 0x88, 0x8c, 0x88, 0x88, 0x8c,
+      0xa4, 0xa0, 0xa0, 0xa4, 0xa0, 0xa4, 0xa4, 0xa0, 0xa8, 0xac, 0xac, 0xa8, 0xac, 0xa8, 0xa8, 0xac,
+      0xa0, 0xa4, 0xa4, 0xa0, 0xa4, 0xa0, 0xa0, 0xa4, 0xac, 0xa8, 0xa8, 0xac, 0xa8, 0xac, 0xac, 0xa8,
+      0x84, 0x80, 0x80, 0x84, 0x80, 0x84, 0x84, 0x80, 0x88, 0x8c, 0x8c, 0x88, 0x8c, 0x88, 0x88, 0x8c,
+      0x80, 0x84, 0x84, 0x80, 0x84, 0x80, 0x80, 0x84, 0x8c, 0x88, 0x88, 0x8c, 0x88, 0x8c, 0x8c, 0x88,
+      0xa0, 0xa4, 0xa4, 0xa0, 0xa4, 0xa0, 0xa0, 0xa4, 0xac, 0xa8, 0xa8, 0xac, 0xa8, 0xac, 0xac, 0xa8,
+      0xa4, 0xa0, 0xa0, 0xa4, 0xa0, 0xa4, 0xa4, 0xa0, 0xa8, 0xac, 0xac, 0xa8, 0xac, 0xa8, 0xa8, 0xac
+   };
+
+/* Flags (except carry) after INC, indexed by result */
+static unsigned char __scratch_y("z80_flags") incflags[256] = {
+      0x50, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08,
+      0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08,
+      0x30, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28,
+      0x30, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28,
+      0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08,
+      0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08,
+      0x30, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28,
+      0x30, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28,
+      0x94, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88,
+      0x90, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88,
+      0xb0, 0xa0, 0xa0, 0xa0, 0xa0, 0xa0, 0xa0, 0xa0, 0xa8, 0xa8, 0xa8, 0xa8, 0xa8, 0xa8, 0xa8, 0xa8,
+      0xb0, 0xa0, 0xa0, 0xa0, 0xa0, 0xa0, 0xa0, 0xa0, 0xa8, 0xa8, 0xa8, 0xa8, 0xa8, 0xa8, 0xa8, 0xa8,
+      0x90, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88,
+      0x90, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88,
+      0xb0, 0xa0, 0xa0, 0xa0, 0xa0, 0xa0, 0xa0, 0xa0, 0xa8, 0xa8, 0xa8, 0xa8, 0xa8, 0xa8, 0xa8, 0xa8,
+      0xb0, 0xa0, 0xa0, 0xa0, 0xa0, 0xa0, 0xa0, 0xa0, 0xa8, 0xa8, 0xa8, 0xa8, 0xa8, 0xa8, 0xa8, 0xa8
+   };
+
+/* Flags (except carry) after DEC, indexed by result */
+static unsigned char __scratch_y("z80_flags") decflags[256] = {
+      0x42, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0a, 0x0a, 0x0a, 0x0a, 0x0a, 0x0a, 0x0a, 0x1a,
+      0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0a, 0x0a, 0x0a, 0x0a, 0x0a, 0x0a, 0x0a, 0x1a,
+      0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x3a,
+      0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x3a,
+      0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0a, 0x0a, 0x0a, 0x0a, 0x0a, 0x0a, 0x0a, 0x1a,
+      0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0a, 0x0a, 0x0a, 0x0a, 0x0a, 0x0a, 0x0a, 0x1a,
+      0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x3a,
+      0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x2a, 0x3e,
+      0x82, 0x82, 0x82, 0x82, 0x82, 0x82, 0x82, 0x82, 0x8a, 0x8a, 0x8a, 0x8a, 0x8a, 0x8a, 0x8a, 0x9a,
+      0x82, 0x82, 0x82, 0x82, 0x82, 0x82, 0x82, 0x82, 0x8a, 0x8a, 0x8a, 0x8a, 0x8a, 0x8a, 0x8a, 0x9a,
+      0xa2, 0xa2, 0xa2, 0xa2, 0xa2, 0xa2, 0xa2, 0xa2, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xba,
+      0xa2, 0xa2, 0xa2, 0xa2, 0xa2, 0xa2, 0xa2, 0xa2, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xba,
+      0x82, 0x82, 0x82, 0x82, 0x82, 0x82, 0x82, 0x82, 0x8a, 0x8a, 0x8a, 0x8a, 0x8a, 0x8a, 0x8a, 0x9a,
+      0x82, 0x82, 0x82, 0x82, 0x82, 0x82, 0x82, 0x82, 0x8a, 0x8a, 0x8a, 0x8a, 0x8a, 0x8a, 0x8a, 0x9a,
+      0xa2, 0xa2, 0xa2, 0xa2, 0xa2, 0xa2, 0xa2, 0xa2, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xba,
+      0xa2, 0xa2, 0xa2, 0xa2, 0xa2, 0xa2, 0xa2, 0xa2, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xba
+   };
+
+MACHINE_STATE unsigned long tstates = 0;
+MACHINE_STATE unsigned int spin_break = 0;
+#ifdef Z80_HOST
+MACHINE_STATE unsigned long long z80_instructions = 0;
+#endif
+
+#ifdef Z80_PROFILE
+/* Opcode profile. Executions and tstates for each opcode of each page,
+ * the tstates spent on displayed bytes and on instructions, and the ZX81
+ * sync steps run and skipped per frame. Written
+ * to PROFILE_FILE (stdout on the host) every PROFILE_FRAMES frames */
+#define PROF_MAIN   0
+#define PROF_CB     1
+#define PROF_ED     2
+#define PROF_DD     3
+#define PROF_FD     4
+#define PROF_DDCB   5
+#define PROF_FDCB   6
+#define PROF_PAGES  7
+
+#define PROFILE_FRAMES  3000
+#define PROFILE_FILE    "/z80prof.csv"
+
+static MACHINE_STATE uint32_t prof_count[PROF_PAGES << 8];
+static MACHINE_STATE uint32_t prof_tstates[PROF_PAGES << 8];
+static MACHINE_STATE uint64_t prof_display_ts = 0;
+static MACHINE_STATE uint64_t prof_instr_ts = 0;
+static MACHINE_STATE uint32_t prof_frames = 0;
+static MACHINE_STATE uint64_t prof_sync_steps = 0;
+static MACHINE_STATE uint64_t prof_sync_skipped = 0;
+static MACHINE_STATE uint64_t prof_dfile_chars = 0;
+static const char* prof_page_name[PROF_PAGES] = {"", "CB", "ED", "DD", "FD", "DDCB", "FDCB"};
+#endif
+
+#ifdef PC_PROFILE
+/* Sampled PC profile. The PC is sampled at each HSYNC (and so at each NMI
+ * in SLOW mode) into 4 byte buckets over the 8K ROM and 64 byte buckets
+ * above it. In SLOW mode the display is generated by INTERRUPT, so its
+ * time is credited there. When a bucket fills all the counts are halved,
+ * so the profile favours recent activity */
+#define PCPROF_ROM_SHIFT    2
+#define PCPROF_RAM_SHIFT    6
+#define PCPROF_ROM_BUCKETS  (0x2000 >> PCPROF_ROM_SHIFT)
+#define PCPROF_BUCKETS      (PCPROF_ROM_BUCKETS + (0xe000 >> PCPROF_RAM_SHIFT))
+#define PCPROF_FILE         "/pcprof.csv"
+
+static MACHINE_STATE uint16_t pcprof_hist[PCPROF_BUCKETS];
+static MACHINE_STATE uint32_t pcprof_samples = 0;
+#endif
+
+#ifdef Z80_BREAK
+/* Breakpoints on instructions, memory reads and writes and port I/O.
+ * membreak has the BREAK_ bits of the breakpoints in each 1K page, and
+ * each flagged page has a bitmap of the addresses with a breakpoint, so
+ * accesses to other pages are not checked further. Instructions are only
+ * checked by the exec loops generated with CFG_BREAK, which is set while
+ * any breakpoint is armed. A hit stops the frame after the instruction,
+ * or before it for BREAK_EXEC, and the next call continues the frame */
+MACHINE_STATE unsigned char membreak[64];
+MACHINE_STATE unsigned char break_io = 0;
+static MACHINE_STATE Breakpoint_T breakpoints[BREAK_MAX];
+static MACHINE_STATE unsigned char break_bits[BREAK_MAX][0x400 >> 3];
+static MACHINE_STATE unsigned char break_bitmap[64];
+static MACHINE_STATE bool break_armed = false;
+static MACHINE_STATE bool break_stop = false;
+static MACHINE_STATE bool break_resume = false;
+static MACHINE_STATE unsigned short break_pc = 0;
+static MACHINE_STATE BreakHit_T break_hit;
+#endif
+
+#ifdef Z80_TRACE
+/* Trace of the most recent instruction fetches (including displayed
+ * bytes), in a ring of packed 16 byte records. When the trigger pc is
+ * fetched, or the trigger address written, recording continues for half
+ * the ring and then stops, so that the ring holds the instructions either
+ * side of the trigger until it is written to TRACE_FILE (stdout on the
+ * host). A trigger fires once */
+#ifndef Z80_TRACE_RECORDS
+#define Z80_TRACE_RECORDS   1024
+#endif
+#ifndef Z80_TRACE_PC
+#define Z80_TRACE_PC        -1
+#endif
+#ifndef Z80_TRACE_ADDR
+#define Z80_TRACE_ADDR      -1
+#endif
+#define TRACE_MASK          (Z80_TRACE_RECORDS - 1)
+#define TRACE_FILE          "/z80trace.csv"
+
+typedef struct
+{
+  uint16_t addr;            // pc of the fetch
+  uint8_t opcode;           // First byte, so the prefix of CB, DD, ED and FD ops
+  uint8_t acc;
+  uint16_t pair[4];         // BC, DE, HL and SP
+  uint16_t tstate;          // tstates into the frame
+  uint16_t raster;          // RasterY << 7 | RasterX >> 2
+} TraceRecord_T;
+
+_Static_assert(sizeof(TraceRecord_T) == 16, "Trace records must be 16 bytes");
+_Static_assert((Z80_TRACE_RECORDS & TRACE_MASK) == 0, "Z80_TRACE_RECORDS must be a power of 2");
+
+static MACHINE_STATE TraceRecord_T trace_ring[Z80_TRACE_RECORDS];
+static MACHINE_STATE uint32_t trace_next = 0;
+static MACHINE_STATE uint32_t trace_post = 0;
+static MACHINE_STATE bool trace_frozen = false;
+static MACHINE_STATE int trace_pc = Z80_TRACE_PC;
+MACHINE_STATE int trace_addr = Z80_TRACE_ADDR;
+#endif
 const unsigned long tsmax = 65000;
-static unsigned long ts = 0;
 
-static unsigned char* scrnbmp_new = 0;
+static MACHINE_STATE unsigned char* scrnbmp_new = 0;
+#ifdef SUPPORT_CHROMA
+static MACHINE_STATE unsigned char* scrnbmpc_new = 0;
+#endif
+
+/* The display bytes of consecutive pseudo nops form one run of output
+ * bytes, which is assembled into aligned 32 bit words (little endian, as
+ * for the RP2040 and the host) before being stored. Bytes at the ends of
+ * a run that do not fill a word are stored singly */
+typedef struct
+{
+  uint8_t* ptr;             // Address of the next byte
+  uint32_t word;            // Bytes of the word holding ptr
+  int first;                // First lane of word in the run
+  uint8_t* limit;           // End of the lines prepared for the run
+} EmitStream_T;
+
+static MACHINE_STATE EmitStream_T emit_pix;
+#ifdef SUPPORT_CHROMA
+static MACHINE_STATE EmitStream_T emit_chr;
+static MACHINE_STATE bool emit_chroma = false;
+#endif
+static MACHINE_STATE int emit_next = -1;        // Position that continues the run, -1 for none
+static MACHINE_STATE uint8_t emit_carry;        // Low bits of the last byte, when not aligned
+static MACHINE_STATE uint8_t emit_shift;        // Bit offset of the run
+
+/* Frame buffers are cleared lazily. For each buffer there is a map of
+ * the lines that may hold pixels from the last frame drawn in it, and for
+ * chroma, of the lines that may hold colours other than the fill of that
+ * frame. A mapped line is cleared when the new frame first writes to it,
+ * and the mapped lines that the frame did not write are cleared when it
+ * is displayed. So the buffer is the same as if it had been cleared at
+ * the start, but lines that are already clear are not written again */
+#define FRAME_LINES_MAX     320
+#define FRAME_LINE_WORDS    (FRAME_LINES_MAX >> 5)
+#define FRAME_BUFFERS       4
+
+typedef struct
+{
+  uint8_t* buff;
+  uint32_t used[FRAME_LINE_WORDS];
+#ifdef SUPPORT_CHROMA
+  uint32_t cused[FRAME_LINE_WORDS];
+  int cfill;                // Colour of the other chroma lines, -1 if unknown
+#endif
+} FrameLines_T;
+
+static MACHINE_STATE FrameLines_T frame_lines[FRAME_BUFFERS];
+static MACHINE_STATE FrameLines_T* frame_cur = 0;
+static MACHINE_STATE int frame_evict = 0;
+static MACHINE_STATE uint32_t frame_written[FRAME_LINE_WORDS];
 #ifdef SUPPORT_CHROMA
-static unsigned char* scrnbmpc_new = 0;
+static MACHINE_STATE uint32_t frame_cwritten[FRAME_LINE_WORDS];
+static MACHINE_STATE int frame_cfill = -1;      // Chroma fill of this frame, -1 for none
 #endif
 
-static int vsx = 0;
-static int vsy = 0;
-int ay_reg = 0;
-int LastInstruction;
-bool frameNotSync = true;
+MACHINE_STATE int ay_reg = 0;
+MACHINE_STATE int LastInstruction;
+MACHINE_STATE bool frameNotSync = true;
 
 // Horizontal line timings
 #define HLENGTH       207 // TStates in horizontal scanline
@@ -79,40 +326,16 @@ bool frameNotSync = true;
 
 static const int HSYNC_TOLERANCEMIN = HSCAN - HTOL;
 static const int HSYNC_TOLERANCEMAX = HSCAN + HTOL;
-static int FRAME_SCAN = SCAN50;
 
 static const int HSYNC_MINLEN = HMIN;
 static const int HSYNC_MAXLEN = HMAX;
 static const int VSYNC_MINLEN = VMIN;
 
-static int VSYNC_TOLERANCEMIN = SCAN50 - VTOL;
-static int VSYNC_TOLERANCEMAX = SCAN50 + VTOL;
-
 static const int HSYNC_START = 16;
 static const int HSYNC_END = 32;
 static const int HLEN = HLENGTH;
 static const int MAX_JMP = 8;
 
-static int RasterX = 0;
-static int RasterY = 0;
-static int dest;
-
-static int adjustStartX = 0;
-static int adjustStartY = 0;
-static int startX = 0;
-static int startY = 0;
-static int syncX = 0;
-static int endX = 0;
-static int endY = 0;
-
-static int nmi_pending, hsync_pending;
-static int NMI_generator;
-static int VSYNC_state, HSYNC_state, SYNC_signal;
-static int psync, sync_len;
-static int rowcounter = 0;
-static int hsync_counter = 0;
-static bool rowcounter_hold = false;
-
 static void setRemainingDisplayBoundaries(void);
 static void displayAndNewScreen(bool sync);
 static inline void checkhsync(int tolchk);
@@ -124,54 +347,217 @@ static void vsync_lower(void);
 static inline int z80_interrupt(void);
 static inline int nmi_interrupt(void);
 static unsigned long z80_op(void);
+static inline bool haltSkip(void);
+static inline bool dfileRun(void);
+static void emitFlush(void);
+static void frameStart(bool cleared);
+static void frameComplete(void);
+static uint8_t* framePrepare(uint8_t* p, bool chroma);
+static inline bool syncAdvance(int inc);
+#ifdef Z80_PROFILE
+static void profileFrame(void);
+#endif
+#ifdef PC_PROFILE
+static inline void pcProfileSample(void);
+#endif
+#ifdef Z80_TRACE
+static inline void traceRecord(void);
+#endif
+#ifdef Z80_BREAK
+static bool breakExec(void);
+#endif
 
 #ifdef LOAD_AND_SAVE
 static void loadAndSaveROM(void);
+
+#ifdef Z80_HOST
+// Cleared when the code being run is not a ZX80 or ZX81 ROM
+static MACHINE_STATE bool rom_traps = true;
+#else
+#define rom_traps true
+#endif
+#endif
+
+#ifdef CALC_HLE
+static unsigned long calculateROM(unsigned long tstore);
+#endif
+
+#ifdef ROM_HLE
+static unsigned long romHLE(unsigned long tstore);
 #endif
 
-int sound_type = SOUND_TYPE_NONE;
-bool m1not = false;
-bool useWRX = false;
-bool UDGEnabled = false;
-bool useQSUDG = false;
-bool LowRAM = false;
-bool chr128 = false;
-bool useNTSC = false;
-bool frameSync = false;
-bool running_rom = false;
-
-unsigned char a, f, b, c, d, e, h, l;
-unsigned char r, a1, f1, b1, c1, d1, e1, h1, l1, i, iff1, iff2, im;
-unsigned short pc;
-unsigned short ix, iy, sp;
-unsigned char radjust;
-unsigned char ixoriy, new_ixoriy;
-unsigned char intsample = 0;
-unsigned char op;
-unsigned short m1cycles;
+MACHINE_STATE int sound_type = SOUND_TYPE_NONE;
+MACHINE_STATE bool m1not = false;
+MACHINE_STATE bool useWRX = false;
+MACHINE_STATE bool UDGEnabled = false;
+MACHINE_STATE bool useQSUDG = false;
+MACHINE_STATE bool LowRAM = false;
+MACHINE_STATE bool chr128 = false;
+MACHINE_STATE bool useNTSC = false;
+MACHINE_STATE bool frameSync = false;
+MACHINE_STATE bool running_rom = false;
+
+/* CPU clock multiplier, as a shift. The fraction of a ULA tstate carried
+ * between instructions (turbo_frac) and turbo_hold, set from the NMI that
+ * starts the display until the NMI generator is turned back on, are held
+ * in the ULA state */
+#define TURBO_VSYNC (HLENGTH * 8)
+
+static MACHINE_STATE unsigned int turbo_shift = 0;
+
+/* Flags are evaluated lazily. The ALU, INC and DEC operations record the
+ * result and operands, and f is only constructed when read via getf() */
+#define LAZY_NONE   0
+#define LAZY_LOGIC  1
+#define LAZY_ADD    2
+#define LAZY_SUB    3
+#define LAZY_INC    4
+#define LAZY_DEC    5
 
 /* ZX80 specific */
 #define SYNCNONE        0
 #define SYNCTYPEH       1
 #define SYNCTYPEV       2
 
-static int S_RasterX = 0;
-static int S_RasterY = 0;
-
-static int scanlineCounter = 0;
-
-static int videoFlipFlop1Q = 1;
-static int videoFlipFlop2Q = 0;
-static int videoFlipFlop3Q = 0;
-static int videoFlipFlop3Clear = 0;
-static int prevVideoFlipFlop3Q = 0;
-
-static int lineClockCarryCounter = 0;
+/* The CPU and ULA state is held in a single structure, so that the exec
+ * loops reach every register and counter as an offset from one base
+ * address, and so that a snapshot is a single block copy. The RP2040 has
+ * no data cache, so there is no cache line to align the structure to */
+typedef struct
+{
+  unsigned char a, f, b, c, d, e, h, l;
+  unsigned char a1, f1, b1, c1, d1, e1, h1, l1;
+  unsigned char r, i, iff1, iff2, im, radjust;
+  unsigned char ixoriy, new_ixoriy, intsample, op;
+  unsigned char lazyf, lazya, lazyz, lazyc;
+  unsigned short pc, sp, ix, iy;
+  unsigned short m1cycles, lazyy;
+} Z80State_T;
+
+typedef struct
+{
+  unsigned long ts;
+  int vsx, vsy;
+  int FRAME_SCAN, VSYNC_TOLERANCEMIN, VSYNC_TOLERANCEMAX;
+
+  int RasterX, RasterY, dest;
+  int adjustStartX, adjustStartY;
+  int startX, startY, syncX, endX, endY;
+
+  int nmi_pending, hsync_pending, NMI_generator;
+  int VSYNC_state, HSYNC_state, SYNC_signal;
+  int psync, sync_len;
+  int rowcounter, hsync_counter;
+  bool rowcounter_hold;
+
+  /* Turbo */
+  unsigned int turbo_frac;
+  bool turbo_hold;
+
+  /* ZX80 specific */
+  bool vsyncFound;
+  int S_RasterX, S_RasterY;
+  int scanlineCounter;
+  int videoFlipFlop1Q, videoFlipFlop2Q, videoFlipFlop3Q;
+  int videoFlipFlop3Clear, prevVideoFlipFlop3Q;
+  int lineClockCarryCounter;
+  int scanline_len, sync_type, nosync_lines;
+} ULAState_T;
+
+typedef struct
+{
+  Z80State_T cpu;
+  ULAState_T ula;
+} ZX8xState_T;
+
+static MACHINE_STATE ZX8xState_T zx = {
+  .ula.FRAME_SCAN = SCAN50,
+  .ula.VSYNC_TOLERANCEMIN = SCAN50 - VTOL,
+  .ula.VSYNC_TOLERANCEMAX = SCAN50 + VTOL,
+  .ula.videoFlipFlop1Q = 1,
+  .ula.sync_type = SYNCNONE
+};
+
+#define a                      (zx.cpu.a)
+#define f                      (zx.cpu.f)
+#define b                      (zx.cpu.b)
+#define c                      (zx.cpu.c)
+#define d                      (zx.cpu.d)
+#define e                      (zx.cpu.e)
+#define h                      (zx.cpu.h)
+#define l                      (zx.cpu.l)
+#define a1                     (zx.cpu.a1)
+#define f1                     (zx.cpu.f1)
+#define b1                     (zx.cpu.b1)
+#define c1                     (zx.cpu.c1)
+#define d1                     (zx.cpu.d1)
+#define e1                     (zx.cpu.e1)
+#define h1                     (zx.cpu.h1)
+#define l1                     (zx.cpu.l1)
+#define r                      (zx.cpu.r)
+#define i                      (zx.cpu.i)
+#define iff1                   (zx.cpu.iff1)
+#define iff2                   (zx.cpu.iff2)
+#define im                     (zx.cpu.im)
+#define radjust                (zx.cpu.radjust)
+#define ixoriy                 (zx.cpu.ixoriy)
+#define new_ixoriy             (zx.cpu.new_ixoriy)
+#define intsample              (zx.cpu.intsample)
+#define op                     (zx.cpu.op)
+#define lazyf                  (zx.cpu.lazyf)
+#define lazya                  (zx.cpu.lazya)
+#define lazyz                  (zx.cpu.lazyz)
+#define lazyc                  (zx.cpu.lazyc)
+#define pc                     (zx.cpu.pc)
+#define sp                     (zx.cpu.sp)
+#define ix                     (zx.cpu.ix)
+#define iy                     (zx.cpu.iy)
+#define m1cycles               (zx.cpu.m1cycles)
+#define lazyy                  (zx.cpu.lazyy)
+
+#define ts                     (zx.ula.ts)
+#define vsx                    (zx.ula.vsx)
+#define vsy                    (zx.ula.vsy)
+#define FRAME_SCAN             (zx.ula.FRAME_SCAN)
+#define VSYNC_TOLERANCEMIN     (zx.ula.VSYNC_TOLERANCEMIN)
+#define VSYNC_TOLERANCEMAX     (zx.ula.VSYNC_TOLERANCEMAX)
+#define RasterX                (zx.ula.RasterX)
+#define RasterY                (zx.ula.RasterY)
+#define dest                   (zx.ula.dest)
+#define adjustStartX           (zx.ula.adjustStartX)
+#define adjustStartY           (zx.ula.adjustStartY)
+#define startX                 (zx.ula.startX)
+#define startY                 (zx.ula.startY)
+#define syncX                  (zx.ula.syncX)
+#define endX                   (zx.ula.endX)
+#define endY                   (zx.ula.endY)
+#define nmi_pending            (zx.ula.nmi_pending)
+#define hsync_pending          (zx.ula.hsync_pending)
+#define NMI_generator          (zx.ula.NMI_generator)
+#define VSYNC_state            (zx.ula.VSYNC_state)
+#define HSYNC_state            (zx.ula.HSYNC_state)
+#define SYNC_signal            (zx.ula.SYNC_signal)
+#define psync                  (zx.ula.psync)
+#define sync_len               (zx.ula.sync_len)
+#define rowcounter             (zx.ula.rowcounter)
+#define hsync_counter          (zx.ula.hsync_counter)
+#define rowcounter_hold        (zx.ula.rowcounter_hold)
+#define turbo_frac             (zx.ula.turbo_frac)
+#define turbo_hold             (zx.ula.turbo_hold)
+#define vsyncFound             (zx.ula.vsyncFound)
+#define S_RasterX              (zx.ula.S_RasterX)
+#define S_RasterY              (zx.ula.S_RasterY)
+#define scanlineCounter        (zx.ula.scanlineCounter)
+#define videoFlipFlop1Q        (zx.ula.videoFlipFlop1Q)
+#define videoFlipFlop2Q        (zx.ula.videoFlipFlop2Q)
+#define videoFlipFlop3Q        (zx.ula.videoFlipFlop3Q)
+#define videoFlipFlop3Clear    (zx.ula.videoFlipFlop3Clear)
+#define prevVideoFlipFlop3Q    (zx.ula.prevVideoFlipFlop3Q)
+#define lineClockCarryCounter  (zx.ula.lineClockCarryCounter)
+#define scanline_len           (zx.ula.scanline_len)
+#define sync_type              (zx.ula.sync_type)
+#define nosync_lines           (zx.ula.nosync_lines)
 
-static int scanline_len = 0;
-static int sync_type = SYNCNONE;
-static int nosync_lines = 0;
-static bool vsyncFound = false;
 
 static const int scanlinePixelLength = (HLENGTH << 1);
 static const int ZX80HSyncDuration = 20;
@@ -233,6 +619,11 @@ void resetZ80(void)
   a = f = b = c = d = e = h = l = 0;
   a1 = f1 = b1 = c1 = d1 = e1 = h1 = l1 = i = iff1 = iff2 = im = r = 0;
   ixoriy = new_ixoriy = 0;
+  lazyf = LAZY_NONE;
+  spin_break++;
+#if (defined LOAD_AND_SAVE) && (defined Z80_HOST)
+  rom_traps = true;
+#endif
   ix= iy = sp = pc = 0;
   radjust = 0;
   intsample = 0;
@@ -246,7 +637,12 @@ void resetZ80(void)
   sync_len = 0;
   running_rom = false;
   frameNotSync = true;
+  turbo_frac = 0;
+  turbo_hold = false;
   LastInstruction = LASTINSTNONE;
+#ifdef PC_PROFILE
+  z80_pcProfileReset();
+#endif
 
   /* ULA */
   NMI_generator = 0;
@@ -290,6 +686,7 @@ void resetZ80(void)
     displayGetFreeBuffer(&scrnbmp_new);
   }
 
+  emitFlush();
   if (scrnbmp_new)
   {
     memset(scrnbmp_new, 0x00, disp.length);
@@ -298,6 +695,7 @@ void resetZ80(void)
     /* Need a chroma buffer ready in case it is switched on mid frame */
     displayGetChromaBuffer(&scrnbmpc_new, scrnbmp_new);
 #endif
+    frameStart(true);
   }
 
   if(autoload)
@@ -372,7 +770,7 @@ void resetZ80(void)
 #ifdef LOAD_AND_SAVE
 static void __not_in_flash_func(loadAndSaveROM)(void)
 {
-  static int sound_cache;
+  static MACHINE_STATE int sound_cache;
 
   if (!running_rom)
   {
@@ -406,6 +804,7 @@ static void __not_in_flash_func(loadAndSaveROM)(void)
       if (sound_type != SOUND_TYPE_VSYNC)
       {
         sound_type = SOUND_TYPE_VSYNC;
+        setSoundPageHandler();
         emu_sndInit(true, false);
       }
     }
@@ -425,8 +824,161 @@ static void __not_in_flash_func(loadAndSaveROM)(void)
 }
 #endif
 
+/* Returns the line map of the frame buffer buff */
+static FrameLines_T* __not_in_flash_func(frameLines)(uint8_t* buff)
+{
+  FrameLines_T* fl;
+
+  for (int n = 0; n < FRAME_BUFFERS; n++)
+  {
+    if (frame_lines[n].buff == buff)
+      return &frame_lines[n];
+  }
+
+  // A buffer not seen before may hold anything
+  fl = &frame_lines[frame_evict];
+  frame_evict = (frame_evict + 1) % FRAME_BUFFERS;
+  fl->buff = buff;
+  memset(fl->used, 0xff, sizeof(fl->used));
+#ifdef SUPPORT_CHROMA
+  memset(fl->cused, 0xff, sizeof(fl->cused));
+  fl->cfill = -1;
+#endif
+  return fl;
+}
+
+/* Starts a frame in scrnbmp_new, which has just been cleared if cleared
+ * is true */
+static void __not_in_flash_func(frameStart)(bool cleared)
+{
+  frame_cur = frameLines(scrnbmp_new);
+  if (cleared || (disp.height > FRAME_LINES_MAX))
+  {
+    if (!cleared)
+      memset(scrnbmp_new, 0x00, disp.length);
+    memset(frame_cur->used, 0, sizeof(frame_cur->used));
+  }
+  memset(frame_written, 0, sizeof(frame_written));
+
+#ifdef SUPPORT_CHROMA
+  frame_cfill = chromamode ? fullcolour : -1;
+  if ((frame_cfill >= 0) && (disp.height > FRAME_LINES_MAX))
+  {
+    memset(scrnbmpc_new, fullcolour, disp.length);
+    memset(frame_cur->cused, 0, sizeof(frame_cur->cused));
+    frame_cur->cfill = frame_cfill;
+  }
+  memset(frame_cwritten, 0, sizeof(frame_cwritten));
+#endif
+}
+
+/* Called before the first write of the frame to the line holding p.
+ * Returns the end of the line */
+static uint8_t* __not_in_flash_func(framePrepare)(uint8_t* p, bool chroma)
+{
+  uint8_t* base = scrnbmp_new;
+  uint32_t* written = frame_written;
+  int line;
+
+#ifdef SUPPORT_CHROMA
+  if (chroma)
+  {
+    base = scrnbmpc_new;
+    written = frame_cwritten;
+  }
+#endif
+
+  // The byte before the buffer, and any bytes after it, are never cleared
+  if (p < base)
+    return base;
+  line = (p - base) / disp.stride_byte;
+  if ((line >= disp.height) || (line >= FRAME_LINES_MAX))
+    return base + disp.length + disp.stride_byte;
+
+  if (!(written[line >> 5] & (1 << (line & 31))))
+  {
+    written[line >> 5] |= 1 << (line & 31);
+#ifdef SUPPORT_CHROMA
+    if (chroma)
+    {
+      if ((frame_cfill >= 0) &&
+          ((frame_cur->cused[line >> 5] & (1 << (line & 31))) || (frame_cur->cfill != frame_cfill)))
+      {
+        memset(base + line * disp.stride_byte, frame_cfill, disp.stride_byte);
+      }
+    }
+    else
+#endif
+    if (frame_cur->used[line >> 5] & (1 << (line & 31)))
+    {
+      memset(base + line * disp.stride_byte, 0x00, disp.stride_byte);
+    }
+  }
+  return base + (line + 1) * disp.stride_byte;
+}
+
+/* Clears the lines left from the last frame in the buffer that this frame
+ * did not write, and records the lines that it did */
+static void __not_in_flash_func(frameComplete)(void)
+{
+  int lines = (disp.height < FRAME_LINES_MAX) ? disp.height : FRAME_LINES_MAX;
+
+  for (int line = 0; line < lines; line++)
+  {
+    uint32_t bit = 1 << (line & 31);
+
+    if ((frame_cur->used[line >> 5] & bit) && !(frame_written[line >> 5] & bit))
+    {
+      memset(scrnbmp_new + line * disp.stride_byte, 0x00, disp.stride_byte);
+    }
+  }
+  memcpy(frame_cur->used, frame_written, sizeof(frame_written));
+
+#ifdef SUPPORT_CHROMA
+  if (frame_cfill >= 0)
+  {
+    for (int line = 0; line < lines; line++)
+    {
+      uint32_t bit = 1 << (line & 31);
+
+      if (!(frame_cwritten[line >> 5] & bit) &&
+          ((frame_cur->cused[line >> 5] & bit) || (frame_cur->cfill != frame_cfill)))
+      {
+        memset(scrnbmpc_new + line * disp.stride_byte, frame_cfill, disp.stride_byte);
+      }
+    }
+    memcpy(frame_cur->cused, frame_cwritten, sizeof(frame_cwritten));
+    frame_cur->cfill = frame_cfill;
+  }
+  else
+  {
+    // Not filled, so only the written lines have changed
+    for (int n = 0; n < FRAME_LINE_WORDS; n++)
+    {
+      frame_cur->cused[n] |= frame_cwritten[n];
+    }
+  }
+#endif
+}
+
+/* Forgets what the frame buffers hold, other than the one being drawn,
+ * after they have been written outside the emulation (e.g. by a menu) */
+void resetFrameLines(void)
+{
+  for (int n = 0; n < FRAME_BUFFERS; n++)
+  {
+    if (&frame_lines[n] != frame_cur)
+    {
+      frame_lines[n].buff = 0;
+    }
+  }
+}
+
 static void __not_in_flash_func(displayAndNewScreen)(bool sync)
 {
+  emitFlush();
+  frameComplete();
+
   // Display the current screen
   displayBuffer(scrnbmp_new, sync, true, (chromamode != 0));
   displayGetFreeBuffer(&scrnbmp_new);
@@ -435,17 +987,16 @@ static void __not_in_flash_func(displayAndNewScreen)(bool sync)
   /* Need a chroma buffer ready in case it is switched on mid frame */
   displayGetChromaBuffer(&scrnbmpc_new, scrnbmp_new);
 #endif
-  // Clear the new screen - we have 3 buffers, so will not
-  // have race with switching the screens to be displayed
-  memset(scrnbmp_new, 0x00, disp.length);
 #ifdef SUPPORT_CHROMA
   if (chromamode && (bordercolournew != bordercolour))
   {
     bordercolour = bordercolournew;
     fullcolour = (bordercolour << 4) + bordercolour;
   }
-  if (chromamode) memset(scrnbmpc_new, fullcolour, disp.length);
 #endif
+  // The new screen is cleared as it is drawn - we have 3 buffers, so
+  // will not have race with switching the screens to be displayed
+  frameStart(false);
 }
 
 static void __not_in_flash_func(vsync_raise)(void)
@@ -472,6 +1023,23 @@ static void __not_in_flash_func(vsync_raise)(void)
   }
 }
 
+/* Prepares the lines filled by vsync_lower for the new position nx, ny */
+static void __not_in_flash_func(vsyncPrepare)(int nx, int ny)
+{
+  int first = (vsy * disp.stride_byte + (vsx >> 3) - 1) / disp.stride_byte;
+  int last = (ny * disp.stride_byte + (nx >> 3)) / disp.stride_byte;
+
+  // Wrapping round the frame fills to the bottom, then from the top
+  if ((ny < vsy) || ((ny == vsy) && (nx < vsx)))
+  {
+    for (int line = first; line < disp.height; line++)
+      framePrepare(scrnbmp_new + line * disp.stride_byte, false);
+    first = 0;
+  }
+  for (int line = first; line <= last; line++)
+    framePrepare(scrnbmp_new + line * disp.stride_byte, false);
+}
+
 /* for vsync on -> off */
 static void __not_in_flash_func(vsync_lower)(void)
 {
@@ -498,6 +1066,9 @@ static void __not_in_flash_func(vsync_lower)(void)
   // leave if start and end are same pixel
   if ((nx == vsx) && (ny == vsy)) return;
 
+  emitFlush();
+  vsyncPrepare(nx, ny);
+
   // Determine if there is a frame wrap
   if((ny < vsy) || ((ny == vsy) && (nx < vsx)))
   {
@@ -532,412 +1103,861 @@ static void __not_in_flash_func(vsync_lower)(void)
   }
 }
 
-void __not_in_flash_func(execZX81)(void)
-{
-  do
-  {
-    if(nmi_pending)
-    {
-      ts = nmi_interrupt();
-      tstates += ts;
-      nmi_pending = 0;
-    }
-    else if (iff1 && intsample && !((radjust - 1) & 0x40))
-    {
-      ts = z80_interrupt();
-      hsync_counter = -2;             /* INT ACK after two tstates */
-      hsync_pending = 1;              /* a HSYNC may be started */
-      tstates += ts;
-    }
-    else
-    {
-      // Get the next op, calculate the next byte to display and execute the op
-      op = fetchm(pc);
-
-      // After this instruction can have interrupt
-      intsample = 1;
-
-      if (((pc & 0x8000) && (!m1not || (pc & 0x4000)) && !(op & 0x40)))
-      {
-        if ((RasterX >= startX) &&
-            (RasterX < endX) &&
-            (RasterY >= startY) &&
-            (RasterY < endY))
-        {
-          unsigned char v;
-          int addr;
+/* The display fetch path tests a number of optional features.
+ * The exec loops are generated once with every feature test present, and
+ * once with none, for the plain configuration. execConfig() decides which
+ * to run at the start of each call, and again when chroma is switched on
+ * part way through a frame */
+#define CFG_NONE    0x00
+#define CFG_WRX     0x01
+#define CFG_LOWRAM  0x02
+#define CFG_CHR128  0x04
+#define CFG_UDG     0x08
+#define CFG_CHROMA  0x10
+#ifdef Z80_BREAK
+#define CFG_BREAK   0x20
+#define CFG_ANY     0x3f
+#else
+#define CFG_ANY     0x1f
+#endif
 
-          if ((i < 0x20) || ((i < 0x40) && LowRAM && (!useWRX)))
-          {
-            if (!(chr128 && (i > 0x20) && (i & 1)))
-              addr = ((i & 0xfe) << 8) | ((op & 0x3f) << 3) | rowcounter;
-            else
-              addr = ((i & 0xfe) << 8) | ((((op & 0x80) >> 1) | (op & 0x3f)) << 3) | rowcounter;
+#define CFG_TEST(cfg, bit, flag) (((cfg) & (bit)) && (flag))
 
-            if (UDGEnabled && (addr >= 0x1E00) && (addr < 0x2000))
-            {
-              v = mem[addr + ((op & 0x80) ? 0x6800 : 0x6600)];
-            }
-            else
-            {
-              v = mem[addr];
-            }
-          }
-          else if (useWRX)
-          {
-            v = mem[(i << 8) | (r & 0x80) | (radjust & 0x7f)];
-          }
-          else
-          {
-            v = 0xff;
-          }
-          v = (op & 0x80) ? ~v : v;
+static MACHINE_STATE unsigned long tsexit;
 
-#ifdef SUPPORT_CHROMA
-          if (chromamode)
-          {
-            int k = (dest + RasterX) >> 3;
-            scrnbmpc_new[k] = (chromamode & 0x10) ? fetch(pc) : fetch(0xc000 | ((((op & 0x80) >> 1) | (op & 0x3f)) << 3) | rowcounter);
-            scrnbmp_new[k] = v;
-          }
-          else
+static unsigned int __not_in_flash_func(execConfig)(void)
+{
+  unsigned int cfg = CFG_NONE;
+
+  if (useWRX) cfg |= CFG_WRX;
+  if (LowRAM) cfg |= CFG_LOWRAM;
+  if (chr128) cfg |= CFG_CHR128;
+  if (UDGEnabled || useQSUDG) cfg |= CFG_UDG;
+  if (chromamode) cfg |= CFG_CHROMA;
+#ifdef Z80_BREAK
+  if (break_armed) cfg |= CFG_BREAK;
 #endif
-          {
-            int k = dest + RasterX;
-            int kh = k >> 3;
-            int kl = k & 7;
 
-            if (kl)
-            {
-              scrnbmp_new[kh++] |= (v >> kl);
-              scrnbmp_new[kh] = (v << (8 - kl));
-            }
-            else
-            {
-              scrnbmp_new[kh] = v;
-            }
-          }
-        }
-        /* The CPU sees a nop - so skip the Z80 emulation loop */
-        pc++;
-        radjust++;
+  // A queued sound type change is made by the sound interrupt, so is only
+  // seen here, between frames
+  setSoundPageHandler();
 
-        ts = 4;
-        tstates += ts;
-      }
-      else
-      {
-        ts = z80_op();
+  tsexit = tsmax;
+  return cfg;
+}
 
-        switch(LastInstruction)
-        {
-          case LASTINSTOUTFD:
-            NMI_generator = 0;
-            anyout();
-          break;
+/* Called when a feature is enabled during a frame, so that the running
+ * exec loop returns and the variant is selected again */
+void execConfigChanged(void)
+{
+  tsexit = 0;
+}
 
-          case LASTINSTOUTFE:
-            NMI_generator = 1;
-            anyout();
-          break;
+#ifdef Z80_BREAK
+static void breakRebuild(void)
+{
+  int used = 0;
 
-          case LASTINSTINFE:
-            if (!NMI_generator)
-            {
-              if (VSYNC_state == 0)
-              {
-                VSYNC_state = 1;
-                vsync_raise();
-              }
-            }
-            LastInstruction = LASTINSTNONE;
-          break;
+  memset(membreak, 0, sizeof(membreak));
+  memset(break_bits, 0, sizeof(break_bits));
+  break_io = 0;
+  break_armed = false;
 
-          case LASTINSTOUTFF:
-            anyout();
-          break;
-        }
-      }
-    }
+  for (int n = 0; n < BREAK_MAX; n++)
+  {
+    const Breakpoint_T* bp = &breakpoints[n];
+    unsigned char page = bp->addr >> 10;
 
-    // Determine changes to sync state
-    int states_remaining = ts;
-    int since_hstart = 0;
-    int tswait = 0;
-    int tstate_inc;
+    if (!bp->kind)
+      continue;
 
-    do
+    break_armed = true;
+    if (bp->kind & (BREAK_IN | BREAK_OUT))
     {
-      tstate_inc = states_remaining > MAX_JMP ? MAX_JMP: states_remaining;
-      states_remaining -= tstate_inc;
+      break_io |= bp->kind;
+      continue;
+    }
+    if (!membreak[page])
+      break_bitmap[page] = used++;
+    membreak[page] |= bp->kind;
+    break_bits[break_bitmap[page]][(bp->addr & 0x3ff) >> 3] |= 1 << (bp->addr & 7);
+  }
+  if (!break_armed)
+    break_resume = false;
+  execConfigChanged();
+}
 
-      hsync_counter += tstate_inc;
-      RasterX += (tstate_inc << 1);
+/* Sets slot to a breakpoint of kind (a single BREAK_ bit, or 0 to clear)
+ * at addr, the port low byte for BREAK_IN and BREAK_OUT */
+void z80_breakSet(int slot, int kind, int addr)
+{
+  if ((slot < 0) || (slot >= BREAK_MAX))
+    return;
 
-      if (hsync_counter >= HLEN)
-      {
-          hsync_counter -= HLEN;
-          hsync_pending = 1;
-      }
+  breakpoints[slot].kind = kind;
+  breakpoints[slot].addr = (kind & (BREAK_IN | BREAK_OUT)) ? (addr & 0xff) : addr;
+  breakpoints[slot].hits = 0;
+  breakRebuild();
+}
 
-      // Start of HSYNC, and NMI if enabled
-      if ((hsync_pending == 1) && (hsync_counter >= HSYNC_START))
-      {
-        if (NMI_generator)
-        {
-          nmi_pending = 1;
-          if (ts == 4)
-          {
-            tswait = 14 + (3 - states_remaining - (hsync_counter - HSYNC_START));
-          }
-          else
-          {
-            tswait = 14;
-          }
-          states_remaining += tswait;
-          ts += tswait;
-          tstates += tswait;
-        }
+const Breakpoint_T* z80_breakGet(int slot)
+{
+  return &breakpoints[slot];
+}
 
-        HSYNC_state = 1;
-        since_hstart = hsync_counter - HSYNC_START + 1;
+static void __not_in_flash_func(breakStop)(unsigned char kind, unsigned short addr)
+{
+  break_hit.kind = kind;
+  break_hit.addr = addr;
+  break_hit.instr = break_pc;
+  break_hit.tstates = tstates;
+  break_hit.line = RasterY;
+  break_stop = true;
+  tsexit = 0;
+}
 
-        if (VSYNC_state || rowcounter_hold)
-        {
-          rowcounter = 0;
-          rowcounter_hold = false;
-        }
-        else
-        {
-          rowcounter++;
-          rowcounter &= 7;
-        }
-        hsync_pending = 2;
-      }
+static bool __not_in_flash_func(breakMatch)(unsigned short addr, unsigned char kind)
+{
+  for (int n = 0; n < BREAK_MAX; n++)
+  {
+    if ((breakpoints[n].kind & kind) && (breakpoints[n].addr == addr))
+    {
+      breakpoints[n].hits++;
+      return true;
+    }
+  }
+  return false;
+}
 
-      // end of HSYNC
-      if ((hsync_pending == 2) && (hsync_counter >= HSYNC_END))
-      {
-        HSYNC_state = 0;
-        hsync_pending = 0;
-      }
+/* A read or write of a flagged page */
+void __not_in_flash_func(z80_breakAccess)(unsigned short addr, unsigned char kind)
+{
+  if ((break_bits[break_bitmap[addr >> 10]][(addr & 0x3ff) >> 3] & (1 << (addr & 7))) &&
+      breakMatch(addr, kind))
+  {
+    breakStop(kind, addr);
+  }
+}
 
-      // NOR the vertical and horizontal SYNC states to create the SYNC signal
-      SYNC_signal = (VSYNC_state || HSYNC_state) ? 0 : 1;
-      checksync(since_hstart ? since_hstart : MAX_JMP);
-      since_hstart = 0;
-    }
-    while (states_remaining);
+void __not_in_flash_func(z80_breakPort)(int port, unsigned char kind)
+{
+  if (breakMatch(port & 0xff, kind))
+  {
+    breakStop(kind, port & 0xff);
   }
-  while (tstates < tsmax);
+}
 
-  tstates -= tsmax;
+/* The instruction at pc is about to run. Returns true to stop before it.
+ * After a stop the instruction at the stop is run without checking */
+static bool __not_in_flash_func(breakExec)(void)
+{
+  break_pc = pc;
+
+  if (break_resume)
+  {
+    break_resume = false;
+    if (pc == break_hit.instr)
+      return false;
+  }
+  if ((membreak[pc >> 10] & BREAK_EXEC) &&
+      (break_bits[break_bitmap[pc >> 10]][(pc & 0x3ff) >> 3] & (1 << (pc & 7))) &&
+      breakMatch(pc, BREAK_EXEC))
+  {
+    breakStop(BREAK_EXEC, pc);
+    return true;
+  }
+  return false;
 }
 
-void __not_in_flash_func(execZX80)(void)
+/* True, with the details in hit (if not NULL), if execution has stopped */
+bool z80_breakStopped(BreakHit_T* hit)
 {
-  unsigned long ts;     // deliberately hides static ts, so vsync at correct raster
+  if (break_stop && hit)
+    *hit = break_hit;
+  return break_stop;
+}
 
-  do
+void z80_breakResume(void)
+{
+  if (break_stop)
   {
-    // Get the next op, calculate the next byte to display and execute the op
-    op = fetchm(pc);
+    break_stop = false;
+    break_resume = true;
+  }
+}
+#endif
 
-    intsample = 1;
-    m1cycles = 1;
+static inline void __not_in_flash_func(emitStart)(EmitStream_T* st, uint8_t* ptr, bool chroma)
+{
+  st->ptr = ptr;
+  st->word = 0;
+  st->first = (uintptr_t)ptr & 3;
+  st->limit = framePrepare(ptr, chroma);
+}
+
+/* Stores the bytes of the word before st->ptr from lane first to last */
+static inline void __not_in_flash_func(emitWord)(EmitStream_T* st, int last)
+{
+  uint8_t* base = st->ptr - ((uintptr_t)st->ptr & 3 ? (uintptr_t)st->ptr & 3 : 4);
+
+  // The run has reached the next line
+  if (base + last >= st->limit)
+  {
+#ifdef SUPPORT_CHROMA
+    st->limit = framePrepare(base + last, st == &emit_chr);
+#else
+    st->limit = framePrepare(base + last, false);
+#endif
+  }
 
-    if (((pc & 0x8000) && (!m1not || (pc & 0x4000)) && !(op & 0x40)))
+  if ((st->first == 0) && (last == 3))
+  {
+    *(uint32_t*)base = st->word;
+  }
+  else
+  {
+    for (int n = st->first; n <= last; ++n)
     {
-      if ((RasterX >= startX) &&
-          (RasterX < endX) &&
-          (RasterY >= startY) &&
-          (RasterY < endY))
-      {
-        unsigned char v;
-        int addr;
+      base[n] = st->word >> (n << 3);
+    }
+  }
+  st->word = 0;
+  st->first = 0;
+}
 
-        if ((i < 0x20) || ((i < 0x40) && LowRAM && (!useWRX)))
-        {
-          if (!(chr128 && (i > 0x20) && (i & 1)))
-            addr = ((i & 0xfe) << 8) | ((op & 0x3f) << 3) | rowcounter;
-          else
-            addr = ((i & 0xfe) << 8) | ((((op & 0x80) >> 1) | (op & 0x3f)) << 3) | rowcounter;
+static inline void __not_in_flash_func(emitPut)(EmitStream_T* st, uint8_t byte)
+{
+  int lane = (uintptr_t)st->ptr & 3;
 
-          if (UDGEnabled && (addr >= 0x1E00) && (addr < 0x2000))
-          {
-            v = mem[addr + ((op & 0x80) ? 0x6800 : 0x6600)];
-          }
-          else
-          {
-            v = mem[addr];
-          }
-        }
-        else if (useWRX)
-        {
-          v = mem[(i << 8) | (r & 0x80) | (radjust & 0x7f)];
-        }
-        else
-        {
-          v = 0xff;
-        }
-        v = (op & 0x80) ? ~v : v;
+  st->word |= (uint32_t)byte << (lane << 3);
+  st->ptr++;
+  if (lane == 3)
+  {
+    emitWord(st, 3);
+  }
+}
+
+/* Completes the current run, if any */
+static void __not_in_flash_func(emitFlush)(void)
+{
+  if (emit_next == -1)
+    return;
 
 #ifdef SUPPORT_CHROMA
-        if (chromamode)
-        {
-          int k = (dest + RasterX) >> 3;
-          scrnbmpc_new[k] = (chromamode & 0x10) ? fetch(pc) : fetch(0xc000 | ((((op & 0x80) >> 1) | (op & 0x3f)) << 3) | rowcounter);
-          scrnbmp_new[k] = v;
-        }
-        else
+  if (emit_chroma)
+  {
+    if ((uintptr_t)emit_chr.ptr & 3)
+      emitWord(&emit_chr, ((uintptr_t)emit_chr.ptr & 3) - 1);
+    emit_chroma = false;
+  }
+  else
 #endif
-        {
-          int k = dest + RasterX;
-          int kh = k >> 3;
-          int kl = k & 7;
+  if (emit_shift)
+  {
+    emitPut(&emit_pix, emit_carry);
+  }
+  if ((uintptr_t)emit_pix.ptr & 3)
+    emitWord(&emit_pix, ((uintptr_t)emit_pix.ptr & 3) - 1);
+  emit_next = -1;
+}
 
-          if (kl)
-          {
-            scrnbmp_new[kh++] |= (v >> kl);
-            scrnbmp_new[kh] = (v << (8 - kl));
-          }
-          else
-          {
-            scrnbmp_new[kh] = v;
-          }
-        }
-      }
+/* Stores the display byte v at bit position k of the frame. The first byte
+ * of a run is ORed with the existing pixels, and the last is followed by
+ * the low bits of the final display byte */
+static __force_inline void emitPixels(const unsigned int cfg, int k, unsigned char v)
+{
+  int kl = k & 7;
 
-      /* The CPU sees a nop - so skip the Z80 emulation loop */
-      pc++;
-      radjust++;
+#ifdef SUPPORT_CHROMA
+  if ((k != emit_next) || CFG_TEST(cfg, CFG_CHROMA, emit_chroma))
+#else
+  if (k != emit_next)
+#endif
+  {
+    uint8_t* first = scrnbmp_new + (k >> 3);
 
-      ts = 4;
-      tstates += ts;
+    emitFlush();
+    emitStart(&emit_pix, first, false);
+    emit_shift = kl;
+    emit_carry = kl ? *first : 0;
+  }
+  emitPut(&emit_pix, emit_carry | (v >> kl));
+  emit_carry = kl ? (v << (8 - kl)) : 0;
+  emit_next = k + 8;
+}
 
-      // Update the flip flop
-      prevVideoFlipFlop3Q = videoFlipFlop3Q;
+/* Generate the display byte for the pseudo nop at pc */
+static __force_inline void displayByte(const unsigned int cfg)
+{
+  unsigned char v;
+  int addr;
 
-      if (videoFlipFlop3Clear)
-      {
-        videoFlipFlop3Q = videoFlipFlop2Q;
-      }
-      videoFlipFlop2Q = !videoFlipFlop1Q;
+  if ((i < 0x20) || ((i < 0x40) && CFG_TEST(cfg, CFG_LOWRAM, LowRAM) && !CFG_TEST(cfg, CFG_WRX, useWRX)))
+  {
+    if (!(CFG_TEST(cfg, CFG_CHR128, chr128) && (i > 0x20) && (i & 1)))
+      addr = ((i & 0xfe) << 8) | ((op & 0x3f) << 3) | rowcounter;
+    else
+      addr = ((i & 0xfe) << 8) | ((((op & 0x80) >> 1) | (op & 0x3f)) << 3) | rowcounter;
+
+    if (CFG_TEST(cfg, CFG_UDG, UDGEnabled) && (addr >= 0x1E00) && (addr < 0x2000))
+    {
+      v = mem[addr + ((op & 0x80) ? 0x6800 : 0x6600)];
     }
     else
     {
-      ts = z80_op();
-
-      // Update the flip flop
-      prevVideoFlipFlop3Q = videoFlipFlop3Q;
+      v = mem[addr];
+    }
+  }
+  else if (CFG_TEST(cfg, CFG_WRX, useWRX))
+  {
+    v = mem[(i << 8) | (r & 0x80) | (radjust & 0x7f)];
+  }
+  else
+  {
+    v = 0xff;
+  }
+  v = (op & 0x80) ? ~v : v;
 
-      for (int i = 0; i < m1cycles; ++i)
-      {
-        if (videoFlipFlop3Clear)
-        {
-          videoFlipFlop3Q = videoFlipFlop2Q;
-        }
+#ifdef SUPPORT_CHROMA
+  if (CFG_TEST(cfg, CFG_CHROMA, chromamode))
+  {
+    int k = (dest + RasterX) >> 3;
+    unsigned char colour = (chromamode & 0x10) ? fetchraw(pc) : fetchraw(0xc000 | ((((op & 0x80) >> 1) | (op & 0x3f)) << 3) | rowcounter);
 
-        videoFlipFlop2Q = !videoFlipFlop1Q;
-      }
+    // Pixel and colour bytes are aligned, one per character
+    if ((k != emit_next) || !emit_chroma)
+    {
+      emitFlush();
+      emitStart(&emit_pix, scrnbmp_new + k, false);
+      emitStart(&emit_chr, scrnbmpc_new + k, true);
+      emit_chroma = true;
+      emit_shift = 0;
     }
+    emitPut(&emit_pix, v);
+    emitPut(&emit_chr, colour);
+    emit_next = k + 1;
+  }
+  else
+#endif
+  {
+    emitPixels(cfg, dest + RasterX, v);
+  }
+}
 
-    if (!videoFlipFlop3Q)
+/* Standard ZX81 text display. While a line of D_FILE is run by the ROM
+ * display routine, with I at the ROM character set, the pseudo nops up to
+ * the NEWLINE are run in one step, taking the display bytes straight from
+ * the current row of the character set. This is only done with no feature
+ * in the display path (so not for WRX, chroma, UDG or CHR128), and for as
+ * many characters as come before the next interrupt, sync event or end of
+ * the exec loop. Other displays, and the rest of the line, are left to
+ * the raster emulation */
+static inline bool __not_in_flash_func(dfileRun)(void)
+{
+  unsigned short dfile = fetchraw(0x400c) | (fetchraw(0x400d) << 8);
+  unsigned short addr = pc & 0x7fff;
+  int next = (hsync_pending == 1) ? HSYNC_START : ((hsync_pending == 2) ? HSYNC_END : HLEN);
+  int limit = (next - 1 - hsync_counter) >> 2;
+  int count = 0;
+
+  if ((i != 0x1e) || (addr <= dfile) || (addr > dfile + 24 * 33) ||
+      VSYNC_state || HSYNC_state || !psync || (tstates >= tsexit))
+    return false;
+
+  // The character after the last must not be interrupted
+  if (iff1)
+  {
+    int rpass = (radjust & 0x40) ? (0x41 - (radjust & 0x3f)) : 1;
+
+    if (rpass < limit)
+      limit = rpass;
+  }
+  if ((int)((tsexit - tstates - 1) >> 2) + 1 < limit)
+    limit = ((tsexit - tstates - 1) >> 2) + 1;
+
+  while ((count < limit) && memdisplay[(unsigned short)(pc + count) >> 10] &&
+         !(fetchm((unsigned short)(pc + count)) & 0x40))
+  {
+    count++;
+  }
+  if (count < 2)
+    return false;
+
+  const unsigned char* glyphs = mem + 0x1e00 + rowcounter;
+  bool shown = (RasterY >= startY) && (RasterY < endY);
+
+  for (int n = 0; n < count; n++)
+  {
+    int x = RasterX + (n << 3);
+
+    op = fetchm(pc);
+    if (shown && (x >= startX) && (x < endX))
     {
-      videoFlipFlop1Q = 0;
+      unsigned char v = glyphs[(op & 0x3f) << 3];
 
-      if (prevVideoFlipFlop3Q)
-      {
-        rowcounter = (rowcounter + 1) & 7;
-      }
+      emitPixels(CFG_NONE, dest + x, (op & 0x80) ? ~v : v);
     }
+    pc++;
+  }
 
-    // execute an interrupt
-    if (iff1 && intsample && !((radjust - 1) & 0x40))
-    {
-      unsigned long tstore = z80_interrupt();
-      tstates += tstore;
-      ts += tstore;
+  radjust += count;
+  spin_break += count;
+  ts = 4;
+  tstates += count << 2;
+  hsync_counter += count << 2;
+  RasterX += count << 3;
+  intsample = 1;
+#ifdef Z80_PROFILE
+  prof_display_ts += count << 2;
+  prof_sync_skipped += count;
+  prof_dfile_chars += count;
+#endif
 
-      // single m1Cycle
-      if (videoFlipFlop3Clear)
-      {
-        videoFlipFlop3Q = videoFlipFlop2Q;
-      }
+  return true;
+}
 
-      videoFlipFlop2Q = !videoFlipFlop1Q;
-      videoFlipFlop1Q = 1;
-    }
+/* Multiplier of 1, 2 or 4 for the emulated CPU clock. The ULA clock,
+ * and so HLEN, tsmax and the NMI timing, are unchanged */
+void setTurbo(int multiplier)
+{
+  turbo_shift = (multiplier >= 4) ? 2 : (multiplier >= 2) ? 1 : 0;
+  turbo_frac = 0;
+}
 
-    RasterX += (ts << 1);
-    scanline_len += (ts << 1);
-    if (RasterX >= scanlinePixelLength)
+/* The CPU may only run faster than the ULA when its timing cannot affect
+ * the picture. So not with interrupts enabled (display lines), in the
+ * ROM INT and NMI handlers, in the ROM display and keyboard code (which
+ * starts at SLOW/FAST, as it times a delay loop against the NMI), in
+ * code entered from the NMI that starts the display (including hi-res
+ * drivers) or while the ROM is loading or saving. FAST mode computes
+ * with VSYNC held, so VSYNC only stops turbo until it is longer than any
+ * frame sync pulse */
+static inline bool __not_in_flash_func(turboAllowed)(void)
+{
+  return !iff1 && !(VSYNC_state && (sync_len < TURBO_VSYNC)) &&
+         !turbo_hold && !running_rom &&
+         !((pc >= 0x0038) && (pc < 0x0080)) &&
+         !((pc >= 0x0207) && (pc < 0x02e7));
+}
+
+/* Determine changes to sync state over the ts of the last instruction, in
+ * one step if no sync event is due */
+static __force_inline void __not_in_flash_func(syncInstruction)(void)
+{
+  if (syncAdvance(ts))
+  {
+    return;
+  }
+
+  int states_remaining = ts;
+  int since_hstart = 0;
+  int tswait = 0;
+  int tstate_inc;
+
+  do
+  {
+    tstate_inc = states_remaining > MAX_JMP ? MAX_JMP: states_remaining;
+    states_remaining -= tstate_inc;
+#ifdef Z80_PROFILE
+    prof_sync_steps++;
+#endif
+
+    hsync_counter += tstate_inc;
+    RasterX += (tstate_inc << 1);
+
+    if (hsync_counter >= HLEN)
     {
-      RasterX -= scanlinePixelLength;
-      RasterY++;
+        hsync_counter -= HLEN;
+        hsync_pending = 1;
     }
 
-    switch (LastInstruction)
+    // Start of HSYNC, and NMI if enabled
+    if ((hsync_pending == 1) && (hsync_counter >= HSYNC_START))
     {
-      case LASTINSTOUTFD:
-      case LASTINSTOUTFE:
-      case LASTINSTOUTFF:     // VSync end
-        videoFlipFlop1Q = 0;
-        videoFlipFlop2Q = 1;
-        videoFlipFlop3Clear = 1;
-        if (!videoFlipFlop3Q)
-        {
-          sync_len += ts;
-
-          if (sync_len > ZX80HSyncAcceptanceDuration)
-          {
-            videoFlipFlop3Q = 1;
-          }
-        }
-        LastInstruction = LASTINSTNONE;
-      break;
-
-      case LASTINSTINFE:      // VSync start
-        if (videoFlipFlop3Q)
+      if (NMI_generator)
+      {
+        nmi_pending = 1;
+        if (ts == 4)
         {
-          sync_len = PortActiveDuration;
+          tswait = 14 + (3 - states_remaining - (hsync_counter - HSYNC_START));
         }
         else
         {
-          sync_len += ts;
+          tswait = 14;
         }
+        states_remaining += tswait;
+        ts += tswait;
+        tstates += tswait;
+      }
 
-        videoFlipFlop1Q = 1;
-        videoFlipFlop3Clear = 0;
-        videoFlipFlop3Q = 0;
-        rowcounter = 0;
-        LastInstruction = LASTINSTNONE;
-      break;
+      HSYNC_state = 1;
+      since_hstart = hsync_counter - HSYNC_START + 1;
+#ifdef PC_PROFILE
+      pcProfileSample();
+#endif
 
-      default:
-        if (!videoFlipFlop3Q)
-        {
-          sync_len += ts;
-        }
-      break;
+      if (VSYNC_state || rowcounter_hold)
+      {
+        rowcounter = 0;
+        rowcounter_hold = false;
+      }
+      else
+      {
+        rowcounter++;
+        rowcounter &= 7;
+      }
+      hsync_pending = 2;
     }
 
-    if (prevVideoFlipFlop3Q != videoFlipFlop3Q)
+    // end of HSYNC
+    if ((hsync_pending == 2) && (hsync_counter >= HSYNC_END))
     {
-      videoFlipFlop3Q ? vsync_lower() : vsync_raise();
-      // ZX80 HSYNC sound - excluded if Chroma
-      if (sound_type == SOUND_TYPE_VSYNC) sound_beeper(videoFlipFlop3Q);
+      HSYNC_state = 0;
+      hsync_pending = 0;
     }
 
-    if (videoFlipFlop3Q && (sync_len > 0))
+    // NOR the vertical and horizontal SYNC states to create the SYNC signal
+    SYNC_signal = (VSYNC_state || HSYNC_state) ? 0 : 1;
+    checksync(since_hstart ? since_hstart : MAX_JMP);
+    since_hstart = 0;
+  }
+  while (states_remaining);
+}
+
+static __force_inline void execZX81Loop(const unsigned int cfg)
+{
+  do
+  {
+    if(nmi_pending)
     {
-      // The line is now complete
-      if (sync_len <= ZX80HSyncAcceptanceDuration)
-      {
-        sync_type = SYNCTYPEH;
+      ts = nmi_interrupt();
+      tstates += ts;
+      nmi_pending = 0;
+    }
+    else if (iff1 && intsample && !((radjust - 1) & 0x40))
+    {
+      ts = z80_interrupt();
+      hsync_counter = -2;             /* INT ACK after two tstates */
+      hsync_pending = 1;              /* a HSYNC may be started */
+      tstates += ts;
+    }
+    else
+    {
+      // Get the next op, calculate the next byte to display and execute the op
+      op = fetchm(pc);
+#ifdef Z80_BREAK
+      if (CFG_TEST(cfg, CFG_BREAK, break_armed) && breakExec())
+      {
+        break;
+      }
+#endif
+#ifdef Z80_TRACE
+      traceRecord();
+#endif
+
+      // After this instruction can have interrupt
+      intsample = 1;
+
+      if ((op == 0x76) && haltSkip())
+      {
+        continue;
+      }
+
+      if ((memdisplay[pc >> 10] && !(op & 0x40)))
+      {
+#ifndef Z80_TRACE
+        // A line of the standard text display
+        if ((cfg == CFG_NONE) && dfileRun())
+        {
+          continue;
+        }
+#endif
+        if ((RasterX >= startX) &&
+            (RasterX < endX) &&
+            (RasterY >= startY) &&
+            (RasterY < endY))
+        {
+          displayByte(cfg);
+        }
+        /* The CPU sees a nop - so skip the Z80 emulation loop */
+        pc++;
+        radjust++;
+        spin_break++;
+
+        ts = 4;
+        tstates += ts;
+#ifdef Z80_PROFILE
+        prof_display_ts += ts;
+#endif
+      }
+      else
+      {
+        bool turbo = turbo_shift && turboAllowed();
+
+        ts = z80_op();
+#ifdef Z80_PROFILE
+        prof_instr_ts += ts;
+#endif
+
+        // In turbo the instruction takes a fraction of its tstates in
+        // ULA time, so more instructions run between ULA events
+        if (turbo)
+        {
+          unsigned long cpu_ts = ts;
+
+          turbo_frac += cpu_ts;
+          ts = turbo_frac >> turbo_shift;
+          turbo_frac -= ts << turbo_shift;
+          tstates -= cpu_ts - ts;
+        }
+
+        switch(LastInstruction)
+        {
+          case LASTINSTOUTFD:
+            NMI_generator = 0;
+            // OUT FD at 0x7a in the ROM NMI handler precedes the display
+            turbo_hold = (pc == 0x007c);
+            anyout();
+          break;
+
+          case LASTINSTOUTFE:
+            NMI_generator = 1;
+            turbo_hold = false;
+            anyout();
+          break;
+
+          case LASTINSTINFE:
+            if (!NMI_generator)
+            {
+              if (VSYNC_state == 0)
+              {
+                VSYNC_state = 1;
+                vsync_raise();
+              }
+            }
+            LastInstruction = LASTINSTNONE;
+          break;
+
+          case LASTINSTOUTFF:
+            anyout();
+          break;
+        }
+      }
+    }
+
+    syncInstruction();
+  }
+  while (tstates < tsexit);
+
+  emitFlush();
+}
+
+static void __not_in_flash_func(execZX81Plain)(void)
+{
+  execZX81Loop(CFG_NONE);
+}
+
+static void __not_in_flash_func(execZX81Any)(void)
+{
+  execZX81Loop(CFG_ANY);
+}
+
+void __not_in_flash_func(execZX81)(void)
+{
+  do
+  {
+#ifdef Z80_BREAK
+    // Stopped, the frame continues after z80_breakResume
+    if (break_stop)
+      return;
+#endif
+    if (execConfig() == CFG_NONE)
+    {
+      execZX81Plain();
+    }
+    else
+    {
+      execZX81Any();
+    }
+  }
+  while (tstates < tsmax);
+
+  tstates -= tsmax;
+#ifdef Z80_PROFILE
+  profileFrame();
+#endif
+}
+
+static __force_inline void execZX80Loop(const unsigned int cfg)
+{
+  unsigned long ts80;   // deliberately separate from ula ts, so vsync at correct raster
+
+  do
+  {
+    // Get the next op, calculate the next byte to display and execute the op
+    op = fetchm(pc);
+#ifdef Z80_BREAK
+    if (CFG_TEST(cfg, CFG_BREAK, break_armed) && breakExec())
+    {
+      break;
+    }
+#endif
+#ifdef Z80_TRACE
+    traceRecord();
+#endif
+
+    intsample = 1;
+    m1cycles = 1;
+
+    if ((memdisplay[pc >> 10] && !(op & 0x40)))
+    {
+      if ((RasterX >= startX) &&
+          (RasterX < endX) &&
+          (RasterY >= startY) &&
+          (RasterY < endY))
+      {
+        displayByte(cfg);
+      }
+
+      /* The CPU sees a nop - so skip the Z80 emulation loop */
+      pc++;
+      radjust++;
+
+      ts80 = 4;
+      tstates += ts80;
+#ifdef Z80_PROFILE
+      prof_display_ts += ts80;
+#endif
+
+      // Update the flip flop
+      prevVideoFlipFlop3Q = videoFlipFlop3Q;
+
+      if (videoFlipFlop3Clear)
+      {
+        videoFlipFlop3Q = videoFlipFlop2Q;
+      }
+      videoFlipFlop2Q = !videoFlipFlop1Q;
+    }
+    else
+    {
+      ts80 = z80_op();
+#ifdef Z80_PROFILE
+      prof_instr_ts += ts80;
+#endif
+
+      // Update the flip flop
+      prevVideoFlipFlop3Q = videoFlipFlop3Q;
+
+      for (int n = 0; n < m1cycles; ++n)
+      {
+        if (videoFlipFlop3Clear)
+        {
+          videoFlipFlop3Q = videoFlipFlop2Q;
+        }
+
+        videoFlipFlop2Q = !videoFlipFlop1Q;
+      }
+    }
+
+    if (!videoFlipFlop3Q)
+    {
+      videoFlipFlop1Q = 0;
+
+      if (prevVideoFlipFlop3Q)
+      {
+        rowcounter = (rowcounter + 1) & 7;
+      }
+    }
+
+    // execute an interrupt
+    if (iff1 && intsample && !((radjust - 1) & 0x40))
+    {
+      unsigned long tstore = z80_interrupt();
+      tstates += tstore;
+      ts80 += tstore;
+
+      // single m1Cycle
+      if (videoFlipFlop3Clear)
+      {
+        videoFlipFlop3Q = videoFlipFlop2Q;
+      }
+
+      videoFlipFlop2Q = !videoFlipFlop1Q;
+      videoFlipFlop1Q = 1;
+    }
+
+    RasterX += (ts80 << 1);
+    scanline_len += (ts80 << 1);
+    if (RasterX >= scanlinePixelLength)
+    {
+      RasterX -= scanlinePixelLength;
+      RasterY++;
+#ifdef PC_PROFILE
+      pcProfileSample();
+#endif
+    }
+
+    switch (LastInstruction)
+    {
+      case LASTINSTOUTFD:
+      case LASTINSTOUTFE:
+      case LASTINSTOUTFF:     // VSync end
+        videoFlipFlop1Q = 0;
+        videoFlipFlop2Q = 1;
+        videoFlipFlop3Clear = 1;
+        if (!videoFlipFlop3Q)
+        {
+          sync_len += ts80;
+
+          if (sync_len > ZX80HSyncAcceptanceDuration)
+          {
+            videoFlipFlop3Q = 1;
+          }
+        }
+        LastInstruction = LASTINSTNONE;
+      break;
+
+      case LASTINSTINFE:      // VSync start
+        if (videoFlipFlop3Q)
+        {
+          sync_len = PortActiveDuration;
+        }
+        else
+        {
+          sync_len += ts80;
+        }
+
+        videoFlipFlop1Q = 1;
+        videoFlipFlop3Clear = 0;
+        videoFlipFlop3Q = 0;
+        rowcounter = 0;
+        LastInstruction = LASTINSTNONE;
+      break;
+
+      default:
+        if (!videoFlipFlop3Q)
+        {
+          sync_len += ts80;
+        }
+      break;
+    }
+
+    if (prevVideoFlipFlop3Q != videoFlipFlop3Q)
+    {
+      videoFlipFlop3Q ? vsync_lower() : vsync_raise();
+      // ZX80 HSYNC sound - excluded if Chroma
+      if (sound_type == SOUND_TYPE_VSYNC) sound_beeper(videoFlipFlop3Q);
+    }
+
+    if (videoFlipFlop3Q && (sync_len > 0))
+    {
+      // The line is now complete
+      if (sync_len <= ZX80HSyncAcceptanceDuration)
+      {
+        sync_type = SYNCTYPEH;
         if (scanline_len >= ZX80HSyncAcceptancePixelPosition)
         {
-          lineClockCarryCounter = ts;
+          lineClockCarryCounter = ts80;
           scanline_len = scanlinePixelLength;
         }
       }
@@ -946,170 +1966,837 @@ void __not_in_flash_func(execZX80)(void)
         int overhangPixels = scanline_len - scanlinePixelLength;
         sync_type = SYNCTYPEV;
 
-        if (overhangPixels < 0)
-        {
-          if (scanline_len >= ZX80HSyncAcceptancePixelPosition)
-          {
-            lineClockCarryCounter = 0;
-          }
-          else
-          {
-            lineClockCarryCounter = scanline_len > 1;
-          }
-          scanline_len = scanlinePixelLength;
-        }
-        else if (overhangPixels > 0)
-        {
-          lineClockCarryCounter = overhangPixels > 1;
-          scanline_len = scanlinePixelLength;
-        }
-      }
-    }
+        if (overhangPixels < 0)
+        {
+          if (scanline_len >= ZX80HSyncAcceptancePixelPosition)
+          {
+            lineClockCarryCounter = 0;
+          }
+          else
+          {
+            lineClockCarryCounter = scanline_len > 1;
+          }
+          scanline_len = scanlinePixelLength;
+        }
+        else if (overhangPixels > 0)
+        {
+          lineClockCarryCounter = overhangPixels > 1;
+          scanline_len = scanlinePixelLength;
+        }
+      }
+    }
+
+    // If we are at the end of a line then process it
+    if (!((scanline_len < scanlineThresholdPixelLength) && (sync_type == SYNCNONE)))
+    {
+      if (sync_type == SYNCTYPEV)
+      {
+        // Frames synchonised after second vsync in range
+        if (vsyncFound)
+        {
+          frameNotSync = !((RasterY >= VSYNC_TOLERANCEMIN) && (RasterY < VSYNC_TOLERANCEMAX) &&
+                          (scanlineCounter >= VSYNC_TOLERANCEMIN) && (scanlineCounter < VSYNC_TOLERANCEMAX));
+          vsyncFound = !frameNotSync;
+        }
+        else
+        {
+          vsyncFound = (scanlineCounter >= VSYNC_TOLERANCEMIN) && (scanlineCounter < VSYNC_TOLERANCEMAX);
+        }
+        scanlineCounter = 0;
+
+        if (!vsyncFound)
+        {
+          sync_type = SYNCNONE;
+          sync_len = 0;
+        }
+        nosync_lines = 0;
+      }
+      else
+      {
+        if (sync_type == SYNCTYPEH)
+        {
+          scanlineCounter++;
+        }
+
+        if (((sync_type == SYNCNONE) && videoFlipFlop3Q) || (scanlineCounter >= VSYNC_TOLERANCEMAX))
+        {
+          frameNotSync = true;
+          vsyncFound = false;
+        }
+
+        if (sync_type == SYNCNONE)
+        {
+          int overhangPixels = scanline_len - scanlinePixelLength;
+          if (overhangPixels > 0)
+          {
+            lineClockCarryCounter = (overhangPixels >> 1);
+            scanline_len = scanlinePixelLength;
+          }
+          nosync_lines++;
+        }
+        else
+        {
+          nosync_lines = 0;
+        }
+      }
+
+      // Synchronise the TV position
+      S_RasterX += scanline_len;
+      if (S_RasterX >= scanlinePixelLength)
+      {
+        S_RasterX -= scanlinePixelLength;
+        S_RasterY++;
+
+        if (S_RasterY >= VSYNC_TOLERANCEMAX)
+        {
+          S_RasterX = 0;
+          sync_type = SYNCTYPEV;
+          if (sync_len < HSYNC_MINLEN)
+          {
+            sync_len = HSYNC_MINLEN;
+          }
+        }
+      }
+
+      if (sync_len < HSYNC_MINLEN) sync_type = 0;
+
+      if (sync_type)
+      {
+        if (S_RasterX > HSYNC_TOLERANCEMAX)
+        {
+          S_RasterX = 0;
+          S_RasterY++;
+        }
+
+        if (((sync_len > VSYNC_MINLEN) && (S_RasterY > VSYNC_TOLERANCEMIN)) ||
+             (S_RasterY >= VSYNC_TOLERANCEMAX))
+        {
+          if (nosync_lines >= FRAME_SCAN)
+          {
+            // Whole frame with no sync, so blank the display
+            displayBlank(true);
+            nosync_lines -= FRAME_SCAN;
+          }
+          else
+          {
+            displayAndNewScreen(frameSync);
+          }
+          S_RasterX = 0;
+          S_RasterY = 0;
+        }
+      }
+
+      if (sync_type != SYNCNONE)
+      {
+        sync_type = SYNCNONE;
+        sync_len = 0;
+      }
+
+      // Handle line carry over here
+      if (lineClockCarryCounter > 0)
+      {
+        scanline_len = lineClockCarryCounter << 1;
+        lineClockCarryCounter = 0;
+      }
+      else
+      {
+        scanline_len = 0;
+      }
+
+      // Update data for new ZX80 scanline
+      RasterX = S_RasterX + scanline_len;
+      RasterY = S_RasterY;
+      dest = disp.offset + (disp.stride_bit * (adjustStartY + RasterY)) + adjustStartX;
+    }
+  }
+  while (tstates < tsexit);
+
+  emitFlush();
+}
+
+static void __not_in_flash_func(execZX80Plain)(void)
+{
+  execZX80Loop(CFG_NONE);
+}
+
+static void __not_in_flash_func(execZX80Any)(void)
+{
+  execZX80Loop(CFG_ANY);
+}
+
+void __not_in_flash_func(execZX80)(void)
+{
+  do
+  {
+#ifdef Z80_BREAK
+    // Stopped, the frame continues after z80_breakResume
+    if (break_stop)
+      return;
+#endif
+    if (execConfig() == CFG_NONE)
+    {
+      execZX80Plain();
+    }
+    else
+    {
+      execZX80Any();
+    }
+  }
+  while (tstates < tsmax);
+
+  tstates -= tsmax;
+#ifdef Z80_PROFILE
+  profileFrame();
+#endif
+}
+
+static unsigned char __not_in_flash_func(lazyflags)(void)
+{
+  unsigned short y = lazyy;
+
+  switch (lazyf)
+  {
+    case LAZY_LOGIC:
+      f = szptable[y] | lazyz;
+    break;
+
+    case LAZY_ADD:
+      f = sztable[y & 0xff] | (y >> 8) | ((lazya ^ lazyz ^ y) & 0x10) |
+          (((~lazya ^ lazyz) & 0x80 & (y ^ lazya)) >> 5);
+    break;
+
+    case LAZY_SUB:
+      f = sztable[y & 0xff] | (y >> 8) | ((lazya ^ lazyz ^ y) & 0x10) |
+          (((lazya ^ lazyz) & 0x80 & (y ^ lazya)) >> 5) | 2;
+    break;
+
+    case LAZY_INC:
+      f = lazyc | incflags[y];
+    break;
+
+    case LAZY_DEC:
+      f = lazyc | decflags[y];
+    break;
+  }
+  lazyf = LAZY_NONE;
+  return f;
+}
+
+static inline unsigned char getf(void)
+{
+  return lazyf ? lazyflags() : f;
+}
+
+/* Returns the tstates value up to which an instruction, which started at
+ * tstore, can run on inside z80_op (repeating block instructions, skipped
+ * idle loops). The exec loop must see every HSYNC and sync edge between
+ * instructions, so this is only allowed on the ZX81 in the part of the
+ * line before the counter wraps */
+static inline unsigned long __not_in_flash_func(eventLimit)(unsigned long tstore)
+{
+  if (zx80 || hsync_pending || HSYNC_state || VSYNC_state)
+    return 0;
+
+  return tstore + (HLEN - 1 - hsync_counter);
+}
+
+/* Idle loop detection. At each backward jump the CPU state is compared
+ * with the state at the previous backward jump. Once all registers other
+ * than R match, the RAM pages are watched, so that writes to them are
+ * counted in spin_break. If a further pass then has no memory write, I/O
+ * or displayed byte (spin_break is unchanged) and the same state, every
+ * later pass round the loop is identical. So whole passes are skipped, up
+ * to the next event, by advancing tstates and R only. A loop seen to write
+ * is not watched again until another loop is entered */
+static MACHINE_STATE uint64_t spin_watched = 0;
+
+/* Count writes to the RAM pages, or stop counting them */
+static void spinWatch(bool watch)
+{
+  for (int n = 0; n < 64; n++)
+  {
+    if (watch && (memwrite[n] == MEMWRITE_RAM))
+    {
+      memwrite[n] = MEMWRITE_WATCH;
+      spin_watched |= 1ULL << n;
+    }
+    else if (!watch && (spin_watched & (1ULL << n)) && (memwrite[n] == MEMWRITE_WATCH))
+    {
+      memwrite[n] = MEMWRITE_RAM;
+    }
+  }
+  if (!watch)
+    spin_watched = 0;
+}
+
+static void __not_in_flash_func(spinCheck)(unsigned long tstore)
+{
+  static MACHINE_STATE Z80State_T spin_state;
+  static MACHINE_STATE unsigned long spin_tstates;
+  static MACHINE_STATE unsigned int spin_last;
+  static MACHINE_STATE unsigned short spin_pc;
+  static MACHINE_STATE unsigned char spin_r;
+  static MACHINE_STATE bool spin_armed = false;
+  static MACHINE_STATE bool spin_written = false;
+  bool idle = false;
+
+  if (spin_pc != pc)
+  {
+    spin_written = false;
+  }
+  else if (spin_last != spin_break)
+  {
+    spin_written = spin_written || spin_armed;
+  }
+  else if (!iff1 && !zx80)
+  {
+    unsigned char rnow = radjust;
+    unsigned char rinc = rnow - spin_r;
+
+    // Compare everything except R
+    radjust = spin_r;
+    idle = !memcmp(&spin_state, &zx.cpu, sizeof(spin_state));
+    radjust = rnow;
+
+    // Writes to RAM are only seen in passes made after the watch started.
+    // tstates is reduced by tsmax at the end of each frame
+    if (idle && spin_armed && (tstates > spin_tstates))
+    {
+      unsigned long limit = eventLimit(tstore);
+      unsigned long period = tstates - spin_tstates;
+
+      if (limit >= tsmax)
+        limit = tsmax - 1;
+
+      if (limit > tstates)
+      {
+        unsigned long passes = (limit - tstates) / period;
+
+        tstates += passes * period;
+        radjust += passes * rinc;
+      }
+    }
+  }
+  if ((idle != spin_armed) && !(idle && spin_written))
+  {
+    spinWatch(idle);
+    spin_armed = idle;
+  }
+  spin_state = zx.cpu;
+  spin_tstates = tstates;
+  spin_last = spin_break;
+  spin_pc = pc;
+  spin_r = radjust;
+}
+
+/* DJNZ $ delay loop, called with b already decremented and non zero. Skips
+ * all but the final pass, up to the next event, 13 tstates and one R
+ * increment per pass */
+static void __not_in_flash_func(djnzSkip)(unsigned long tstore)
+{
+  unsigned long limit = eventLimit(tstore);
+
+  if (iff1 || (b < 2))
+    return;
+
+  if (limit >= tsmax)
+    limit = tsmax - 1;
+
+  // Allow for the 5 tstates of this jump
+  if (limit > tstates + 5)
+  {
+    unsigned long passes = (limit - tstates - 5) / 13;
+
+    if (passes > (unsigned long)(b - 1))
+      passes = b - 1;
+
+    b -= passes;
+    tstates += passes * 13;
+    radjust += passes;
+  }
+}
+
+/* HALT waiting for an interrupt. Each pass is 4 tstates and one R
+ * increment, with nothing else changing. When the sync signal is steady
+ * and no HSYNC is due, the passes up to the earlier of the end of the
+ * line, the end of the frame and the pass before INT is accepted are
+ * applied in one step. The final pass is left to the exec loop, so that
+ * any NMI, INT or sync edge is handled exactly as before */
+static inline bool __not_in_flash_func(haltSkip)(void)
+{
+  int passes;
+
+  if (hsync_pending || HSYNC_state || VSYNC_state || !psync || nmi_pending)
+    return false;
+
+  // Passes before the hsync counter wraps
+  passes = (HLEN - 1 - hsync_counter) >> 2;
+
+  if ((tstates + (passes << 2)) >= tsmax)
+    passes = (tsmax - 1 - tstates) >> 2;
+
+  if (iff1)
+  {
+    // INT is accepted when bit 6 of R - 1 clears
+    int rpass = (radjust & 0x40) ? (0x41 - (radjust & 0x3f)) : 1;
+
+    if (rpass < passes)
+      passes = rpass;
+  }
+
+  if (passes < 2)
+    return false;
+
+  tstates += passes << 2;
+  radjust += passes;
+  hsync_counter += passes << 2;
+  RasterX += passes << 3;
+
+  return true;
+}
+
+/* Advances the ULA by the tstates of an instruction when no sync event
+ * falls within them, i.e. no HSYNC start or end, no wrap of the hsync
+ * counter, no sync edge and, while the sync is low, no TV line or frame
+ * tolerance reached. Otherwise returns false, with nothing changed, and
+ * the exec loop steps through the tstates MAX_JMP at a time */
+static inline bool __not_in_flash_func(syncAdvance)(int inc)
+{
+  int sync = (VSYNC_state || HSYNC_state) ? 0 : 1;
+  int next = (hsync_pending == 1) ? HSYNC_START : ((hsync_pending == 2) ? HSYNC_END : HLEN);
+  int steps = inc ? ((inc + MAX_JMP - 1) / MAX_JMP) : 1;
+
+  if ((sync != psync) || (hsync_counter + inc >= next))
+    return false;
+
+  if (!sync)
+  {
+    if ((RasterX + (inc << 1) >= HSYNC_TOLERANCEMAX) || (RasterY >= VSYNC_TOLERANCEMAX))
+      return false;
+
+    // As stepped, where each step counts as MAX_JMP
+    sync_len += steps * MAX_JMP;
+  }
+  hsync_counter += inc;
+  RasterX += inc << 1;
+  SYNC_signal = sync;
+#ifdef Z80_PROFILE
+  prof_sync_skipped += steps;
+#endif
+
+  return true;
+}
+
+#if defined(Z80_PROFILE) || defined(PC_PROFILE) || defined(Z80_TRACE)
+static void profileWrite(const char* line)
+{
+#ifdef Z80_HOST
+  fputs(line, stdout);
+#else
+  emu_FileWriteBytes(line, strlen(line));
+#endif
+}
+#endif
+
+#ifdef Z80_PROFILE
+/* Page and opcode of the instruction at addr, as an index into the
+ * profile tables */
+static inline int __not_in_flash_func(profileIndex)(unsigned short addr)
+{
+  unsigned char op0 = fetchm(addr);
+  unsigned char op1 = fetchm((unsigned short)(addr + 1));
+
+  switch (op0)
+  {
+    case 0xcb:
+      return (PROF_CB << 8) | op1;
+
+    case 0xed:
+      return (PROF_ED << 8) | op1;
+
+    case 0xdd:
+      if (op1 == 0xcb) return (PROF_DDCB << 8) | fetchm((unsigned short)(addr + 3));
+      return (PROF_DD << 8) | op1;
+
+    case 0xfd:
+      if (op1 == 0xcb) return (PROF_FDCB << 8) | fetchm((unsigned short)(addr + 3));
+      return (PROF_FD << 8) | op1;
+
+    default:
+      return op0;
+  }
+}
+
+/* Write the profile as CSV, then start a new one */
+void z80_profileDump(void)
+{
+  char line[160];
+
+#ifndef Z80_HOST
+  EMU_LOCK_SDCARD
+  if (!emu_FileOpen(PROFILE_FILE, "w"))
+  {
+    EMU_UNLOCK_SDCARD
+    return;
+  }
+#endif
+  snprintf(line, sizeof(line), "frames,%lu,display_tstates,%llu,instruction_tstates,%llu,"
+           "sync_steps_per_frame,%llu,sync_steps_skipped_per_frame,%llu,dfile_chars_per_frame,%llu\n",
+           (unsigned long)prof_frames, (unsigned long long)prof_display_ts, (unsigned long long)prof_instr_ts,
+           (unsigned long long)(prof_frames ? prof_sync_steps / prof_frames : 0),
+           (unsigned long long)(prof_frames ? prof_sync_skipped / prof_frames : 0),
+           (unsigned long long)(prof_frames ? prof_dfile_chars / prof_frames : 0));
+  profileWrite(line);
+  profileWrite("page,opcode,count,tstates\n");
+
+  for (int n = 0; n < (PROF_PAGES << 8); n++)
+  {
+    if (prof_count[n])
+    {
+      snprintf(line, sizeof(line), "%s,%02x,%lu,%lu\n", prof_page_name[n >> 8], n & 0xff,
+               (unsigned long)prof_count[n], (unsigned long)prof_tstates[n]);
+      profileWrite(line);
+    }
+  }
+#ifndef Z80_HOST
+  emu_FileClose();
+  EMU_UNLOCK_SDCARD
+#endif
+
+  memset(prof_count, 0, sizeof(prof_count));
+  memset(prof_tstates, 0, sizeof(prof_tstates));
+  prof_display_ts = prof_instr_ts = 0;
+  prof_sync_steps = prof_sync_skipped = prof_dfile_chars = 0;
+  prof_frames = 0;
+}
+
+static void profileFrame(void)
+{
+  if (++prof_frames >= PROFILE_FRAMES)
+  {
+    z80_profileDump();
+  }
+}
+#endif
+
+#ifdef PC_PROFILE
+static inline int __not_in_flash_func(pcProfileIndex)(unsigned short addr)
+{
+  return (addr < 0x2000) ? (addr >> PCPROF_ROM_SHIFT) :
+                           PCPROF_ROM_BUCKETS + ((addr - 0x2000) >> PCPROF_RAM_SHIFT);
+}
+
+static inline unsigned short pcProfileAddr(int n)
+{
+  return (n < PCPROF_ROM_BUCKETS) ? (n << PCPROF_ROM_SHIFT) :
+                                    0x2000 + ((n - PCPROF_ROM_BUCKETS) << PCPROF_RAM_SHIFT);
+}
+
+static void __not_in_flash_func(pcProfileHalve)(void)
+{
+  for (int n = 0; n < PCPROF_BUCKETS; n++)
+  {
+    pcprof_hist[n] >>= 1;
+  }
+  pcprof_samples >>= 1;
+}
+
+static inline void __not_in_flash_func(pcProfileSample)(void)
+{
+  if (++pcprof_hist[pcProfileIndex(pc)] == 0xffff)
+  {
+    pcProfileHalve();
+  }
+  pcprof_samples++;
+}
+
+/* The symbols of the ROM in use. The ZX81X2 ROM is not labelled */
+static const RomSymbol_T* pcProfileSymbols(int* count)
+{
+  if (rom4k)
+  {
+    *count = sizeof(zx80_symbols) / sizeof(zx80_symbols[0]);
+    return zx80_symbols;
+  }
+  else if (emu_ComputerRequested() == ZX81X2)
+  {
+    *count = 0;
+    return NULL;
+  }
+  *count = sizeof(zx81_symbols) / sizeof(zx81_symbols[0]);
+  return zx81_symbols;
+}
+
+/* Insert into the table of the max largest entries, kept in order */
+static void pcProfileInsert(PcProfileEntry_T* top, int max, int* used,
+                            const char* name, unsigned short addr, uint32_t samples)
+{
+  int n;
+
+  if (!samples || ((*used == max) && (top[max - 1].samples >= samples)))
+    return;
+
+  n = (*used < max) ? (*used)++ : max - 1;
+  while ((n > 0) && (top[n - 1].samples < samples))
+  {
+    top[n] = top[n - 1];
+    n--;
+  }
+  top[n].name = name;
+  top[n].addr = addr;
+  top[n].samples = samples;
+}
+
+/* Fills top with up to max of the largest entries of the profile, each
+ * a ROM routine or a RAM (or unlabelled ROM) bucket.
+ * Returns the number of entries and the total number of samples */
+int z80_pcProfileTop(PcProfileEntry_T* top, int max, uint32_t* total)
+{
+  int count;
+  const RomSymbol_T* syms = pcProfileSymbols(&count);
+  int used = 0;
+  int sym = -1;
+  uint32_t sum = 0;
+
+  // Buckets are in address order, so sum each routine in turn
+  for (int n = 0; n < PCPROF_BUCKETS; n++)
+  {
+    unsigned short addr = pcProfileAddr(n);
 
-    // If we are at the end of a line then process it
-    if (!((scanline_len < scanlineThresholdPixelLength) && (sync_type == SYNCNONE)))
+    if ((n < PCPROF_ROM_BUCKETS) && count)
     {
-      if (sync_type == SYNCTYPEV)
+      if ((sym + 1 < count) && (syms[sym + 1].addr <= addr))
       {
-        // Frames synchonised after second vsync in range
-        if (vsyncFound)
-        {
-          frameNotSync = !((RasterY >= VSYNC_TOLERANCEMIN) && (RasterY < VSYNC_TOLERANCEMAX) &&
-                          (scanlineCounter >= VSYNC_TOLERANCEMIN) && (scanlineCounter < VSYNC_TOLERANCEMAX));
-          vsyncFound = !frameNotSync;
-        }
-        else
-        {
-          vsyncFound = (scanlineCounter >= VSYNC_TOLERANCEMIN) && (scanlineCounter < VSYNC_TOLERANCEMAX);
-        }
-        scanlineCounter = 0;
+        if (sym >= 0)
+          pcProfileInsert(top, max, &used, syms[sym].name, syms[sym].addr, sum);
 
-        if (!vsyncFound)
-        {
-          sync_type = SYNCNONE;
-          sync_len = 0;
-        }
-        nosync_lines = 0;
+        while ((sym + 1 < count) && (syms[sym + 1].addr <= addr))
+          sym++;
+        sum = 0;
       }
-      else
-      {
-        if (sync_type == SYNCTYPEH)
-        {
-          scanlineCounter++;
-        }
+      sum += pcprof_hist[n];
+    }
+    else
+    {
+      pcProfileInsert(top, max, &used, NULL, addr, pcprof_hist[n]);
+    }
+  }
+  if (sym >= 0)
+    pcProfileInsert(top, max, &used, syms[sym].name, syms[sym].addr, sum);
 
-        if (((sync_type == SYNCNONE) && videoFlipFlop3Q) || (scanlineCounter >= VSYNC_TOLERANCEMAX))
-        {
-          frameNotSync = true;
-          vsyncFound = false;
-        }
+  *total = pcprof_samples;
+  return used;
+}
 
-        if (sync_type == SYNCNONE)
-        {
-          int overhangPixels = scanline_len - scanlinePixelLength;
-          if (overhangPixels > 0)
-          {
-            lineClockCarryCounter = (overhangPixels >> 1);
-            scanline_len = scanlinePixelLength;
-          }
-          nosync_lines++;
-        }
-        else
-        {
-          nosync_lines = 0;
-        }
-      }
+/* Write every non empty bucket, with its routine, as CSV */
+bool z80_pcProfileDump(void)
+{
+  char line[80];
+  int count;
+  const RomSymbol_T* syms = pcProfileSymbols(&count);
+  int sym = -1;
+
+#ifndef Z80_HOST
+  EMU_LOCK_SDCARD
+  if (!emu_FileOpen(PCPROF_FILE, "w"))
+  {
+    EMU_UNLOCK_SDCARD
+    return false;
+  }
+#endif
+  snprintf(line, sizeof(line), "samples,%lu\n", (unsigned long)pcprof_samples);
+  profileWrite(line);
+  profileWrite("start,end,routine,samples\n");
 
-      // Synchronise the TV position
-      S_RasterX += scanline_len;
-      if (S_RasterX >= scanlinePixelLength)
-      {
-        S_RasterX -= scanlinePixelLength;
-        S_RasterY++;
+  for (int n = 0; n < PCPROF_BUCKETS; n++)
+  {
+    unsigned short addr = pcProfileAddr(n);
+    const char* name = (addr < 0x2000) ? "ROM" : "RAM";
 
-        if (S_RasterY >= VSYNC_TOLERANCEMAX)
-        {
-          S_RasterX = 0;
-          sync_type = SYNCTYPEV;
-          if (sync_len < HSYNC_MINLEN)
-          {
-            sync_len = HSYNC_MINLEN;
-          }
-        }
-      }
+    if (addr < 0x2000)
+    {
+      while ((sym + 1 < count) && (syms[sym + 1].addr <= addr))
+        sym++;
+      if (sym >= 0)
+        name = syms[sym].name;
+    }
+    if (pcprof_hist[n])
+    {
+      snprintf(line, sizeof(line), "%04x,%04x,%s,%u\n", addr,
+               (unsigned short)(pcProfileAddr(n + 1) - 1), name, pcprof_hist[n]);
+      profileWrite(line);
+    }
+  }
+#ifndef Z80_HOST
+  emu_FileClose();
+  EMU_UNLOCK_SDCARD
+#endif
+  return true;
+}
 
-      if (sync_len < HSYNC_MINLEN) sync_type = 0;
+void z80_pcProfileReset(void)
+{
+  memset(pcprof_hist, 0, sizeof(pcprof_hist));
+  pcprof_samples = 0;
+}
+#endif
 
-      if (sync_type)
-      {
-        if (S_RasterX > HSYNC_TOLERANCEMAX)
-        {
-          S_RasterX = 0;
-          S_RasterY++;
-        }
+#ifdef Z80_TRACE
+static inline void __not_in_flash_func(traceRecord)(void)
+{
+  TraceRecord_T* t;
+
+  if (trace_frozen)
+    return;
+
+  t = &trace_ring[trace_next++ & TRACE_MASK];
+  t->addr = pc;
+  t->opcode = op;
+  t->acc = a;
+  t->pair[0] = bc;
+  t->pair[1] = de;
+  t->pair[2] = hl;
+  t->pair[3] = sp;
+  t->tstate = tstates;
+  t->raster = (RasterY << 7) | ((RasterX >> 2) & 0x7f);
+
+  if (trace_post)
+  {
+    trace_frozen = !--trace_post;
+  }
+  else if (pc == trace_pc)
+  {
+    z80_traceHit();
+  }
+}
 
-        if (((sync_len > VSYNC_MINLEN) && (S_RasterY > VSYNC_TOLERANCEMIN)) ||
-             (S_RasterY >= VSYNC_TOLERANCEMAX))
-        {
-          if (nosync_lines >= FRAME_SCAN)
-          {
-            // Whole frame with no sync, so blank the display
-            displayBlank(true);
-            nosync_lines -= FRAME_SCAN;
-          }
-          else
-          {
-            displayAndNewScreen(frameSync);
-          }
-          S_RasterX = 0;
-          S_RasterY = 0;
-        }
-      }
+/* The trigger pc or address has been reached */
+void __not_in_flash_func(z80_traceHit)(void)
+{
+  if (!trace_post && !trace_frozen)
+  {
+    trace_post = Z80_TRACE_RECORDS >> 1;
+    trace_pc = trace_addr = -1;
+  }
+}
 
-      if (sync_type != SYNCNONE)
-      {
-        sync_type = SYNCNONE;
-        sync_len = 0;
-      }
+/* Sets the pc to fetch or the address to write that triggers a dump of
+ * the trace, -1 for none */
+void z80_traceTrigger(int match_pc, int match_addr)
+{
+  trace_pc = match_pc;
+  trace_addr = match_addr;
+}
 
-      // Handle line carry over here
-      if (lineClockCarryCounter > 0)
-      {
-        scanline_len = lineClockCarryCounter << 1;
-        lineClockCarryCounter = 0;
-      }
-      else
-      {
-        scanline_len = 0;
-      }
+/* True once a triggered trace is complete, and ready to write */
+bool z80_traceFrozen(void)
+{
+  return trace_frozen;
+}
 
-      // Update data for new ZX80 scanline
-      RasterX = S_RasterX + scanline_len;
-      RasterY = S_RasterY;
-      dest = disp.offset + (disp.stride_bit * (adjustStartY + RasterY)) + adjustStartX;
-    }
+/* Write the ring, oldest record first, as CSV. Recording then restarts */
+bool z80_traceDump(void)
+{
+  char line[80];
+  uint32_t count = (trace_next < Z80_TRACE_RECORDS) ? trace_next : Z80_TRACE_RECORDS;
+
+#ifndef Z80_HOST
+  EMU_LOCK_SDCARD
+  if (!emu_FileOpen(TRACE_FILE, "w"))
+  {
+    EMU_UNLOCK_SDCARD
+    return false;
   }
-  while (tstates < tsmax);
+#endif
+  profileWrite("pc,op,a,bc,de,hl,sp,tstates,rasterx,rastery\n");
 
-  tstates -= tsmax;
+  for (uint32_t n = trace_next - count; n != trace_next; n++)
+  {
+    const TraceRecord_T* t = &trace_ring[n & TRACE_MASK];
+
+    snprintf(line, sizeof(line), "%04x,%02x,%02x,%04x,%04x,%04x,%04x,%u,%u,%u\n",
+             t->addr, t->opcode, t->acc, t->pair[0], t->pair[1], t->pair[2], t->pair[3],
+             t->tstate, (t->raster & 0x7f) << 2, t->raster >> 7);
+    profileWrite(line);
+  }
+#ifndef Z80_HOST
+  emu_FileClose();
+  EMU_UNLOCK_SDCARD
+#endif
+
+  trace_next = 0;
+  trace_post = 0;
+  trace_frozen = false;
+  return true;
 }
+#endif
 
 static unsigned long z80_op(void)
 {
   unsigned long tstore = tstates;
+#ifdef Z80_HOST
+  z80_instructions++;
+#endif
+#ifdef Z80_PROFILE
+  int prof_index = profileIndex(pc);
+#endif
+#ifdef Z80_THREADED
+#include "z80jump.h"
+#endif
 
   do
   {
     pc++;
     radjust++;
 
-    switch (op)
+#ifdef Z80_THREADED
+    // Dispatch through label table, break still exits the instruction
+    do
     {
+      goto *xy_ops[ixoriy][op];
 #include "z80ops.h"
+#undef Z80_XMODE
+#define Z80_XMODE 1
+#include "xyops.h"
+#undef Z80_XMODE
+#define Z80_XMODE 2
+#include "xyops.h"
+    } while (0);
+#else
+    if (!ixoriy)
+    {
+unprefixed:
+      switch (op)
+      {
+#include "z80ops.h"
+      }
+    }
+    else if (ixoriy == 1)
+    {
+      switch (op)
+      {
+#undef Z80_XMODE
+#define Z80_XMODE 1
+#include "xyops.h"
+        default:
+          goto unprefixed;
+      }
+    }
+    else
+    {
+      switch (op)
+      {
+#undef Z80_XMODE
+#define Z80_XMODE 2
+#include "xyops.h"
+        default:
+          goto unprefixed;
+      }
     }
+#endif
     ixoriy = 0;
 
-    // Complete ix and iy instructions
+    // Complete ix and iy instructions, using the DD or FD handler set
     if (new_ixoriy)
     {
       ixoriy = new_ixoriy;
@@ -1118,9 +2805,100 @@ static unsigned long z80_op(void)
     }
   } while (ixoriy);
 
+#ifdef Z80_PROFILE
+  prof_count[prof_index]++;
+  prof_tstates[prof_index] += tstates - tstore;
+#endif
   return tstates - tstore;
 }
 
+#if defined(CALC_HLE) || defined(ROM_HLE)
+#include "hleops.h"
+#endif
+
+#ifdef Z80_HOST
+/* Host build only. Resets the CPU into a flat 64K of RAM, with no ROM
+ * traps or display */
+void z80_flatMemory(void)
+{
+  autoload = 0;   // No program to load from file
+  resetZ80();
+#ifdef LOAD_AND_SAVE
+  rom_traps = false;
+#endif
+
+  for (int n = 0; n < 64; n++)
+  {
+    memptr[n] = memfetch[n] = mem + 1024 * n;
+    memwrite[n] = MEMWRITE_RAM;
+    memdisplay[n] = 0;
+  }
+}
+
+/* Host build only. Runs the instruction at 0x100, after z80_flatMemory(),
+ * with A set to x, B, I and the byte at HL (0x200) set to y, and the carry
+ * flag and IFF2 set to carry. Returns A in the high byte and the flags in
+ * the low byte */
+unsigned short z80_runFlags(unsigned char x, unsigned char y, unsigned char carry)
+{
+  a = x;
+  b = i = mem[0x200] = y;
+  h = 0x02;
+  l = 0x00;
+  f = carry;
+  iff2 = carry;
+  lazyf = LAZY_NONE;
+  pc = 0x100;
+  op = fetchm(pc);
+  z80_op();
+
+  return (a << 8) | getf();
+}
+
+/* Host build only. Runs a CP/M program, such as the zexdoc and zexall
+ * instruction exercisers, loaded at 0x100 in a flat 64K of RAM, until it
+ * jumps to 0. Only the BDOS console output calls (2 and 9) are provided.
+ * Returns the number of tstates executed */
+unsigned long long z80_runCPM(void)
+{
+  unsigned long long total = 0;
+
+  z80_flatMemory();
+
+  mem[0] = 0x76;  // HALT, never reached
+  mem[5] = 0xc9;  // BDOS entry, RET after the call is handled
+  mem[6] = 0x00;  // Top of the TPA, used to set the stack
+  mem[7] = 0xf0;
+  pc = 0x100;
+
+  while (pc)
+  {
+    if (pc == 5)
+    {
+      if (c == 2)
+      {
+        putchar(e);
+      }
+      else if (c == 9)
+      {
+        for (unsigned short p = de; mem[p] != '$'; p++)
+          putchar(mem[p]);
+      }
+      fflush(stdout);
+    }
+    op = fetchm(pc);
+    z80_op();
+
+    if (tstates >= tsmax)
+    {
+      total += tsmax;
+      tstates -= tsmax;
+    }
+  }
+  return total + tstates;
+}
+#endif
+
 static inline int __not_in_flash_func(z80_interrupt)(void)
 {
   // NOTE: For optimisation, need to ensure iff1 set before calling this
@@ -1255,86 +3033,14 @@ static void __not_in_flash_func(anyout)(void)
 
 bool save_snap_z80(void)
 {
-  if (!emu_FileWriteBytes(&a, sizeof(a))) return false;
-  if (!emu_FileWriteBytes(&f, sizeof(f))) return false;
-  if (!emu_FileWriteBytes(&b, sizeof(b))) return false;
-  if (!emu_FileWriteBytes(&c, sizeof(c))) return false;
-  if (!emu_FileWriteBytes(&d, sizeof(d))) return false;
-  if (!emu_FileWriteBytes(&e, sizeof(e))) return false;
-  if (!emu_FileWriteBytes(&h, sizeof(h))) return false;
-  if (!emu_FileWriteBytes(&l, sizeof(l))) return false;
-
-  if (!emu_FileWriteBytes(&a1, sizeof(a1))) return false;
-  if (!emu_FileWriteBytes(&f1, sizeof(f1))) return false;
-  if (!emu_FileWriteBytes(&b1, sizeof(b1))) return false;
-  if (!emu_FileWriteBytes(&c1, sizeof(c1))) return false;
-  if (!emu_FileWriteBytes(&d1, sizeof(d1))) return false;
-  if (!emu_FileWriteBytes(&e1, sizeof(e1))) return false;
-  if (!emu_FileWriteBytes(&h1, sizeof(h1))) return false;
-  if (!emu_FileWriteBytes(&l1, sizeof(l1))) return false;
-  if (!emu_FileWriteBytes(&i, sizeof(i))) return false;
-  if (!emu_FileWriteBytes(&iff1, sizeof(iff1))) return false;
-  if (!emu_FileWriteBytes(&iff2, sizeof(iff2))) return false;
-  if (!emu_FileWriteBytes(&im, sizeof(im))) return false;
-  if (!emu_FileWriteBytes(&r, sizeof(r))) return false;
-
-  if (!emu_FileWriteBytes(&ixoriy, sizeof(ixoriy))) return false;
-  if (!emu_FileWriteBytes(&new_ixoriy, sizeof(new_ixoriy))) return false;
-
-  if (!emu_FileWriteBytes(&ix, sizeof(ix))) return false;
-  if (!emu_FileWriteBytes(&iy, sizeof(iy))) return false;
-  if (!emu_FileWriteBytes(&sp, sizeof(sp))) return false;
-  if (!emu_FileWriteBytes(&pc, sizeof(pc))) return false;
-
-  if (!emu_FileWriteBytes(&radjust, sizeof(radjust))) return false;
-  if (!emu_FileWriteBytes(&intsample, sizeof(intsample))) return false;
-  if (!emu_FileWriteBytes(&op, sizeof(op))) return false;
-  if (!emu_FileWriteBytes(&m1cycles, sizeof(m1cycles))) return false;
+  if (!emu_FileWriteBytes(&zx, sizeof(zx))) return false;
 
   if (!emu_FileWriteBytes(&tstates, sizeof(tstates))) return false;
-  if (!emu_FileWriteBytes(&ts, sizeof(ts))) return false;
-  if (!emu_FileWriteBytes(&vsx, sizeof(vsx))) return false;
-  if (!emu_FileWriteBytes(&vsy, sizeof(vsy))) return false;
-
-  if (!emu_FileWriteBytes(&FRAME_SCAN, sizeof(FRAME_SCAN))) return false;
-  if (!emu_FileWriteBytes(&VSYNC_TOLERANCEMIN, sizeof(VSYNC_TOLERANCEMIN))) return false;
-  if (!emu_FileWriteBytes(&VSYNC_TOLERANCEMAX, sizeof(VSYNC_TOLERANCEMAX))) return false;
-
-  if (!emu_FileWriteBytes(&RasterX, sizeof(RasterX))) return false;
-  if (!emu_FileWriteBytes(&RasterY, sizeof(RasterY))) return false;
-  if (!emu_FileWriteBytes(&psync, sizeof(psync))) return false;
-  if (!emu_FileWriteBytes(&sync_len, sizeof(sync_len))) return false;
-
   if (!emu_FileWriteBytes(&running_rom, sizeof(running_rom))) return false;
   if (!emu_FileWriteBytes(&frameNotSync, sizeof(frameNotSync))) return false;
   if (!emu_FileWriteBytes(&ay_reg, sizeof(ay_reg))) return false;
   if (!emu_FileWriteBytes(&LastInstruction, sizeof(LastInstruction))) return false;
 
-  if (!emu_FileWriteBytes(&NMI_generator, sizeof(NMI_generator))) return false;
-  if (!emu_FileWriteBytes(&nmi_pending, sizeof(nmi_pending))) return false;
-  if (!emu_FileWriteBytes(&hsync_pending, sizeof(hsync_pending))) return false;
-  if (!emu_FileWriteBytes(&VSYNC_state, sizeof(VSYNC_state))) return false;
-  if (!emu_FileWriteBytes(&HSYNC_state, sizeof(HSYNC_state))) return false;
-
-  if (!emu_FileWriteBytes(&S_RasterX, sizeof(S_RasterX))) return false;
-  if (!emu_FileWriteBytes(&S_RasterY, sizeof(S_RasterY))) return false;
-
-  if (!emu_FileWriteBytes(&videoFlipFlop1Q, sizeof(videoFlipFlop1Q))) return false;
-  if (!emu_FileWriteBytes(&videoFlipFlop2Q, sizeof(videoFlipFlop2Q))) return false;
-  if (!emu_FileWriteBytes(&videoFlipFlop3Q, sizeof(videoFlipFlop3Q))) return false;
-  if (!emu_FileWriteBytes(&videoFlipFlop3Clear, sizeof(videoFlipFlop3Clear))) return false;
-  if (!emu_FileWriteBytes(&prevVideoFlipFlop3Q, sizeof(prevVideoFlipFlop3Q))) return false;
-
-  if (!emu_FileWriteBytes(&vsyncFound, sizeof(vsyncFound))) return false;
-  if (!emu_FileWriteBytes(&lineClockCarryCounter, sizeof(lineClockCarryCounter))) return false;
-
-  if (!emu_FileWriteBytes(&scanline_len, sizeof(scanline_len))) return false;
-  if (!emu_FileWriteBytes(&sync_type, sizeof(sync_type))) return false;
-  if (!emu_FileWriteBytes(&sync_len, sizeof(sync_len))) return false;
-  if (!emu_FileWriteBytes(&nosync_lines, sizeof(nosync_lines))) return false;
-
-  // Process interlace emu_VideoSetInterlace();
-
   if (!emu_FileWriteBytes(&chromamode, sizeof(chromamode))) return false;
 #ifdef SUPPORT_CHROMA
   if (!emu_FileWriteBytes(&bordercolour, sizeof(bordercolour))) return false;
@@ -1344,22 +3050,6 @@ bool save_snap_z80(void)
   if (!emu_FileWriteBytes(&dummy, sizeof(dummy))) return false;
 #endif
 
-  if (!emu_FileWriteBytes(&dest, sizeof(dest))) return false;
-  if (!emu_FileWriteBytes(&adjustStartX, sizeof(adjustStartX))) return false;
-  if (!emu_FileWriteBytes(&adjustStartY, sizeof(adjustStartY))) return false;
-  if (!emu_FileWriteBytes(&startX, sizeof(startX))) return false;
-  if (!emu_FileWriteBytes(&startY, sizeof(startY))) return false;
-  if (!emu_FileWriteBytes(&syncX, sizeof(syncX))) return false;
-  if (!emu_FileWriteBytes(&endX, sizeof(endX))) return false;
-  if (!emu_FileWriteBytes(&endY, sizeof(endY))) return false;
-
-  if (!emu_FileWriteBytes(&psync, sizeof(psync))) return false;
-  if (!emu_FileWriteBytes(&sync_len, sizeof(sync_len))) return false;
-  if (!emu_FileWriteBytes(&rowcounter, sizeof(rowcounter))) return false;
-  if (!emu_FileWriteBytes(&sync_len, sizeof(sync_len))) return false;
-  if (!emu_FileWriteBytes(&hsync_counter, sizeof(hsync_counter))) return false;
-  if (!emu_FileWriteBytes(&rowcounter_hold, sizeof(rowcounter_hold))) return false;
-
   if (!emu_FileWriteBytes(&sound_type, sizeof(sound_type))) return false;
   if (!emu_FileWriteBytes(&m1not, sizeof(m1not))) return false;
   if (!emu_FileWriteBytes(&useWRX, sizeof(useWRX))) return false;
@@ -1369,9 +3059,6 @@ bool save_snap_z80(void)
   if (!emu_FileWriteBytes(&chr128, sizeof(chr128))) return false;
   if (!emu_FileWriteBytes(&useNTSC, sizeof(useNTSC))) return false;
   if (!emu_FileWriteBytes(&frameSync, sizeof(frameSync))) return false;
-  if (!emu_FileWriteBytes(&running_rom, sizeof(running_rom))) return false;
-
-  if (!emu_FileWriteBytes(&scanlineCounter, sizeof(scanlineCounter))) return false;
 
   return true;
 }
@@ -1380,84 +3067,15 @@ bool load_snap_z80(uint32_t version)
 {
   (void)version;
 
-  if (!emu_FileReadBytes(&a, sizeof(a))) return false;
-  if (!emu_FileReadBytes(&f, sizeof(f))) return false;
-  if (!emu_FileReadBytes(&b, sizeof(b))) return false;
-  if (!emu_FileReadBytes(&c, sizeof(c))) return false;
-  if (!emu_FileReadBytes(&d, sizeof(d))) return false;
-  if (!emu_FileReadBytes(&e, sizeof(e))) return false;
-  if (!emu_FileReadBytes(&h, sizeof(h))) return false;
-  if (!emu_FileReadBytes(&l, sizeof(l))) return false;
-
-  if (!emu_FileReadBytes(&a1, sizeof(a1))) return false;
-  if (!emu_FileReadBytes(&f1, sizeof(f1))) return false;
-  if (!emu_FileReadBytes(&b1, sizeof(b1))) return false;
-  if (!emu_FileReadBytes(&c1, sizeof(c1))) return false;
-  if (!emu_FileReadBytes(&d1, sizeof(d1))) return false;
-  if (!emu_FileReadBytes(&e1, sizeof(e1))) return false;
-  if (!emu_FileReadBytes(&h1, sizeof(h1))) return false;
-  if (!emu_FileReadBytes(&l1, sizeof(l1))) return false;
-  if (!emu_FileReadBytes(&i, sizeof(i))) return false;
-  if (!emu_FileReadBytes(&iff1, sizeof(iff1))) return false;
-  if (!emu_FileReadBytes(&iff2, sizeof(iff2))) return false;
-  if (!emu_FileReadBytes(&im, sizeof(im))) return false;
-  if (!emu_FileReadBytes(&r, sizeof(r))) return false;
-
-  if (!emu_FileReadBytes(&ixoriy, sizeof(ixoriy))) return false;
-  if (!emu_FileReadBytes(&new_ixoriy, sizeof(new_ixoriy))) return false;
-
-  if (!emu_FileReadBytes(&ix, sizeof(ix))) return false;
-  if (!emu_FileReadBytes(&iy, sizeof(iy))) return false;
-  if (!emu_FileReadBytes(&sp, sizeof(sp))) return false;
-  if (!emu_FileReadBytes(&pc, sizeof(pc))) return false;
-
-  if (!emu_FileReadBytes(&radjust, sizeof(radjust))) return false;
-  if (!emu_FileReadBytes(&intsample, sizeof(intsample))) return false;
-  if (!emu_FileReadBytes(&op, sizeof(op))) return false;
-  if (!emu_FileReadBytes(&m1cycles, sizeof(m1cycles))) return false;
+  if (!emu_FileReadBytes(&zx, sizeof(zx))) return false;
+  spin_break++;
 
   if (!emu_FileReadBytes(&tstates, sizeof(tstates))) return false;
-  if (!emu_FileReadBytes(&ts, sizeof(ts))) return false;
-  if (!emu_FileReadBytes(&vsx, sizeof(vsx))) return false;
-  if (!emu_FileReadBytes(&vsy, sizeof(vsy))) return false;
-
-  if (!emu_FileReadBytes(&FRAME_SCAN, sizeof(FRAME_SCAN))) return false;
-  if (!emu_FileReadBytes(&VSYNC_TOLERANCEMIN, sizeof(VSYNC_TOLERANCEMIN))) return false;
-  if (!emu_FileReadBytes(&VSYNC_TOLERANCEMAX, sizeof(VSYNC_TOLERANCEMAX))) return false;
-
-  if (!emu_FileReadBytes(&RasterX, sizeof(RasterX))) return false;
-  if (!emu_FileReadBytes(&RasterY, sizeof(RasterY))) return false;
-  if (!emu_FileReadBytes(&psync, sizeof(psync))) return false;
-  if (!emu_FileReadBytes(&sync_len, sizeof(sync_len))) return false;
-
   if (!emu_FileReadBytes(&running_rom, sizeof(running_rom))) return false;
   if (!emu_FileReadBytes(&frameNotSync, sizeof(frameNotSync))) return false;
   if (!emu_FileReadBytes(&ay_reg, sizeof(ay_reg))) return false;
   if (!emu_FileReadBytes(&LastInstruction, sizeof(LastInstruction))) return false;
 
-  if (!emu_FileReadBytes(&NMI_generator, sizeof(NMI_generator))) return false;
-  if (!emu_FileReadBytes(&nmi_pending, sizeof(nmi_pending))) return false;
-  if (!emu_FileReadBytes(&hsync_pending, sizeof(hsync_pending))) return false;
-  if (!emu_FileReadBytes(&VSYNC_state, sizeof(VSYNC_state))) return false;
-  if (!emu_FileReadBytes(&HSYNC_state, sizeof(HSYNC_state))) return false;
-
-  if (!emu_FileReadBytes(&S_RasterX, sizeof(S_RasterX))) return false;
-  if (!emu_FileReadBytes(&S_RasterY, sizeof(S_RasterY))) return false;
-
-  if (!emu_FileReadBytes(&videoFlipFlop1Q, sizeof(videoFlipFlop1Q))) return false;
-  if (!emu_FileReadBytes(&videoFlipFlop2Q, sizeof(videoFlipFlop2Q))) return false;
-  if (!emu_FileReadBytes(&videoFlipFlop3Q, sizeof(videoFlipFlop3Q))) return false;
-  if (!emu_FileReadBytes(&videoFlipFlop3Clear, sizeof(videoFlipFlop3Clear))) return false;
-  if (!emu_FileReadBytes(&prevVideoFlipFlop3Q, sizeof(prevVideoFlipFlop3Q))) return false;
-
-  if (!emu_FileReadBytes(&vsyncFound, sizeof(vsyncFound))) return false;
-  if (!emu_FileReadBytes(&lineClockCarryCounter, sizeof(lineClockCarryCounter))) return false;
-
-  if (!emu_FileReadBytes(&scanline_len, sizeof(scanline_len))) return false;
-  if (!emu_FileReadBytes(&sync_type, sizeof(sync_type))) return false;
-  if (!emu_FileReadBytes(&sync_len, sizeof(sync_len))) return false;
-  if (!emu_FileReadBytes(&nosync_lines, sizeof(nosync_lines))) return false;
-
   if (!emu_FileReadBytes(&chromamode, sizeof(chromamode))) return false;
 #ifdef SUPPORT_CHROMA
   if (!emu_FileReadBytes(&bordercolour, sizeof(bordercolour))) return false;
@@ -1467,22 +3085,6 @@ bool load_snap_z80(uint32_t version)
   if (!emu_FileReadBytes(&dummy, sizeof(dummy))) return false;
 #endif
 
-  if (!emu_FileReadBytes(&dest, sizeof(dest))) return false;
-  if (!emu_FileReadBytes(&adjustStartX, sizeof(adjustStartX))) return false;
-  if (!emu_FileReadBytes(&adjustStartY, sizeof(adjustStartY))) return false;
-  if (!emu_FileReadBytes(&startX, sizeof(startX))) return false;
-  if (!emu_FileReadBytes(&startY, sizeof(startY))) return false;
-  if (!emu_FileReadBytes(&syncX, sizeof(syncX))) return false;
-  if (!emu_FileReadBytes(&endX, sizeof(endX))) return false;
-  if (!emu_FileReadBytes(&endY, sizeof(endY))) return false;
-
-  if (!emu_FileReadBytes(&psync, sizeof(psync))) return false;
-  if (!emu_FileReadBytes(&sync_len, sizeof(sync_len))) return false;
-  if (!emu_FileReadBytes(&rowcounter, sizeof(rowcounter))) return false;
-  if (!emu_FileReadBytes(&sync_len, sizeof(sync_len))) return false;
-  if (!emu_FileReadBytes(&hsync_counter, sizeof(hsync_counter))) return false;
-  if (!emu_FileReadBytes(&rowcounter_hold, sizeof(rowcounter_hold))) return false;
-
   if (!emu_FileReadBytes(&sound_type, sizeof(sound_type))) return false;
   if (!emu_FileReadBytes(&m1not, sizeof(m1not))) return false;
   if (!emu_FileReadBytes(&useWRX, sizeof(useWRX))) return false;
@@ -1492,8 +3094,6 @@ bool load_snap_z80(uint32_t version)
   if (!emu_FileReadBytes(&chr128, sizeof(chr128))) return false;
   if (!emu_FileReadBytes(&useNTSC, sizeof(useNTSC))) return false;
   if (!emu_FileReadBytes(&frameSync, sizeof(frameSync))) return false;
-  if (!emu_FileReadBytes(&running_rom, sizeof(running_rom))) return false;
 
-  if (!emu_FileReadBytes(&scanlineCounter, sizeof(scanlineCounter))) return false;
   return true;
 }
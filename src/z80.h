@@ -26,9 +26,10 @@
 #define LASTINSTOUTFD 3
 #define LASTINSTOUTFF 4
 
-extern int ay_reg;
-extern int LastInstruction;
-extern bool frameNotSync;
+extern MACHINE_STATE int ay_reg;
+extern MACHINE_STATE int LastInstruction;
+extern MACHINE_STATE bool frameNotSync;
+extern MACHINE_STATE unsigned int spin_break;
 
 #ifdef __cplusplus
 extern "C" {
@@ -36,57 +37,153 @@ extern "C" {
 extern void resetZ80(void);
 extern void execZX81(void);
 extern void execZX80(void);
+extern void execConfigChanged(void);
+extern void storeSpecial(unsigned short x, unsigned char y);
+extern void store2Special(unsigned short x, unsigned char hi, unsigned char lo);
+extern void setSoundPageHandler(void);
 
 extern void setDisplayBoundaries(void);
 extern void setEmulatedTV(bool fiftyHz, uint16_t vtol);
+extern void setTurbo(int multiplier);
+extern void resetFrameLines(void);
 
 #ifdef SUPPORT_CHROMA
 void adjustChroma(bool start);
 #endif
 
+#ifdef Z80_PROFILE
+extern void z80_profileDump(void);
+#endif
+
+#ifdef PC_PROFILE
+typedef struct
+{
+  const char* name;     // ROM routine, or NULL for a RAM bucket
+  uint16_t addr;        // Start of the routine or bucket
+  uint32_t samples;
+} PcProfileEntry_T;
+
+extern int z80_pcProfileTop(PcProfileEntry_T* top, int max, uint32_t* total);
+extern bool z80_pcProfileDump(void);
+extern void z80_pcProfileReset(void);
+#endif
+
+#ifdef Z80_TRACE
+extern MACHINE_STATE int trace_addr;
+extern void z80_traceHit(void);
+extern void z80_traceTrigger(int match_pc, int match_addr);
+extern bool z80_traceFrozen(void);
+extern bool z80_traceDump(void);
+#endif
+
+#ifdef Z80_BREAK
+#define BREAK_MAX   8
+
+#define BREAK_EXEC  0x01
+#define BREAK_READ  0x02
+#define BREAK_WRITE 0x04
+#define BREAK_IN    0x08
+#define BREAK_OUT   0x10
+
+typedef struct
+{
+  uint8_t kind;             // BREAK_ bit, 0 if the slot is free
+  uint16_t addr;            // Address, or port low byte for IN and OUT
+  unsigned long hits;
+} Breakpoint_T;
+
+typedef struct
+{
+  uint8_t kind;
+  uint16_t addr;            // Address or port that matched
+  uint16_t instr;           // Start of the instruction
+  unsigned long tstates;
+  int line;                 // Raster line
+} BreakHit_T;
+
+extern MACHINE_STATE unsigned char membreak[64];
+extern MACHINE_STATE unsigned char break_io;
+extern void z80_breakSet(int slot, int kind, int addr);
+extern const Breakpoint_T* z80_breakGet(int slot);
+extern void z80_breakAccess(unsigned short addr, unsigned char kind);
+extern void z80_breakPort(int port, unsigned char kind);
+extern bool z80_breakStopped(BreakHit_T* hit);
+extern void z80_breakResume(void);
+#endif
+
+#ifdef CALC_VERIFY
+extern MACHINE_STATE unsigned long calc_verified;
+extern MACHINE_STATE unsigned long calc_mismatched;
+#endif
+
+#ifdef Z80_HOST
+extern MACHINE_STATE unsigned long long z80_instructions;
+extern unsigned long long z80_runCPM(void);
+extern void z80_flatMemory(void);
+extern unsigned short z80_runFlags(unsigned char x, unsigned char y, unsigned char carry);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
 
-#define fetch(x) (memptr[(unsigned short)(x)>>10][(x)&0x3FF])
+/* Read without checking breakpoints, for the ULA */
+#define fetchraw(x) (memptr[(unsigned short)(x)>>10][(x)&0x3FF])
+/* Reads and writes of a page with a breakpoint */
+#ifdef Z80_BREAK
+#define breakRead(x) ((membreak[(unsigned short)(x)>>10] & BREAK_READ) ? z80_breakAccess((x), BREAK_READ) : (void)0)
+#define breakStore(x) if (membreak[(unsigned short)(x)>>10] & BREAK_WRITE) z80_breakAccess((x), BREAK_WRITE);
+#define fetch(x) (breakRead(x), fetchraw(x))
+#else
+#define breakStore(x)
+#define fetch(x) fetchraw(x)
+#endif
 #define fetch2(x) ((fetch((x)+1)<<8)|fetch(x))
-#define fetchm(x) (pc<0xC000 ? fetch(pc) : fetch(pc&0x7fff))
-
-#define AY_STORE_CHECK(x,y) \
-         if(sound_type==SOUND_TYPE_QUICKSILVA) {\
-            if(x==0x7fff)\
-               ay_reg=((y)&0x0F);\
-            else if (x==0x7ffe)\
-               sound_ay_write(ay_reg,(y));\
-         }\
-
-#define QSUDG_STORE_CHECK(x,y) \
-         if(useQSUDG) {\
-            if (x>=0x8400 && x<0x8800){\
-               mem[x] = y;\
-               UDGEnabled = true;\
-            }\
-         }\
+/* Instruction fetch, memfetch has the M1 mirroring of 0xC000 to 0x4000 */
+#define fetchm(x) (memfetch[(unsigned short)(x)>>10][(x)&0x3FF])
+
+/* A write to the trace trigger address */
+#ifdef Z80_TRACE
+#define traceStore(x) if ((unsigned short)(x) == trace_addr) z80_traceHit();
+#define traceStore2(x) traceStore(x) traceStore((x)+1)
+#else
+#define traceStore(x)
+#define traceStore2(x)
+#endif
 
+/* Writes to RAM pages are stored directly. ROM pages ignore writes, and
+ * pages with side effects (QuickSilva sound, QS UDG, RAM watched by the
+ * idle loop detector) count the write in spin_break and go to storeSpecial */
 #define store(x,y) do {\
           unsigned short off=(x)&0x3FF;\
           unsigned char page=(unsigned short)(x)>>10;\
-          int attr=memattr[page];\
-          AY_STORE_CHECK(x,y) \
-          QSUDG_STORE_CHECK(x,y) \
-          if(attr){\
+          unsigned char type=memwrite[page];\
+          traceStore(x)\
+          breakStore(x)\
+          if(type==MEMWRITE_RAM){\
              memptr[page][off]=(y);\
              }\
+          else if(type!=MEMWRITE_ROM){\
+             spin_break++;\
+             storeSpecial(x,y);\
+             }\
            } while(0)
 
 #define store2b(x,hi,lo) do {\
           unsigned short off=(x)&0x3FF;\
           unsigned char page=(unsigned short)(x)>>10;\
-          int attr=memattr[page];\
-          if(attr) { \
+          unsigned char type=memwrite[page];\
+          traceStore2(x)\
+          breakStore(x)\
+          breakStore((x)+1)\
+          if(type==MEMWRITE_RAM) { \
              memptr[page][off]=(lo);\
              memptr[page][off+1]=(hi);\
              }\
+          else if(type!=MEMWRITE_ROM){\
+             spin_break++;\
+             store2Special(x,hi,lo);\
+             }\
           } while(0)
 
 #define store2(x,y) store2b(x,(y)>>8,(y)&0xFF)
@@ -0,0 +1,258 @@
+/* Jump tables for the Z80_THREADED (computed goto) build of z80_op.
+ * Included inside z80_op, as the labels are local to that function.
+ * Undefined ED opcodes, and the bit/res/set groups of the CB page, share
+ * a handler, in the same way as the default and (op&0xc7) switch cases.
+ * The DD and FD tables use the IX and IY handlers from xyops.h, and the
+ * unprefixed handler for every other opcode
+ */
+
+static void* main_ops[256] = {    // Constant, but want to be in RAM
+    &&op_0, &&op_1, &&op_2, &&op_3, &&op_4, &&op_5, &&op_6, &&op_7,
+    &&op_8, &&op_9, &&op_10, &&op_11, &&op_12, &&op_13, &&op_14, &&op_15,
+    &&op_16, &&op_17, &&op_18, &&op_19, &&op_20, &&op_21, &&op_22, &&op_23,
+    &&op_24, &&op_25, &&op_26, &&op_27, &&op_28, &&op_29, &&op_30, &&op_31,
+    &&op_32, &&op_33, &&op_34, &&op_35, &&op_36, &&op_37, &&op_38, &&op_39,
+    &&op_40, &&op_41, &&op_42, &&op_43, &&op_44, &&op_45, &&op_46, &&op_47,
+    &&op_48, &&op_49, &&op_50, &&op_51, &&op_52, &&op_53, &&op_54, &&op_55,
+    &&op_56, &&op_57, &&op_58, &&op_59, &&op_60, &&op_61, &&op_62, &&op_63,
+    &&op_0x40, &&op_0x41, &&op_0x42, &&op_0x43, &&op_0x44, &&op_0x45, &&op_0x46, &&op_0x47,
+    &&op_0x48, &&op_0x49, &&op_0x4a, &&op_0x4b, &&op_0x4c, &&op_0x4d, &&op_0x4e, &&op_0x4f,
+    &&op_0x50, &&op_0x51, &&op_0x52, &&op_0x53, &&op_0x54, &&op_0x55, &&op_0x56, &&op_0x57,
+    &&op_0x58, &&op_0x59, &&op_0x5a, &&op_0x5b, &&op_0x5c, &&op_0x5d, &&op_0x5e, &&op_0x5f,
+    &&op_0x60, &&op_0x61, &&op_0x62, &&op_0x63, &&op_0x64, &&op_0x65, &&op_0x66, &&op_0x67,
+    &&op_0x68, &&op_0x69, &&op_0x6a, &&op_0x6b, &&op_0x6c, &&op_0x6d, &&op_0x6e, &&op_0x6f,
+    &&op_0x70, &&op_0x71, &&op_0x72, &&op_0x73, &&op_0x74, &&op_0x75, &&op_0x76, &&op_0x77,
+    &&op_0x78, &&op_0x79, &&op_0x7a, &&op_0x7b, &&op_0x7c, &&op_0x7d, &&op_0x7e, &&op_0x7f,
+    &&op_0x80, &&op_0x81, &&op_0x82, &&op_0x83, &&op_0x84, &&op_0x85, &&op_0x86, &&op_0x87,
+    &&op_0x88, &&op_0x89, &&op_0x8a, &&op_0x8b, &&op_0x8c, &&op_0x8d, &&op_0x8e, &&op_0x8f,
+    &&op_0x90, &&op_0x91, &&op_0x92, &&op_0x93, &&op_0x94, &&op_0x95, &&op_0x96, &&op_0x97,
+    &&op_0x98, &&op_0x99, &&op_0x9a, &&op_0x9b, &&op_0x9c, &&op_0x9d, &&op_0x9e, &&op_0x9f,
+    &&op_0xa0, &&op_0xa1, &&op_0xa2, &&op_0xa3, &&op_0xa4, &&op_0xa5, &&op_0xa6, &&op_0xa7,
+    &&op_0xa8, &&op_0xa9, &&op_0xaa, &&op_0xab, &&op_0xac, &&op_0xad, &&op_0xae, &&op_0xaf,
+    &&op_0xb0, &&op_0xb1, &&op_0xb2, &&op_0xb3, &&op_0xb4, &&op_0xb5, &&op_0xb6, &&op_0xb7,
+    &&op_0xb8, &&op_0xb9, &&op_0xba, &&op_0xbb, &&op_0xbc, &&op_0xbd, &&op_0xbe, &&op_0xbf,
+    &&op_0xc0, &&op_0xc1, &&op_0xc2, &&op_0xc3, &&op_0xc4, &&op_0xc5, &&op_0xc6, &&op_0xc7,
+    &&op_0xc8, &&op_0xc9, &&op_0xca, &&op_0xcb, &&op_0xcc, &&op_0xcd, &&op_0xce, &&op_0xcf,
+    &&op_0xd0, &&op_0xd1, &&op_0xd2, &&op_0xd3, &&op_0xd4, &&op_0xd5, &&op_0xd6, &&op_0xd7,
+    &&op_0xd8, &&op_0xd9, &&op_0xda, &&op_0xdb, &&op_0xdc, &&op_0xdd, &&op_0xde, &&op_0xdf,
+    &&op_0xe0, &&op_0xe1, &&op_0xe2, &&op_0xe3, &&op_0xe4, &&op_0xe5, &&op_0xe6, &&op_0xe7,
+    &&op_0xe8, &&op_0xe9, &&op_0xea, &&op_0xeb, &&op_0xec, &&op_0xed, &&op_0xee, &&op_0xef,
+    &&op_0xf0, &&op_0xf1, &&op_0xf2, &&op_0xf3, &&op_0xf4, &&op_0xf5, &&op_0xf6, &&op_0xf7,
+    &&op_0xf8, &&op_0xf9, &&op_0xfa, &&op_0xfb, &&op_0xfc, &&op_0xfd, &&op_0xfe, &&op_0xff
+};
+
+static void* cb_ops[256] = {      // Constant, but want to be in RAM
+    &&cb_0, &&cb_1, &&cb_2, &&cb_3, &&cb_4, &&cb_5, &&cb_6, &&cb_7,
+    &&cb_8, &&cb_9, &&cb_10, &&cb_11, &&cb_12, &&cb_13, &&cb_14, &&cb_15,
+    &&cb_0x10, &&cb_0x11, &&cb_0x12, &&cb_0x13, &&cb_0x14, &&cb_0x15, &&cb_0x16, &&cb_0x17,
+    &&cb_0x18, &&cb_0x19, &&cb_0x1a, &&cb_0x1b, &&cb_0x1c, &&cb_0x1d, &&cb_0x1e, &&cb_0x1f,
+    &&cb_0x20, &&cb_0x21, &&cb_0x22, &&cb_0x23, &&cb_0x24, &&cb_0x25, &&cb_0x26, &&cb_0x27,
+    &&cb_0x28, &&cb_0x29, &&cb_0x2a, &&cb_0x2b, &&cb_0x2c, &&cb_0x2d, &&cb_0x2e, &&cb_0x2f,
+    &&cb_0x30, &&cb_0x31, &&cb_0x32, &&cb_0x33, &&cb_0x34, &&cb_0x35, &&cb_0x36, &&cb_0x37,
+    &&cb_0x38, &&cb_0x39, &&cb_0x3a, &&cb_0x3b, &&cb_0x3c, &&cb_0x3d, &&cb_0x3e, &&cb_0x3f,
+    &&cb_0x40, &&cb_0x41, &&cb_0x42, &&cb_0x43, &&cb_0x44, &&cb_0x45, &&cb_0x46, &&cb_0x47,
+    &&cb_0x40, &&cb_0x41, &&cb_0x42, &&cb_0x43, &&cb_0x44, &&cb_0x45, &&cb_0x46, &&cb_0x47,
+    &&cb_0x40, &&cb_0x41, &&cb_0x42, &&cb_0x43, &&cb_0x44, &&cb_0x45, &&cb_0x46, &&cb_0x47,
+    &&cb_0x40, &&cb_0x41, &&cb_0x42, &&cb_0x43, &&cb_0x44, &&cb_0x45, &&cb_0x46, &&cb_0x47,
+    &&cb_0x40, &&cb_0x41, &&cb_0x42, &&cb_0x43, &&cb_0x44, &&cb_0x45, &&cb_0x46, &&cb_0x47,
+    &&cb_0x40, &&cb_0x41, &&cb_0x42, &&cb_0x43, &&cb_0x44, &&cb_0x45, &&cb_0x46, &&cb_0x47,
+    &&cb_0x40, &&cb_0x41, &&cb_0x42, &&cb_0x43, &&cb_0x44, &&cb_0x45, &&cb_0x46, &&cb_0x47,
+    &&cb_0x40, &&cb_0x41, &&cb_0x42, &&cb_0x43, &&cb_0x44, &&cb_0x45, &&cb_0x46, &&cb_0x47,
+    &&cb_0x80, &&cb_0x81, &&cb_0x82, &&cb_0x83, &&cb_0x84, &&cb_0x85, &&cb_0x86, &&cb_0x87,
+    &&cb_0x80, &&cb_0x81, &&cb_0x82, &&cb_0x83, &&cb_0x84, &&cb_0x85, &&cb_0x86, &&cb_0x87,
+    &&cb_0x80, &&cb_0x81, &&cb_0x82, &&cb_0x83, &&cb_0x84, &&cb_0x85, &&cb_0x86, &&cb_0x87,
+    &&cb_0x80, &&cb_0x81, &&cb_0x82, &&cb_0x83, &&cb_0x84, &&cb_0x85, &&cb_0x86, &&cb_0x87,
+    &&cb_0x80, &&cb_0x81, &&cb_0x82, &&cb_0x83, &&cb_0x84, &&cb_0x85, &&cb_0x86, &&cb_0x87,
+    &&cb_0x80, &&cb_0x81, &&cb_0x82, &&cb_0x83, &&cb_0x84, &&cb_0x85, &&cb_0x86, &&cb_0x87,
+    &&cb_0x80, &&cb_0x81, &&cb_0x82, &&cb_0x83, &&cb_0x84, &&cb_0x85, &&cb_0x86, &&cb_0x87,
+    &&cb_0x80, &&cb_0x81, &&cb_0x82, &&cb_0x83, &&cb_0x84, &&cb_0x85, &&cb_0x86, &&cb_0x87,
+    &&cb_0xc0, &&cb_0xc1, &&cb_0xc2, &&cb_0xc3, &&cb_0xc4, &&cb_0xc5, &&cb_0xc6, &&cb_0xc7,
+    &&cb_0xc0, &&cb_0xc1, &&cb_0xc2, &&cb_0xc3, &&cb_0xc4, &&cb_0xc5, &&cb_0xc6, &&cb_0xc7,
+    &&cb_0xc0, &&cb_0xc1, &&cb_0xc2, &&cb_0xc3, &&cb_0xc4, &&cb_0xc5, &&cb_0xc6, &&cb_0xc7,
+    &&cb_0xc0, &&cb_0xc1, &&cb_0xc2, &&cb_0xc3, &&cb_0xc4, &&cb_0xc5, &&cb_0xc6, &&cb_0xc7,
+    &&cb_0xc0, &&cb_0xc1, &&cb_0xc2, &&cb_0xc3, &&cb_0xc4, &&cb_0xc5, &&cb_0xc6, &&cb_0xc7,
+    &&cb_0xc0, &&cb_0xc1, &&cb_0xc2, &&cb_0xc3, &&cb_0xc4, &&cb_0xc5, &&cb_0xc6, &&cb_0xc7,
+    &&cb_0xc0, &&cb_0xc1, &&cb_0xc2, &&cb_0xc3, &&cb_0xc4, &&cb_0xc5, &&cb_0xc6, &&cb_0xc7,
+    &&cb_0xc0, &&cb_0xc1, &&cb_0xc2, &&cb_0xc3, &&cb_0xc4, &&cb_0xc5, &&cb_0xc6, &&cb_0xc7
+};
+
+static void* ed_ops[256] = {      // Constant, but want to be in RAM
+    &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default,
+    &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default,
+    &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default,
+    &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default,
+    &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default,
+    &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default,
+    &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default,
+    &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default,
+    &&ed_0x40, &&ed_0x41, &&ed_0x42, &&ed_0x43, &&ed_0x44, &&ed_0x45, &&ed_0x46, &&ed_0x47,
+    &&ed_0x48, &&ed_0x49, &&ed_0x4a, &&ed_0x4b, &&ed_0x4c, &&ed_0x4d, &&ed_0x4e, &&ed_0x4f,
+    &&ed_0x50, &&ed_0x51, &&ed_0x52, &&ed_0x53, &&ed_0x54, &&ed_0x55, &&ed_0x56, &&ed_0x57,
+    &&ed_0x58, &&ed_0x59, &&ed_0x5a, &&ed_0x5b, &&ed_0x5c, &&ed_0x5d, &&ed_0x5e, &&ed_0x5f,
+    &&ed_0x60, &&ed_0x61, &&ed_0x62, &&ed_0x63, &&ed_0x64, &&ed_0x65, &&ed_0x66, &&ed_0x67,
+    &&ed_0x68, &&ed_0x69, &&ed_0x6a, &&ed_0x6b, &&ed_0x6c, &&ed_0x6d, &&ed_0x6e, &&ed_0x6f,
+    &&ed_0x70, &&ed_0x71, &&ed_0x72, &&ed_0x73, &&ed_0x74, &&ed_0x75, &&ed_0x76, &&ed_default,
+    &&ed_0x78, &&ed_0x79, &&ed_0x7a, &&ed_0x7b, &&ed_0x7c, &&ed_0x7d, &&ed_0x7e, &&ed_default,
+    &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default,
+    &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default,
+    &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default,
+    &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default,
+    &&ed_0xa0, &&ed_0xa1, &&ed_0xa2, &&ed_0xa3, &&ed_default, &&ed_default, &&ed_default, &&ed_default,
+    &&ed_0xa8, &&ed_0xa9, &&ed_0xaa, &&ed_0xab, &&ed_default, &&ed_default, &&ed_default, &&ed_default,
+    &&ed_0xb0, &&ed_0xb1, &&ed_0xb2, &&ed_0xb3, &&ed_default, &&ed_default, &&ed_default, &&ed_default,
+    &&ed_0xb8, &&ed_0xb9, &&ed_0xba, &&ed_0xbb, &&ed_default, &&ed_default, &&ed_default, &&ed_default,
+    &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default,
+    &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default,
+    &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default,
+    &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default,
+    &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default,
+    &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default,
+    &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default,
+#ifdef LOAD_AND_SAVE
+    &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_default
+#else
+    &&ed_default, &&ed_default, &&ed_default, &&ed_default, &&ed_0xfc, &&ed_0xfd, &&ed_default, &&ed_default
+#endif
+};
+
+static void* dd_ops[256] = {      // Constant, but want to be in RAM
+    &&op_0, &&op_1, &&op_2, &&op_3, &&op_4, &&op_5, &&op_6, &&op_7,
+    &&op_8, &&dd_9, &&op_10, &&op_11, &&op_12, &&op_13, &&op_14, &&op_15,
+    &&op_16, &&op_17, &&op_18, &&op_19, &&op_20, &&op_21, &&op_22, &&op_23,
+    &&op_24, &&dd_25, &&op_26, &&op_27, &&op_28, &&op_29, &&op_30, &&op_31,
+    &&op_32, &&dd_33, &&dd_34, &&dd_35, &&dd_36, &&dd_37, &&dd_38, &&op_39,
+    &&op_40, &&dd_41, &&dd_42, &&dd_43, &&dd_44, &&dd_45, &&dd_46, &&op_47,
+    &&op_48, &&op_49, &&op_50, &&op_51, &&dd_52, &&dd_53, &&dd_54, &&op_55,
+    &&op_56, &&dd_57, &&op_58, &&op_59, &&op_60, &&op_61, &&op_62, &&op_63,
+    &&op_0x40, &&op_0x41, &&op_0x42, &&op_0x43, &&dd_0x44, &&dd_0x45, &&dd_0x46, &&op_0x47,
+    &&op_0x48, &&op_0x49, &&op_0x4a, &&op_0x4b, &&dd_0x4c, &&dd_0x4d, &&dd_0x4e, &&op_0x4f,
+    &&op_0x50, &&op_0x51, &&op_0x52, &&op_0x53, &&dd_0x54, &&dd_0x55, &&dd_0x56, &&op_0x57,
+    &&op_0x58, &&op_0x59, &&op_0x5a, &&op_0x5b, &&dd_0x5c, &&dd_0x5d, &&dd_0x5e, &&op_0x5f,
+    &&dd_0x60, &&dd_0x61, &&dd_0x62, &&dd_0x63, &&op_0x64, &&dd_0x65, &&dd_0x66, &&dd_0x67,
+    &&dd_0x68, &&dd_0x69, &&dd_0x6a, &&dd_0x6b, &&dd_0x6c, &&op_0x6d, &&dd_0x6e, &&dd_0x6f,
+    &&dd_0x70, &&dd_0x71, &&dd_0x72, &&dd_0x73, &&dd_0x74, &&dd_0x75, &&op_0x76, &&dd_0x77,
+    &&op_0x78, &&op_0x79, &&op_0x7a, &&op_0x7b, &&dd_0x7c, &&dd_0x7d, &&dd_0x7e, &&op_0x7f,
+    &&op_0x80, &&op_0x81, &&op_0x82, &&op_0x83, &&dd_0x84, &&dd_0x85, &&dd_0x86, &&op_0x87,
+    &&op_0x88, &&op_0x89, &&op_0x8a, &&op_0x8b, &&dd_0x8c, &&dd_0x8d, &&dd_0x8e, &&op_0x8f,
+    &&op_0x90, &&op_0x91, &&op_0x92, &&op_0x93, &&dd_0x94, &&dd_0x95, &&dd_0x96, &&op_0x97,
+    &&op_0x98, &&op_0x99, &&op_0x9a, &&op_0x9b, &&dd_0x9c, &&dd_0x9d, &&dd_0x9e, &&op_0x9f,
+    &&op_0xa0, &&op_0xa1, &&op_0xa2, &&op_0xa3, &&dd_0xa4, &&dd_0xa5, &&dd_0xa6, &&op_0xa7,
+    &&op_0xa8, &&op_0xa9, &&op_0xaa, &&op_0xab, &&dd_0xac, &&dd_0xad, &&dd_0xae, &&op_0xaf,
+    &&op_0xb0, &&op_0xb1, &&op_0xb2, &&op_0xb3, &&dd_0xb4, &&dd_0xb5, &&dd_0xb6, &&op_0xb7,
+    &&op_0xb8, &&op_0xb9, &&op_0xba, &&op_0xbb, &&dd_0xbc, &&dd_0xbd, &&dd_0xbe, &&op_0xbf,
+    &&op_0xc0, &&op_0xc1, &&op_0xc2, &&op_0xc3, &&op_0xc4, &&op_0xc5, &&op_0xc6, &&op_0xc7,
+    &&op_0xc8, &&op_0xc9, &&op_0xca, &&dd_0xcb, &&op_0xcc, &&op_0xcd, &&op_0xce, &&op_0xcf,
+    &&op_0xd0, &&op_0xd1, &&op_0xd2, &&op_0xd3, &&op_0xd4, &&op_0xd5, &&op_0xd6, &&op_0xd7,
+    &&op_0xd8, &&op_0xd9, &&op_0xda, &&op_0xdb, &&op_0xdc, &&op_0xdd, &&op_0xde, &&op_0xdf,
+    &&op_0xe0, &&dd_0xe1, &&op_0xe2, &&dd_0xe3, &&op_0xe4, &&dd_0xe5, &&op_0xe6, &&op_0xe7,
+    &&op_0xe8, &&dd_0xe9, &&op_0xea, &&op_0xeb, &&op_0xec, &&op_0xed, &&op_0xee, &&op_0xef,
+    &&op_0xf0, &&op_0xf1, &&op_0xf2, &&op_0xf3, &&op_0xf4, &&op_0xf5, &&op_0xf6, &&op_0xf7,
+    &&op_0xf8, &&dd_0xf9, &&op_0xfa, &&op_0xfb, &&op_0xfc, &&op_0xfd, &&op_0xfe, &&op_0xff
+};
+
+static void* fd_ops[256] = {      // Constant, but want to be in RAM
+    &&op_0, &&op_1, &&op_2, &&op_3, &&op_4, &&op_5, &&op_6, &&op_7,
+    &&op_8, &&fd_9, &&op_10, &&op_11, &&op_12, &&op_13, &&op_14, &&op_15,
+    &&op_16, &&op_17, &&op_18, &&op_19, &&op_20, &&op_21, &&op_22, &&op_23,
+    &&op_24, &&fd_25, &&op_26, &&op_27, &&op_28, &&op_29, &&op_30, &&op_31,
+    &&op_32, &&fd_33, &&fd_34, &&fd_35, &&fd_36, &&fd_37, &&fd_38, &&op_39,
+    &&op_40, &&fd_41, &&fd_42, &&fd_43, &&fd_44, &&fd_45, &&fd_46, &&op_47,
+    &&op_48, &&op_49, &&op_50, &&op_51, &&fd_52, &&fd_53, &&fd_54, &&op_55,
+    &&op_56, &&fd_57, &&op_58, &&op_59, &&op_60, &&op_61, &&op_62, &&op_63,
+    &&op_0x40, &&op_0x41, &&op_0x42, &&op_0x43, &&fd_0x44, &&fd_0x45, &&fd_0x46, &&op_0x47,
+    &&op_0x48, &&op_0x49, &&op_0x4a, &&op_0x4b, &&fd_0x4c, &&fd_0x4d, &&fd_0x4e, &&op_0x4f,
+    &&op_0x50, &&op_0x51, &&op_0x52, &&op_0x53, &&fd_0x54, &&fd_0x55, &&fd_0x56, &&op_0x57,
+    &&op_0x58, &&op_0x59, &&op_0x5a, &&op_0x5b, &&fd_0x5c, &&fd_0x5d, &&fd_0x5e, &&op_0x5f,
+    &&fd_0x60, &&fd_0x61, &&fd_0x62, &&fd_0x63, &&op_0x64, &&fd_0x65, &&fd_0x66, &&fd_0x67,
+    &&fd_0x68, &&fd_0x69, &&fd_0x6a, &&fd_0x6b, &&fd_0x6c, &&op_0x6d, &&fd_0x6e, &&fd_0x6f,
+    &&fd_0x70, &&fd_0x71, &&fd_0x72, &&fd_0x73, &&fd_0x74, &&fd_0x75, &&op_0x76, &&fd_0x77,
+    &&op_0x78, &&op_0x79, &&op_0x7a, &&op_0x7b, &&fd_0x7c, &&fd_0x7d, &&fd_0x7e, &&op_0x7f,
+    &&op_0x80, &&op_0x81, &&op_0x82, &&op_0x83, &&fd_0x84, &&fd_0x85, &&fd_0x86, &&op_0x87,
+    &&op_0x88, &&op_0x89, &&op_0x8a, &&op_0x8b, &&fd_0x8c, &&fd_0x8d, &&fd_0x8e, &&op_0x8f,
+    &&op_0x90, &&op_0x91, &&op_0x92, &&op_0x93, &&fd_0x94, &&fd_0x95, &&fd_0x96, &&op_0x97,
+    &&op_0x98, &&op_0x99, &&op_0x9a, &&op_0x9b, &&fd_0x9c, &&fd_0x9d, &&fd_0x9e, &&op_0x9f,
+    &&op_0xa0, &&op_0xa1, &&op_0xa2, &&op_0xa3, &&fd_0xa4, &&fd_0xa5, &&fd_0xa6, &&op_0xa7,
+    &&op_0xa8, &&op_0xa9, &&op_0xaa, &&op_0xab, &&fd_0xac, &&fd_0xad, &&fd_0xae, &&op_0xaf,
+    &&op_0xb0, &&op_0xb1, &&op_0xb2, &&op_0xb3, &&fd_0xb4, &&fd_0xb5, &&fd_0xb6, &&op_0xb7,
+    &&op_0xb8, &&op_0xb9, &&op_0xba, &&op_0xbb, &&fd_0xbc, &&fd_0xbd, &&fd_0xbe, &&op_0xbf,
+    &&op_0xc0, &&op_0xc1, &&op_0xc2, &&op_0xc3, &&op_0xc4, &&op_0xc5, &&op_0xc6, &&op_0xc7,
+    &&op_0xc8, &&op_0xc9, &&op_0xca, &&fd_0xcb, &&op_0xcc, &&op_0xcd, &&op_0xce, &&op_0xcf,
+    &&op_0xd0, &&op_0xd1, &&op_0xd2, &&op_0xd3, &&op_0xd4, &&op_0xd5, &&op_0xd6, &&op_0xd7,
+    &&op_0xd8, &&op_0xd9, &&op_0xda, &&op_0xdb, &&op_0xdc, &&op_0xdd, &&op_0xde, &&op_0xdf,
+    &&op_0xe0, &&fd_0xe1, &&op_0xe2, &&fd_0xe3, &&op_0xe4, &&fd_0xe5, &&op_0xe6, &&op_0xe7,
+    &&op_0xe8, &&fd_0xe9, &&op_0xea, &&op_0xeb, &&op_0xec, &&op_0xed, &&op_0xee, &&op_0xef,
+    &&op_0xf0, &&op_0xf1, &&op_0xf2, &&op_0xf3, &&op_0xf4, &&op_0xf5, &&op_0xf6, &&op_0xf7,
+    &&op_0xf8, &&fd_0xf9, &&op_0xfa, &&op_0xfb, &&op_0xfc, &&op_0xfd, &&op_0xfe, &&op_0xff
+};
+
+static void* ddcb_ops[256] = {    // Constant, but want to be in RAM
+    &&ddcb_0, &&ddcb_1, &&ddcb_2, &&ddcb_3, &&ddcb_4, &&ddcb_5, &&ddcb_6, &&ddcb_7,
+    &&ddcb_8, &&ddcb_9, &&ddcb_10, &&ddcb_11, &&ddcb_12, &&ddcb_13, &&ddcb_14, &&ddcb_15,
+    &&ddcb_0x10, &&ddcb_0x11, &&ddcb_0x12, &&ddcb_0x13, &&ddcb_0x14, &&ddcb_0x15, &&ddcb_0x16, &&ddcb_0x17,
+    &&ddcb_0x18, &&ddcb_0x19, &&ddcb_0x1a, &&ddcb_0x1b, &&ddcb_0x1c, &&ddcb_0x1d, &&ddcb_0x1e, &&ddcb_0x1f,
+    &&ddcb_0x20, &&ddcb_0x21, &&ddcb_0x22, &&ddcb_0x23, &&ddcb_0x24, &&ddcb_0x25, &&ddcb_0x26, &&ddcb_0x27,
+    &&ddcb_0x28, &&ddcb_0x29, &&ddcb_0x2a, &&ddcb_0x2b, &&ddcb_0x2c, &&ddcb_0x2d, &&ddcb_0x2e, &&ddcb_0x2f,
+    &&ddcb_0x30, &&ddcb_0x31, &&ddcb_0x32, &&ddcb_0x33, &&ddcb_0x34, &&ddcb_0x35, &&ddcb_0x36, &&ddcb_0x37,
+    &&ddcb_0x38, &&ddcb_0x39, &&ddcb_0x3a, &&ddcb_0x3b, &&ddcb_0x3c, &&ddcb_0x3d, &&ddcb_0x3e, &&ddcb_0x3f,
+    &&ddcb_0x40, &&ddcb_0x41, &&ddcb_0x42, &&ddcb_0x43, &&ddcb_0x44, &&ddcb_0x45, &&ddcb_0x46, &&ddcb_0x47,
+    &&ddcb_0x40, &&ddcb_0x41, &&ddcb_0x42, &&ddcb_0x43, &&ddcb_0x44, &&ddcb_0x45, &&ddcb_0x46, &&ddcb_0x47,
+    &&ddcb_0x40, &&ddcb_0x41, &&ddcb_0x42, &&ddcb_0x43, &&ddcb_0x44, &&ddcb_0x45, &&ddcb_0x46, &&ddcb_0x47,
+    &&ddcb_0x40, &&ddcb_0x41, &&ddcb_0x42, &&ddcb_0x43, &&ddcb_0x44, &&ddcb_0x45, &&ddcb_0x46, &&ddcb_0x47,
+    &&ddcb_0x40, &&ddcb_0x41, &&ddcb_0x42, &&ddcb_0x43, &&ddcb_0x44, &&ddcb_0x45, &&ddcb_0x46, &&ddcb_0x47,
+    &&ddcb_0x40, &&ddcb_0x41, &&ddcb_0x42, &&ddcb_0x43, &&ddcb_0x44, &&ddcb_0x45, &&ddcb_0x46, &&ddcb_0x47,
+    &&ddcb_0x40, &&ddcb_0x41, &&ddcb_0x42, &&ddcb_0x43, &&ddcb_0x44, &&ddcb_0x45, &&ddcb_0x46, &&ddcb_0x47,
+    &&ddcb_0x40, &&ddcb_0x41, &&ddcb_0x42, &&ddcb_0x43, &&ddcb_0x44, &&ddcb_0x45, &&ddcb_0x46, &&ddcb_0x47,
+    &&ddcb_0x80, &&ddcb_0x81, &&ddcb_0x82, &&ddcb_0x83, &&ddcb_0x84, &&ddcb_0x85, &&ddcb_0x86, &&ddcb_0x87,
+    &&ddcb_0x80, &&ddcb_0x81, &&ddcb_0x82, &&ddcb_0x83, &&ddcb_0x84, &&ddcb_0x85, &&ddcb_0x86, &&ddcb_0x87,
+    &&ddcb_0x80, &&ddcb_0x81, &&ddcb_0x82, &&ddcb_0x83, &&ddcb_0x84, &&ddcb_0x85, &&ddcb_0x86, &&ddcb_0x87,
+    &&ddcb_0x80, &&ddcb_0x81, &&ddcb_0x82, &&ddcb_0x83, &&ddcb_0x84, &&ddcb_0x85, &&ddcb_0x86, &&ddcb_0x87,
+    &&ddcb_0x80, &&ddcb_0x81, &&ddcb_0x82, &&ddcb_0x83, &&ddcb_0x84, &&ddcb_0x85, &&ddcb_0x86, &&ddcb_0x87,
+    &&ddcb_0x80, &&ddcb_0x81, &&ddcb_0x82, &&ddcb_0x83, &&ddcb_0x84, &&ddcb_0x85, &&ddcb_0x86, &&ddcb_0x87,
+    &&ddcb_0x80, &&ddcb_0x81, &&ddcb_0x82, &&ddcb_0x83, &&ddcb_0x84, &&ddcb_0x85, &&ddcb_0x86, &&ddcb_0x87,
+    &&ddcb_0x80, &&ddcb_0x81, &&ddcb_0x82, &&ddcb_0x83, &&ddcb_0x84, &&ddcb_0x85, &&ddcb_0x86, &&ddcb_0x87,
+    &&ddcb_0xc0, &&ddcb_0xc1, &&ddcb_0xc2, &&ddcb_0xc3, &&ddcb_0xc4, &&ddcb_0xc5, &&ddcb_0xc6, &&ddcb_0xc7,
+    &&ddcb_0xc0, &&ddcb_0xc1, &&ddcb_0xc2, &&ddcb_0xc3, &&ddcb_0xc4, &&ddcb_0xc5, &&ddcb_0xc6, &&ddcb_0xc7,
+    &&ddcb_0xc0, &&ddcb_0xc1, &&ddcb_0xc2, &&ddcb_0xc3, &&ddcb_0xc4, &&ddcb_0xc5, &&ddcb_0xc6, &&ddcb_0xc7,
+    &&ddcb_0xc0, &&ddcb_0xc1, &&ddcb_0xc2, &&ddcb_0xc3, &&ddcb_0xc4, &&ddcb_0xc5, &&ddcb_0xc6, &&ddcb_0xc7,
+    &&ddcb_0xc0, &&ddcb_0xc1, &&ddcb_0xc2, &&ddcb_0xc3, &&ddcb_0xc4, &&ddcb_0xc5, &&ddcb_0xc6, &&ddcb_0xc7,
+    &&ddcb_0xc0, &&ddcb_0xc1, &&ddcb_0xc2, &&ddcb_0xc3, &&ddcb_0xc4, &&ddcb_0xc5, &&ddcb_0xc6, &&ddcb_0xc7,
+    &&ddcb_0xc0, &&ddcb_0xc1, &&ddcb_0xc2, &&ddcb_0xc3, &&ddcb_0xc4, &&ddcb_0xc5, &&ddcb_0xc6, &&ddcb_0xc7,
+    &&ddcb_0xc0, &&ddcb_0xc1, &&ddcb_0xc2, &&ddcb_0xc3, &&ddcb_0xc4, &&ddcb_0xc5, &&ddcb_0xc6, &&ddcb_0xc7
+};
+
+static void* fdcb_ops[256] = {    // Constant, but want to be in RAM
+    &&fdcb_0, &&fdcb_1, &&fdcb_2, &&fdcb_3, &&fdcb_4, &&fdcb_5, &&fdcb_6, &&fdcb_7,
+    &&fdcb_8, &&fdcb_9, &&fdcb_10, &&fdcb_11, &&fdcb_12, &&fdcb_13, &&fdcb_14, &&fdcb_15,
+    &&fdcb_0x10, &&fdcb_0x11, &&fdcb_0x12, &&fdcb_0x13, &&fdcb_0x14, &&fdcb_0x15, &&fdcb_0x16, &&fdcb_0x17,
+    &&fdcb_0x18, &&fdcb_0x19, &&fdcb_0x1a, &&fdcb_0x1b, &&fdcb_0x1c, &&fdcb_0x1d, &&fdcb_0x1e, &&fdcb_0x1f,
+    &&fdcb_0x20, &&fdcb_0x21, &&fdcb_0x22, &&fdcb_0x23, &&fdcb_0x24, &&fdcb_0x25, &&fdcb_0x26, &&fdcb_0x27,
+    &&fdcb_0x28, &&fdcb_0x29, &&fdcb_0x2a, &&fdcb_0x2b, &&fdcb_0x2c, &&fdcb_0x2d, &&fdcb_0x2e, &&fdcb_0x2f,
+    &&fdcb_0x30, &&fdcb_0x31, &&fdcb_0x32, &&fdcb_0x33, &&fdcb_0x34, &&fdcb_0x35, &&fdcb_0x36, &&fdcb_0x37,
+    &&fdcb_0x38, &&fdcb_0x39, &&fdcb_0x3a, &&fdcb_0x3b, &&fdcb_0x3c, &&fdcb_0x3d, &&fdcb_0x3e, &&fdcb_0x3f,
+    &&fdcb_0x40, &&fdcb_0x41, &&fdcb_0x42, &&fdcb_0x43, &&fdcb_0x44, &&fdcb_0x45, &&fdcb_0x46, &&fdcb_0x47,
+    &&fdcb_0x40, &&fdcb_0x41, &&fdcb_0x42, &&fdcb_0x43, &&fdcb_0x44, &&fdcb_0x45, &&fdcb_0x46, &&fdcb_0x47,
+    &&fdcb_0x40, &&fdcb_0x41, &&fdcb_0x42, &&fdcb_0x43, &&fdcb_0x44, &&fdcb_0x45, &&fdcb_0x46, &&fdcb_0x47,
+    &&fdcb_0x40, &&fdcb_0x41, &&fdcb_0x42, &&fdcb_0x43, &&fdcb_0x44, &&fdcb_0x45, &&fdcb_0x46, &&fdcb_0x47,
+    &&fdcb_0x40, &&fdcb_0x41, &&fdcb_0x42, &&fdcb_0x43, &&fdcb_0x44, &&fdcb_0x45, &&fdcb_0x46, &&fdcb_0x47,
+    &&fdcb_0x40, &&fdcb_0x41, &&fdcb_0x42, &&fdcb_0x43, &&fdcb_0x44, &&fdcb_0x45, &&fdcb_0x46, &&fdcb_0x47,
+    &&fdcb_0x40, &&fdcb_0x41, &&fdcb_0x42, &&fdcb_0x43, &&fdcb_0x44, &&fdcb_0x45, &&fdcb_0x46, &&fdcb_0x47,
+    &&fdcb_0x40, &&fdcb_0x41, &&fdcb_0x42, &&fdcb_0x43, &&fdcb_0x44, &&fdcb_0x45, &&fdcb_0x46, &&fdcb_0x47,
+    &&fdcb_0x80, &&fdcb_0x81, &&fdcb_0x82, &&fdcb_0x83, &&fdcb_0x84, &&fdcb_0x85, &&fdcb_0x86, &&fdcb_0x87,
+    &&fdcb_0x80, &&fdcb_0x81, &&fdcb_0x82, &&fdcb_0x83, &&fdcb_0x84, &&fdcb_0x85, &&fdcb_0x86, &&fdcb_0x87,
+    &&fdcb_0x80, &&fdcb_0x81, &&fdcb_0x82, &&fdcb_0x83, &&fdcb_0x84, &&fdcb_0x85, &&fdcb_0x86, &&fdcb_0x87,
+    &&fdcb_0x80, &&fdcb_0x81, &&fdcb_0x82, &&fdcb_0x83, &&fdcb_0x84, &&fdcb_0x85, &&fdcb_0x86, &&fdcb_0x87,
+    &&fdcb_0x80, &&fdcb_0x81, &&fdcb_0x82, &&fdcb_0x83, &&fdcb_0x84, &&fdcb_0x85, &&fdcb_0x86, &&fdcb_0x87,
+    &&fdcb_0x80, &&fdcb_0x81, &&fdcb_0x82, &&fdcb_0x83, &&fdcb_0x84, &&fdcb_0x85, &&fdcb_0x86, &&fdcb_0x87,
+    &&fdcb_0x80, &&fdcb_0x81, &&fdcb_0x82, &&fdcb_0x83, &&fdcb_0x84, &&fdcb_0x85, &&fdcb_0x86, &&fdcb_0x87,
+    &&fdcb_0x80, &&fdcb_0x81, &&fdcb_0x82, &&fdcb_0x83, &&fdcb_0x84, &&fdcb_0x85, &&fdcb_0x86, &&fdcb_0x87,
+    &&fdcb_0xc0, &&fdcb_0xc1, &&fdcb_0xc2, &&fdcb_0xc3, &&fdcb_0xc4, &&fdcb_0xc5, &&fdcb_0xc6, &&fdcb_0xc7,
+    &&fdcb_0xc0, &&fdcb_0xc1, &&fdcb_0xc2, &&fdcb_0xc3, &&fdcb_0xc4, &&fdcb_0xc5, &&fdcb_0xc6, &&fdcb_0xc7,
+    &&fdcb_0xc0, &&fdcb_0xc1, &&fdcb_0xc2, &&fdcb_0xc3, &&fdcb_0xc4, &&fdcb_0xc5, &&fdcb_0xc6, &&fdcb_0xc7,
+    &&fdcb_0xc0, &&fdcb_0xc1, &&fdcb_0xc2, &&fdcb_0xc3, &&fdcb_0xc4, &&fdcb_0xc5, &&fdcb_0xc6, &&fdcb_0xc7,
+    &&fdcb_0xc0, &&fdcb_0xc1, &&fdcb_0xc2, &&fdcb_0xc3, &&fdcb_0xc4, &&fdcb_0xc5, &&fdcb_0xc6, &&fdcb_0xc7,
+    &&fdcb_0xc0, &&fdcb_0xc1, &&fdcb_0xc2, &&fdcb_0xc3, &&fdcb_0xc4, &&fdcb_0xc5, &&fdcb_0xc6, &&fdcb_0xc7,
+    &&fdcb_0xc0, &&fdcb_0xc1, &&fdcb_0xc2, &&fdcb_0xc3, &&fdcb_0xc4, &&fdcb_0xc5, &&fdcb_0xc6, &&fdcb_0xc7,
+    &&fdcb_0xc0, &&fdcb_0xc1, &&fdcb_0xc2, &&fdcb_0xc3, &&fdcb_0xc4, &&fdcb_0xc5, &&fdcb_0xc6, &&fdcb_0xc7
+};
+
+static void** xy_ops[3] = {main_ops, dd_ops, fd_ops};
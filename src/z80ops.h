@@ -16,93 +16,123 @@
  * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 
-#define instr(opcode,cycles) case opcode: {tstates+=cycles
+/* With Z80_THREADED each opcode is a label (op_xx, cb_xx, ed_xx) reached
+ * through the tables in z80jump.h, otherwise it is a switch case. The
+ * label prefix for the page being compiled is held in Z80_PAGE.
+ * Instructions which use HL are in xyops.h, which is compiled once for
+ * each of HL, IX and IY. Z80_XMODE (0, 1 or 2) is a constant within each
+ * copy, so the xh/xl/addhl/HLinstr tests below are resolved at compile
+ * time and the unprefixed instructions have no index register code */
+#ifdef Z80_THREADED
+#define Z80_PAGE op_
+#define oplabel(page,opcode) page##opcode
+#define oplabelx(page,opcode) oplabel(page,opcode)
+#define opcase(opcode) oplabelx(Z80_PAGE,opcode)
+#else
+#define opcase(opcode) case opcode
+#endif
+
+#define instr(opcode,cycles) opcase(opcode): {tstates+=cycles
 #define HLinstr(opcode,cycles,morecycles) \
-                             case opcode: {unsigned short addr; \
+                             opcase(opcode): {unsigned short addr; \
                                 tstates+=cycles; \
-                                if(ixoriy==0)addr=hl; \
+                                if(Z80_XMODE==0)addr=hl; \
                                 else tstates+=morecycles, \
-                                   addr=(ixoriy==1?ix:iy)+ \
+                                   addr=(Z80_XMODE==1?ix:iy)+ \
                                         (signed char)fetchm(pc),\
                                    pc++
 #define endinstr             }; break
 
-#define cy (f&1)
+#define cy (getf()&1)
 
-#define xh (ixoriy==0?h:ixoriy==1?(ix>>8):(iy>>8))
-#define xl (ixoriy==0?l:ixoriy==1?(ix&0xff):(iy&0xff))
+#define xh (Z80_XMODE==0?h:Z80_XMODE==1?(ix>>8):(iy>>8))
+#define xl (Z80_XMODE==0?l:Z80_XMODE==1?(ix&0xff):(iy&0xff))
 
-#define setxh(x) (ixoriy==0?(h=(x)):ixoriy==1?(ix=(ix&0xff)|((x)<<8)):\
+#define setxh(x) (Z80_XMODE==0?(h=(x)):Z80_XMODE==1?(ix=(ix&0xff)|((x)<<8)):\
                   (iy=(iy&0xff)|((x)<<8)))
-#define setxl(x) (ixoriy==0?(l=(x)):ixoriy==1?(ix=(ix&0xff00)|(x)):\
+#define setxl(x) (Z80_XMODE==0?(l=(x)):Z80_XMODE==1?(ix=(ix&0xff00)|(x)):\
                   (iy=(iy&0xff00)|(x)))
 
-#define inc(var) /* 8-bit increment */ ( var++,\
-                                         f=(f&1)|(var&0xa8)|\
-                                           ((!(var&15))<<4)|((!var)<<6)|\
-                                           ((var==128)<<2)\
+#define inc(var) /* 8-bit increment */ ( lazyc=cy,\
+                                         lazyy=++var,\
+                                         lazyf=LAZY_INC\
                                        )
-#define dec(var) /* 8-bit decrement */ ( f=(f&1)|((!(var&15))<<4)|2,\
-                                         --var,\
-                                         f|=(var&0xa8)|((var==127)<<2)|\
-                                            ((!var)<<6)\
+#define dec(var) /* 8-bit decrement */ ( lazyc=cy,\
+                                         lazyy=--var,\
+                                         lazyf=LAZY_DEC\
                                        )
 #define swap(x,y) {unsigned char t=x; x=y; y=t;}
-#define addhl(hi,lo) /* 16-bit add */ if(!ixoriy){\
+#define addhl(hi,lo) /* 16-bit add */ if(!Z80_XMODE){\
                       unsigned short t;\
                       l=t=l+(lo);\
-                      f=(f&0xc4)|(((t>>=8)+(h&0x0f)+((hi)&0x0f)>15)<<4);\
+                      f=(getf()&0xc4)|(((t>>=8)+(h&0x0f)+((hi)&0x0f)>15)<<4);\
                       h=t+=h+(hi);\
                       f|=(h&0x28)|(t>>8);\
                    }\
-                   else do{unsigned long t=(ixoriy==1?ix:iy);\
-                      f=(f&0xc4)|(((t&0xfff)+((hi<<8)|lo)>0xfff)<<4);\
+                   else do{unsigned long t=(Z80_XMODE==1?ix:iy);\
+                      f=(getf()&0xc4)|(((t&0xfff)+((hi<<8)|lo)>0xfff)<<4);\
                       t+=(hi<<8)|lo;\
-                      if(ixoriy==1)ix=t; else iy=t;\
+                      if(Z80_XMODE==1)ix=t; else iy=t;\
                       f|=((t>>8)&0x28)|(t>>16);\
                    } while(0)
-#define adda(x,c) /* 8-bit add */ do{unsigned short y;\
-                      unsigned char z=(x);\
-                      y=a+z+(c);\
-                      f=(y&0xa8)|(y>>8)|(((a&0x0f)+(z&0x0f)+(c)>15)<<4)|\
-                        (((~a^z)&0x80&(y^a))>>5);\
-                      f|=(!(a=y))<<6;\
+#define adda(x,c) /* 8-bit add */ do{unsigned char z=(x);\
+                      lazyc=(c);\
+                      lazyy=a+z+lazyc;\
+                      lazya=a; lazyz=z;\
+                      a=lazyy;\
+                      lazyf=LAZY_ADD;\
                    } while(0)
-#define suba(x,c) /* 8-bit subtract */ do{unsigned short y;\
-                      unsigned char z=(x);\
-                      y=(a-z-(c))&0x1ff;\
-                      f=(y&0xa8)|(y>>8)|(((a&0x0f)<(z&0x0f)+(c))<<4)|\
-                        (((a^z)&0x80&(y^a))>>5)|2;\
-                      f|=(!(a=y))<<6;\
+#define suba(x,c) /* 8-bit subtract */ do{unsigned char z=(x);\
+                      lazyc=(c);\
+                      lazyy=(a-z-lazyc)&0x1ff;\
+                      lazya=a; lazyz=z;\
+                      a=lazyy;\
+                      lazyf=LAZY_SUB;\
                    } while(0)
-#define cpa(x) /* 8-bit compare */ do{unsigned short y;\
-                      unsigned char z=(x);\
-                      y=(a-z)&0x1ff;\
-                      f=(y&0xa8)|(y>>8)|(((a&0x0f)<(z&0x0f))<<4)|\
-                        (((a^z)&0x80&(y^a))>>5)|2|((!y)<<6);\
+#define cpa(x) /* 8-bit compare */ do{unsigned char z=(x);\
+                      lazyc=0;\
+                      lazyy=(a-z)&0x1ff;\
+                      lazya=a; lazyz=z;\
+                      lazyf=LAZY_SUB;\
                    } while(0)
 #define anda(x) /* logical and */ do{\
-                      a&=(x);\
-                      f=(a&0xa8)|((!a)<<6)|0x10|parity(a);\
+                      lazyy=a&=(x);\
+                      lazyz=0x10;\
+                      lazyf=LAZY_LOGIC;\
                    } while(0)
 #define xora(x) /* logical xor */ do{\
-                      a^=(x);\
-                      f=(a&0xa8)|((!a)<<6)|parity(a);\
+                      lazyy=a^=(x);\
+                      lazyz=0;\
+                      lazyf=LAZY_LOGIC;\
                    } while(0)
 #define ora(x) /* logical or */ do{\
-                      a|=(x);\
-                      f=(a&0xa8)|((!a)<<6)|parity(a);\
+                      lazyy=a|=(x);\
+                      lazyz=0;\
+                      lazyf=LAZY_LOGIC;\
                    } while(0)
 
 #define jr /* execute relative jump */ do{int j=(signed char)fetch(pc);\
                       pc+=j+1;\
                       tstates+=5;\
+                      if(j<0)spinCheck(tstore);\
                    } while(0)
 #define jp /* execute jump */ (pc=fetch2(pc))
+#define jploop /* execute jump, checking backward jumps for idle loop */ \
+                   do{unsigned short o=pc;\
+                      jp;\
+                      if(pc<o)spinCheck(tstore);\
+                   } while(0)
+#ifdef ROM_HLE
+#define romcheck /* run a ROM routine natively */ \
+                   do{if(ROM_HLE_AT(pc))tstore+=romHLE(tstore);} while(0)
+#else
+#define romcheck
+#endif
 #define call /* execute call */ do{\
                       tstates+=7;\
                       push2(pc+2);\
                       jp;\
+                      romcheck;\
                    } while(0)
 #define ret /* execute return */ do{\
                       tstates+=6;\
@@ -148,18 +178,15 @@ endinstr;
 
 instr(7,4);
    a=(a<<1)|(a>>7);
-   f=(f&0xc4)|(a&0x29);
+   f=(getf()&0xc4)|(a&0x29);
 endinstr;
 
 instr(8,4);
    swap(a,a1);
+   getf();
    swap(f,f1);
 endinstr;
 
-instr(9,11);
-   addhl(b,c);
-endinstr;
-
 instr(10,7);
    a=fetch(bc);
 endinstr;
@@ -181,21 +208,24 @@ instr(14,7);
 endinstr;
 
 instr(15,4);
-   f=(f&0xc4)|(a&1);
+   f=(getf()&0xc4)|(a&1);
    a=(a>>1)|(a<<7);
    f|=a&0x28;
 endinstr;
 
 instr(16,8);
    if(!--b)pc++;
-   else jr;
+   else{
+      if(fetch(pc)==0xfe)djnzSkip(tstore);   /* DJNZ $ */
+      jr;
+   }
 endinstr;
 
 instr(17,10);
    e=fetch(pc),pc++;
    d=fetch(pc),pc++;
 #ifdef LOAD_AND_SAVE
-   if ((pc == SAVE_START_8K) && (!rom4k)) loadAndSaveROM();
+   if ((pc == SAVE_START_8K) && rom_traps && (!rom4k)) loadAndSaveROM();
 #endif
 endinstr;
 
@@ -221,8 +251,8 @@ endinstr;
 
 instr(23,4);
   {int t=a>>7;
-   a=(a<<1)|(f&1);
-   f=(f&0xc4)|(a&0x28)|t;
+   a=(a<<1)|(getf()&1);
+   f=(getf()&0xc4)|(a&0x28)|t;
   }
 endinstr;
 
@@ -230,10 +260,6 @@ instr(24,7);
    jr;
 endinstr;
 
-instr(25,11);
-   addhl(d,e);
-endinstr;
-
 instr(26,7);
    a=fetch(de);
 endinstr;
@@ -256,147 +282,42 @@ endinstr;
 
 instr(31,4);
   {int t=a&1;
-   a=(a>>1)|(f<<7);
-   f=(f&0xc4)|(a&0x28)|t;
+   a=(a>>1)|(getf()<<7);
+   f=(getf()&0xc4)|(a&0x28)|t;
   }
 endinstr;
 
 instr(32,7);
-  if(f&0x40)pc++;
+  if(getf()&0x40)pc++;
   else jr;
 endinstr;
 
-instr(33,10);
-   if(!ixoriy){
-      l=fetch(pc),pc++;
-      h=fetch(pc),pc++;
-#ifdef LOAD_AND_SAVE
-      if ((pc == LOAD_SAVE_RET_8K) && (!rom4k)) loadAndSaveROM();
-#endif
-   }
-   else {
-      if(ixoriy==1)
-        ix=fetch2(pc);
-      else iy=fetch2(pc);
-      pc+=2;
-   }
-endinstr;
-
-instr(34,16);
-   {unsigned short addr=fetch2(pc);
-    pc+=2;
-    if(!ixoriy)store2b(addr,h,l);
-    else if(ixoriy==1)store2(addr,ix);
-    else store2(addr,iy);
-   }
-endinstr;
-
-instr(35,6);
-   if(!ixoriy){if(!++l)h++;}
-   else if(ixoriy==1)ix++;
-   else iy++;
-endinstr;
-
-instr(36,4);
-   if(ixoriy==0)inc(h);
-   else{unsigned char t;
-      t=(ixoriy==1?ix:iy)>>8;
-      inc(t);
-      if(ixoriy==1)ix=(ix&0xff)|(t<<8);
-      else iy=(iy&0xff)|(t<<8);
-   }
-endinstr;
-
-instr(37,4);
-   if(ixoriy==0)dec(h);
-   else{unsigned char t;
-      t=(ixoriy==1?ix:iy)>>8;
-      dec(t);
-      if(ixoriy==1)ix=(ix&0xff)|(t<<8);
-      else iy=(iy&0xff)|(t<<8);
-   }
-endinstr;
-
-instr(38,7);
-   setxh(fetch(pc));
-   pc++;
-endinstr;
-
 instr(39,4);
    {
       unsigned char incr=0, carry=cy;
-      if((f&0x10) || (a&0x0f)>9) incr=6;
-      if((f&1) || (a>>4)>9) incr|=0x60;
-      if(f&2)suba(incr,0);
+      if((getf()&0x10) || (a&0x0f)>9) incr=6;
+      if((getf()&1) || (a>>4)>9) incr|=0x60;
+      if(getf()&2)suba(incr,0);
       else {
          if(a>0x90 && (a&15)>9)incr|=0x60;
          adda(incr,0);
       }
-      f=((f|carry)&0xfb)|parity(a);
+      f=((getf()|carry)&0xfb)|parity(a);
    }
 endinstr;
 
 instr(40,7);
-   if(f&0x40)jr;
+   if(getf()&0x40)jr;
    else pc++;
 endinstr;
 
-instr(41,11);
-   if(!ixoriy)addhl(h,l);
-   else if(ixoriy==1)addhl((ix>>8),(ix&0xff));
-   else addhl((iy>>8),(iy&0xff));
-endinstr;
-
-instr(42,16);
-  {unsigned short addr=fetch2(pc);
-   pc+=2;
-   if(!ixoriy){
-      l=fetch(addr);
-      h=fetch(addr+1);
-   }
-   else if(ixoriy==1)ix=fetch2(addr);
-   else iy=fetch2(addr);
-  }
-endinstr;
-
-instr(43,6);
-   if(!ixoriy){if(!l--)h--;}
-   else if(ixoriy==1)ix--;
-   else iy--;
-endinstr;
-
-instr(44,4);
-   if(!ixoriy)inc(l);
-   else {unsigned char t;
-      t=(ixoriy==1?ix:iy);
-      inc(t);
-      if(ixoriy==1)ix=(ix&0xff00)|t;
-      else iy=(iy&0xff00)|t;
-   }
-endinstr;
-
-instr(45,4);
-   if(!ixoriy)dec(l);
-   else {unsigned char t;
-      t=(ixoriy==1?ix:iy);
-      dec(t);
-      if(ixoriy==1)ix=(ix&0xff00)|t;
-      else iy=(iy&0xff00)|t;
-   }
-endinstr;
-
-instr(46,7);
-   setxl(fetch(pc));
-   pc++;
-endinstr;
-
 instr(47,4);
    a=~a;
-   f=(f&0xc5)|(a&0x28)|0x12;
+   f=(getf()&0xc5)|(a&0x28)|0x12;
 endinstr;
 
 instr(48,7);
-   if(f&1)pc++;
+   if(getf()&1)pc++;
    else jr;
 endinstr;
 
@@ -416,38 +337,15 @@ instr(51,6);
    sp++;
 endinstr;
 
-HLinstr(52,11,8);
-  {unsigned char t=fetch(addr);
-   inc(t);
-   store(addr,t);
-  }
-endinstr;
-
-HLinstr(53,11,8);
-  {unsigned char t=fetch(addr);
-   dec(t);
-   store(addr,t);
-  }
-endinstr;
-
-HLinstr(54,10,5);
-   store(addr,fetch(pc));
-   pc++;
-endinstr;
-
 instr(55,4);
-   f=(f&0xc4)|1|(a&0x28);
+   f=(getf()&0xc4)|1|(a&0x28);
 endinstr;
 
 instr(56,7);
-   if(f&1)jr;
+   if(getf()&1)jr;
    else pc++;
 endinstr;
 
-instr(57,11);
-   addhl((sp>>8),(sp&0xff));
-endinstr;
-
 instr(58,13);
   {unsigned short addr=fetch2(pc);
    pc+=2;
@@ -472,7 +370,7 @@ instr(62,7);
 endinstr;
 
 instr(63,4);
-   f=(f&0xc4)|(cy^1)|(cy<<4)|(a&0x28);
+   f=(getf()&0xc4)|(cy^1)|(cy<<4)|(a&0x28);
 endinstr;
 
 instr(0x40,4);
@@ -491,18 +389,6 @@ instr(0x43,4);
    b=e;
 endinstr;
 
-instr(0x44,4);
-   b=xh;
-endinstr;
-
-instr(0x45,4);
-   b=xl;
-endinstr;
-
-HLinstr(0x46,7,8);
-   b=fetch(addr);
-endinstr;
-
 instr(0x47,4);
    b=a;
 endinstr;
@@ -523,18 +409,6 @@ instr(0x4b,4);
    c=e;
 endinstr;
 
-instr(0x4c,4);
-   c=xh;
-endinstr;
-
-instr(0x4d,4);
-   c=xl;
-endinstr;
-
-HLinstr(0x4e,7,8);
-   c=fetch(addr);
-endinstr;
-
 instr(0x4f,4);
    c=a;
 endinstr;
@@ -555,18 +429,6 @@ instr(0x53,4);
    d=e;
 endinstr;
 
-instr(0x54,4);
-   d=xh;
-endinstr;
-
-instr(0x55,4);
-   d=xl;
-endinstr;
-
-HLinstr(0x56,7,8);
-   d=fetch(addr);
-endinstr;
-
 instr(0x57,4);
    d=a;
 endinstr;
@@ -587,118 +449,22 @@ instr(0x5b,4);
    /* ld e,e */
 endinstr;
 
-instr(0x5c,4);
-   e=xh;
-endinstr;
-
-instr(0x5d,4);
-   e=xl;
-endinstr;
-
-HLinstr(0x5e,7,8);
-   e=fetch(addr);
-endinstr;
-
 instr(0x5f,4);
    e=a;
 endinstr;
 
-instr(0x60,4);
-   setxh(b);
-endinstr;
-
-instr(0x61,4);
-   setxh(c);
-endinstr;
-
-instr(0x62,4);
-   setxh(d);
-endinstr;
-
-instr(0x63,4);
-   setxh(e);
-endinstr;
-
 instr(0x64,4);
    /* ld h,h */
 endinstr;
 
-instr(0x65,4);
-   setxh(xl);
-endinstr;
-
-HLinstr(0x66,7,8);
-   h=fetch(addr);
-endinstr;
-
-instr(0x67,4);
-   setxh(a);
-endinstr;
-
-instr(0x68,4);
-   setxl(b);
-endinstr;
-
-instr(0x69,4);
-   setxl(c);
-endinstr;
-
-instr(0x6a,4);
-   setxl(d);
-endinstr;
-
-instr(0x6b,4);
-   setxl(e);
-endinstr;
-
-instr(0x6c,4);
-   setxl(xh);
-endinstr;
-
 instr(0x6d,4);
    /* ld l,l */
 endinstr;
 
-HLinstr(0x6e,7,8);
-   l=fetch(addr);
-endinstr;
-
-instr(0x6f,4);
-   setxl(a);
-endinstr;
-
-HLinstr(0x70,7,8);
-   store(addr,b);
-endinstr;
-
-HLinstr(0x71,7,8);
-   store(addr,c);
-endinstr;
-
-HLinstr(0x72,7,8);
-   store(addr,d);
-endinstr;
-
-HLinstr(0x73,7,8);
-   store(addr,e);
-endinstr;
-
-HLinstr(0x74,7,8);
-   store(addr,h);
-endinstr;
-
-HLinstr(0x75,7,8);
-   store(addr,l);
-endinstr;
-
 instr(0x76,4);
 pc--;       /* keep executing nop until int */
 endinstr;
 
-HLinstr(0x77,7,8);
-   store(addr,a);
-endinstr;
-
 instr(0x78,4);
    a=b;
 endinstr;
@@ -715,18 +481,6 @@ instr(0x7b,4);
    a=e;
 endinstr;
 
-instr(0x7c,4);
-   a=xh;
-endinstr;
-
-instr(0x7d,4);
-   a=xl;
-endinstr;
-
-HLinstr(0x7e,7,8);
-   a=fetch(addr);
-endinstr;
-
 instr(0x7f,4);
    /* ld a,a */
 endinstr;
@@ -747,18 +501,6 @@ instr(0x83,4);
    adda(e,0);
 endinstr;
 
-instr(0x84,4);
-   adda(xh,0);
-endinstr;
-
-instr(0x85,4);
-   adda(xl,0);
-endinstr;
-
-HLinstr(0x86,7,8);
-   adda(fetch(addr),0);
-endinstr;
-
 instr(0x87,4);
    adda(a,0);
 endinstr;
@@ -779,18 +521,6 @@ instr(0x8b,4);
    adda(e,cy);
 endinstr;
 
-instr(0x8c,4);
-   adda(xh,cy);
-endinstr;
-
-instr(0x8d,4);
-   adda(xl,cy);
-endinstr;
-
-HLinstr(0x8e,7,8);
-   adda(fetch(addr),cy);
-endinstr;
-
 instr(0x8f,4);
    adda(a,cy);
 endinstr;
@@ -811,18 +541,6 @@ instr(0x93,4);
    suba(e,0);
 endinstr;
 
-instr(0x94,4);
-   suba(xh,0);
-endinstr;
-
-instr(0x95,4);
-   suba(xl,0);
-endinstr;
-
-HLinstr(0x96,7,8);
-   suba(fetch(addr),0);
-endinstr;
-
 instr(0x97,4);
    suba(a,0);
 endinstr;
@@ -843,18 +561,6 @@ instr(0x9b,4);
    suba(e,cy);
 endinstr;
 
-instr(0x9c,4);
-   suba(xh,cy);
-endinstr;
-
-instr(0x9d,4);
-   suba(xl,cy);
-endinstr;
-
-HLinstr(0x9e,7,8);
-   suba(fetch(addr),cy);
-endinstr;
-
 instr(0x9f,4);
    suba(a,cy);
 endinstr;
@@ -875,18 +581,6 @@ instr(0xa3,4);
    anda(e);
 endinstr;
 
-instr(0xa4,4);
-   anda(xh);
-endinstr;
-
-instr(0xa5,4);
-   anda(xl);
-endinstr;
-
-HLinstr(0xa6,7,8);
-   anda(fetch(addr));
-endinstr;
-
 instr(0xa7,4);
    anda(a);
 endinstr;
@@ -907,18 +601,6 @@ instr(0xab,4);
    xora(e);
 endinstr;
 
-instr(0xac,4);
-   xora(xh);
-endinstr;
-
-instr(0xad,4);
-   xora(xl);
-endinstr;
-
-HLinstr(0xae,7,8);
-   xora(fetch(addr));
-endinstr;
-
 instr(0xaf,4);
    xora(a);
 endinstr;
@@ -939,18 +621,6 @@ instr(0xb3,4);
    ora(e);
 endinstr;
 
-instr(0xb4,4);
-   ora(xh);
-endinstr;
-
-instr(0xb5,4);
-   ora(xl);
-endinstr;
-
-HLinstr(0xb6,7,8);
-   ora(fetch(addr));
-endinstr;
-
 instr(0xb7,4);
    ora(a);
 endinstr;
@@ -971,24 +641,12 @@ instr(0xbb,4);
    cpa(e);
 endinstr;
 
-instr(0xbc,4);
-   cpa(xh);
-endinstr;
-
-instr(0xbd,4);
-   cpa(xl);
-endinstr;
-
-HLinstr(0xbe,7,8);
-   cpa(fetch(addr));
-endinstr;
-
 instr(0xbf,4);
    cpa(a);
 endinstr;
 
 instr(0xc0,5);
-   if(!(f&0x40))ret;
+   if(!(getf()&0x40))ret;
 endinstr;
 
 instr(0xc1,10);
@@ -996,16 +654,16 @@ instr(0xc1,10);
 endinstr;
 
 instr(0xc2,10);
-   if(!(f&0x40))jp;
+   if(!(getf()&0x40))jploop;
    else pc+=2;
 endinstr;
 
 instr(0xc3,10);
-   jp;
+   jploop;
 endinstr;
 
 instr(0xc4,10);
-   if(!(f&0x40))call;
+   if(!(getf()&0x40))call;
    else pc+=2;
 endinstr;
 
@@ -1024,25 +682,21 @@ instr(0xc7,11);
 endinstr;
 
 instr(0xc8,5);
-   if(f&0x40)ret;
+   if(getf()&0x40)ret;
 endinstr;
 
 instr(0xc9,4);
    ret;
+   romcheck;
 endinstr;
 
 instr(0xca,10);
-   if(f&0x40)jp;
+   if(getf()&0x40)jploop;
    else pc+=2;
 endinstr;
 
-instr(0xcb,4);
-   m1cycles++;
-#include "cbops.h"
-endinstr;
-
 instr(0xcc,10);
-   if(f&0x40)call;
+   if(getf()&0x40)call;
    else pc+=2;
 endinstr;
 
@@ -1067,12 +721,12 @@ endinstr;
 instr(0xd1,10);
    pop1(d,e);
 #if (defined LOAD_AND_SAVE)
-   if (((pc == LOAD_START_4K) || (pc == SAVE_START_4K)) && rom4k) loadAndSaveROM();
+   if (((pc == LOAD_START_4K) || (pc == SAVE_START_4K)) && rom_traps && rom4k) loadAndSaveROM();
 #endif
 endinstr;
 
 instr(0xd2,10);
-   if(!cy)jp;
+   if(!cy)jploop;
    else pc+=2;
 endinstr;
 
@@ -1114,7 +768,7 @@ instr(0xd9,4);
 endinstr;
 
 instr(0xda,10);
-   if(cy)jp;
+   if(cy)jploop;
    else pc+=2;
 endinstr;
 
@@ -1148,55 +802,19 @@ instr(0xdf,11);
 endinstr;
 
 instr(0xe0,5);
-   if(!(f&4))ret;
-endinstr;
-
-instr(0xe1,10);
-   if(!ixoriy)
-   {pop1(h,l);
-#if (defined LOAD_AND_SAVE)
-   if ((pc == LOAD_SAVE_RET_4K) && rom4k) loadAndSaveROM();
-#endif
-   }
-   else if(ixoriy==1)pop2(ix);
-   else pop2(iy);
+   if(!(getf()&4))ret;
 endinstr;
 
 instr(0xe2,10);
-   if(!(f&4))jp;
+   if(!(getf()&4))jploop;
    else pc+=2;
 endinstr;
 
-instr(0xe3,19);
-   if(!ixoriy){
-      unsigned short t=fetch2(sp);
-      store2b(sp,h,l);
-      l=t;
-      h=t>>8;
-   }
-   else if(ixoriy==1){
-      unsigned short t=fetch2(sp);
-      store2(sp,ix);
-      ix=t;
-   }
-   else{
-      unsigned short t=fetch2(sp);
-      store2(sp,iy);
-      iy=t;
-   }
-endinstr;
-
 instr(0xe4,10);
-   if(!(f&4))call;
+   if(!(getf()&4))call;
    else pc+=2;
 endinstr;
 
-instr(0xe5,11);
-   if(!ixoriy)push1(h,l);
-   else if(ixoriy==1)push2(ix);
-   else push2(iy);
-endinstr;
-
 instr(0xe6,7);
    anda(fetch(pc));
    pc++;
@@ -1208,15 +826,11 @@ instr(0xe7,11);
 endinstr;
 
 instr(0xe8,5);
-   if(f&4)ret;
-endinstr;
-
-instr(0xe9,4);
-   pc=!ixoriy?hl:ixoriy==1?ix:iy;
+   if(getf()&4)ret;
 endinstr;
 
 instr(0xea,10);
-   if(f&4)jp;
+   if(getf()&4)jploop;
    else pc+=2;
 endinstr;
 
@@ -1226,7 +840,7 @@ instr(0xeb,4);
 endinstr;
 
 instr(0xec,10);
-   if(f&4)call;
+   if(getf()&4)call;
    else pc+=2;
 endinstr;
 
@@ -1246,15 +860,16 @@ instr(0xef,11);
 endinstr;
 
 instr(0xf0,5);
-   if(!(f&0x80))ret;
+   if(!(getf()&0x80))ret;
 endinstr;
 
 instr(0xf1,10);
    pop1(a,f);
+   lazyf=LAZY_NONE;
 endinstr;
 
 instr(0xf2,10);
-   if(!(f&0x80))jp;
+   if(!(getf()&0x80))jploop;
    else pc+=2;
 endinstr;
 
@@ -1264,12 +879,12 @@ instr(0xf3,4);
 endinstr;
 
 instr(0xf4,10);
-   if(!(f&0x80))call;
+   if(!(getf()&0x80))call;
    else pc+=2;
 endinstr;
 
 instr(0xf5,11);
-   push1(a,f);
+   push1(a,getf());
 endinstr;
 
 instr(0xf6,7);
@@ -1283,15 +898,11 @@ instr(0xf7,11);
 endinstr;
 
 instr(0xf8,5);
-   if(f&0x80)ret;
-endinstr;
-
-instr(0xf9,6);
-   sp=!ixoriy?hl:ixoriy==1?ix:iy;
+   if(getf()&0x80)ret;
 endinstr;
 
 instr(0xfa,10);
-   if(f&0x80)jp;
+   if(getf()&0x80)jploop;
    else pc+=2;
 endinstr;
 
@@ -1301,7 +912,7 @@ instr(0xfb,4);
 endinstr;
 
 instr(0xfc,10);
-   if(f&0x80)call;
+   if(getf()&0x80)call;
    else pc+=2;
 endinstr;
 
@@ -1320,4 +931,5 @@ instr(0xff,11);
    pc=56;
 endinstr;
 
-
+#define Z80_XMODE 0
+#include "xyops.h"
@@ -28,26 +28,28 @@ bool parseNumber(const char* input,
 #define ERROR_INV2() mem[16384] = 129;
 #define ERROR_INV3() mem[16384] = 130;
 
-byte mem[MEMORYRAM_SIZE];
-unsigned char *memptr[64];
-int memattr[64];
-int ramsize=16;
+MACHINE_STATE byte mem[MEMORYRAM_SIZE];
+MACHINE_STATE unsigned char *memptr[64];
+MACHINE_STATE unsigned char *memfetch[64];
+MACHINE_STATE unsigned char memdisplay[64];
+MACHINE_STATE unsigned char memwrite[64];
+MACHINE_STATE int ramsize=16;
 
 /* the keyboard state and other */
-static uint8_t keyboard[8] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
-int zx80=0;
-int rom4k=0;
-int autoload=1;
-int chromamode=0;
+static MACHINE_STATE uint8_t keyboard[8] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+MACHINE_STATE int zx80=0;
+MACHINE_STATE int rom4k=0;
+MACHINE_STATE int autoload=1;
+MACHINE_STATE int chromamode=0;
 #ifdef SUPPORT_CHROMA
-unsigned char bordercolour=0x0f;
-unsigned char bordercolournew=0x0f;
-unsigned char fullcolour=0xff;
-unsigned char chroma_set=0;
+MACHINE_STATE unsigned char bordercolour=0x0f;
+MACHINE_STATE unsigned char bordercolournew=0x0f;
+MACHINE_STATE unsigned char fullcolour=0xff;
+MACHINE_STATE unsigned char chroma_set=0;
 #endif
 
-static bool resetRequired = false;
-static bool load_snap = false;
+static MACHINE_STATE bool resetRequired = false;
+static MACHINE_STATE bool load_snap = false;
 
 /* the ZX81 char is used to index into this, to give the ascii.
  * awkward chars are mapped to '_' (underscore), and the ZX81's
@@ -65,12 +67,18 @@ static char zx2ascii[64]={
 /* 60-63 */ 'w', 'x', 'y', 'z'
 };
 
-static char tapename[64]={0};
+static MACHINE_STATE char tapename[64]={0};
 
 static void set_mem_attribute_and_ptr(void);
 
 unsigned int __not_in_flash_func(in)(int h, int l)
 {
+  spin_break++;
+#ifdef Z80_BREAK
+  if (break_io & BREAK_IN)
+    z80_breakPort(l, BREAK_IN);
+#endif
+
   if ((h == 0x7f) && (l == 0xef))
   {
 #ifdef SUPPORT_CHROMA
@@ -144,6 +152,12 @@ unsigned int __not_in_flash_func(in)(int h, int l)
 
 void __not_in_flash_func(out)(int h, int l, int a)
 {
+  spin_break++;
+#ifdef Z80_BREAK
+  if (break_io & BREAK_OUT)
+    z80_breakPort(l, BREAK_OUT);
+#endif
+
   if ((sound_type == SOUND_TYPE_VSYNC) || ((sound_type == SOUND_TYPE_CHROMA) && frameNotSync))
     sound_beeper(1);
 
@@ -168,6 +182,7 @@ void __not_in_flash_func(out)(int h, int l, int a)
         {
           adjustChroma(true);
           bordercolournew = a & 0x0f;
+          execConfigChanged();
         }
       }
       else
@@ -218,7 +233,7 @@ void __not_in_flash_func(out)(int h, int l, int a)
   }
 }
 
-static char fname[256];
+static MACHINE_STATE char fname[256];
 
 char* z8x_getFilenameDirectory(void)
 {
@@ -649,11 +664,69 @@ bool save_p(int name_addr, bool defer_rom)
 }
 
 #ifdef LOAD_AND_SAVE
-RomPatches_T rom_patches;
+MACHINE_STATE RomPatches_T rom_patches;
+#endif
+
+#ifdef CALC_HLE
+MACHINE_STATE bool calc_native = false;
+
+/* The native calculator follows the ZX81 ROM instruction by instruction,
+ * so is only used when the calculator and TEST-ROOM match it (not the
+ * ZX81X2 ROM) */
+static bool calcROMMatches(void)
+{
+  return !memcmp(mem + 0x0028, zx81rom + 0x0028, 0x0030 - 0x0028) &&
+         !memcmp(mem + 0x0ec5, zx81rom + 0x0ec5, 0x0ed8 - 0x0ec5) &&
+         !memcmp(mem + 0x16d8, zx81rom + 0x16d8, 0x1c37 - 0x16d8);
+}
+#endif
+
+#ifdef ROM_HLE
+MACHINE_STATE RomHLE_T rom_hle[ROM_HLE_ROUTINES] =
+{
+  //  start   ROM followed                          name
+  { 0x07bd, {{0x07bd, 0x07dc}, {0x0000, 0x0000}}, "DECODE" },
+  { 0x099e, {{0x099e, 0x09d8}, {0x0ec5, 0x0ed8}}, "MAKE-ROOM" },
+  { 0x09d8, {{0x09d8, 0x0a1f}, {0x0000, 0x0000}}, "LINE-ADDR" },
+  { 0x0a2a, {{0x07f5, 0x0851}, {0x0918, 0x0a73}}, "CLS" },
+  { 0x0a5d, {{0x09ad, 0x09d8}, {0x0a17, 0x0a73}}, "RECLAIM-1" },
+  { 0x0a60, {{0x09ad, 0x09d8}, {0x0a60, 0x0a73}}, "RECLAIM-2" },
+};
+
+MACHINE_STATE unsigned char rom_hle_map[0x2000 >> 3];
+
+/* The native routines follow the ZX81 ROM instruction by instruction, so
+ * each is only used when the ROM code it follows matches */
+static void romHLEPatches(bool zx81)
+{
+  memset(rom_hle_map, 0, sizeof(rom_hle_map));
+
+  for (int i = 0; i < ROM_HLE_ROUTINES; i++)
+  {
+    RomHLE_T* routine = &rom_hle[i];
+
+    routine->enabled = zx81 && ((ROM_HLE_MASK >> i) & 1);
+    for (int n = 0; n < 2; n++)
+    {
+      uint16_t from = routine->code[n][0];
+
+      if (memcmp(mem + from, zx81rom + from, routine->code[n][1] - from))
+        routine->enabled = false;
+    }
+    if (routine->enabled)
+      rom_hle_map[routine->start >> 3] |= 1 << (routine->start & 7);
+  }
+}
 #endif
 
 void rom8kPatches()
 {
+#ifdef CALC_HLE
+  calc_native = calcROMMatches();
+#endif
+#ifdef ROM_HLE
+  romHLEPatches(true);
+#endif
 #ifdef LOAD_AND_SAVE
   rom_patches.save.start = SAVE_START_8K;
   rom_patches.save.use_rom = emu_saveUsingROMRequested();
@@ -675,6 +748,12 @@ void rom8kPatches()
 
 void rom4kPatches()
 {
+#ifdef CALC_HLE
+  calc_native = false;
+#endif
+#ifdef ROM_HLE
+  romHLEPatches(false);
+#endif
 #ifdef LOAD_AND_SAVE
   rom_patches.save.start = SAVE_START_4K;
   rom_patches.save.use_rom = emu_saveUsingROMRequested();
@@ -693,6 +772,62 @@ void rom4kPatches()
 #endif
 }
 
+/* Write to a page with side effects */
+void __not_in_flash_func(storeSpecial)(unsigned short x, unsigned char y)
+{
+  switch (memwrite[x >> 10])
+  {
+    case MEMWRITE_QS:
+      // QuickSilva sound registers, the page is also RAM
+      if (x == 0x7fff)
+        ay_reg = (y & 0x0F);
+      else if (x == 0x7ffe)
+        sound_ay_write(ay_reg, y);
+      memptr[x >> 10][x & 0x3FF] = y;
+    break;
+
+    case MEMWRITE_UDG:
+      // QS character board, 0x8400 to 0x87ff
+      mem[x] = y;
+      UDGEnabled = true;
+    break;
+
+    case MEMWRITE_WATCH:
+      memptr[x >> 10][x & 0x3FF] = y;
+    break;
+  }
+}
+
+/* 16 bit write to a page with side effects. As before, only the RAM is
+ * changed */
+void __not_in_flash_func(store2Special)(unsigned short x, unsigned char hi, unsigned char lo)
+{
+  unsigned char page = x >> 10;
+
+  if ((memwrite[page] == MEMWRITE_QS) || (memwrite[page] == MEMWRITE_WATCH) ||
+      ((memwrite[page] == MEMWRITE_UDG) && (ramsize >= 32)))
+  {
+    memptr[page][x & 0x3FF] = lo;
+    memptr[page][(x & 0x3FF) + 1] = hi;
+  }
+}
+
+/* The QuickSilva sound registers are in the top page of the 16K RAM, so
+ * that page only has the sound handler when QuickSilva is selected. Call
+ * whenever sound_type changes */
+void setSoundPageHandler(void)
+{
+  unsigned char page = 0x7fff >> 10;
+  unsigned char type = (sound_type == SOUND_TYPE_QUICKSILVA) ? MEMWRITE_QS : MEMWRITE_RAM;
+
+  // A RAM page may be being watched by the idle loop detector
+  if ((memwrite[page] != type) && !((type == MEMWRITE_RAM) && (memwrite[page] == MEMWRITE_WATCH)))
+  {
+    memwrite[page] = type;
+    spin_break++;
+  }
+}
+
 static void initmem(void)
 {
   if(rom4k)
@@ -716,7 +851,7 @@ static void set_mem_attribute_and_ptr(void)
   /* ROM setup */
   for(f=0;f<16;f++)
   {
-    memattr[f]=memattr[32+f]=0;
+    memwrite[f]=memwrite[32+f]=MEMWRITE_ROM;
     memptr[f]=memptr[32+f]=mem+1024*count;
     count++;
     if(count>=(rom4k?4:8)) count=0;
@@ -732,7 +867,7 @@ static void set_mem_attribute_and_ptr(void)
   count=0;
   for(f=16;f<32;f++)
   {
-    memattr[f]=memattr[32+f]=1;
+    memwrite[f]=memwrite[32+f]=MEMWRITE_RAM;
     memptr[f]=memptr[32+f]=mem+1024*(16+((odd && count==3)?2:count));
     count++;
     if(count>=ramtmp) count=0;
@@ -786,14 +921,14 @@ static void set_mem_attribute_and_ptr(void)
     case 48:
       for(f=48;f<64;f++)
       {
-        memattr[f]=1;
+        memwrite[f]=MEMWRITE_RAM;
         memptr[f]=mem+1024*f;
       }
       // fall through
     case 32:
       for(f=32;f<48;f++)
       {
-        memattr[f]=1;
+        memwrite[f]=MEMWRITE_RAM;
         memptr[f]=mem+1024*f;
       }
       break;
@@ -803,11 +938,29 @@ static void set_mem_attribute_and_ptr(void)
   {
       for(f=8;f<16;f++)
       {
-        memattr[f]=1;         /* It's now writable */
+        memwrite[f]=MEMWRITE_RAM;   /* It's now writable */
         memptr[f]=mem+1024*f;
       }
   }
 
+  /* Instruction fetches from 0xC000 and above see the memory at 0x4000.
+   * Bytes fetched from above 0x8000 (0xC000 with M1NOT) with bit 6 clear
+   * are sent to the display */
+  for(f=0;f<64;f++)
+  {
+    memfetch[f]=(f<48) ? memptr[f] : memptr[f-32];
+    memdisplay[f]=(f>=32) && (!m1not || (f>=48));
+  }
+
+  /* Pages with write side effects. The table is rebuilt, so RAM watched
+   * by the idle loop detector is no longer watched */
+  spin_break++;
+  setSoundPageHandler();
+  if (useQSUDG)
+  {
+    memwrite[0x8400 >> 10] = MEMWRITE_UDG;
+  }
+
   if(rom4k)
     rom4kPatches();
   else
@@ -841,6 +994,7 @@ void z8x_Init(void)
   UDGEnabled = false;
 
   setEmulatedTV(!useNTSC, emu_VTol());
+  setTurbo(emu_TurboRequested());
   setDisplayBoundaries();
   emu_KeyboardInitialise(keyboard);
   emu_JoystickInitialiseNinePin();
@@ -884,12 +1038,14 @@ void z8x_Init(void)
 void z8x_updateValues(void)
 {
   sound_type = emu_SoundRequested();
+  setSoundPageHandler();
   emu_sndInit(sound_type != SOUND_TYPE_NONE, false);
 
   useWRX = emu_WRXRequested();
   useNTSC = emu_NTSCRequested();
   frameSync = (emu_FrameSyncRequested() != SYNC_OFF);
   setEmulatedTV(!useNTSC, emu_VTol());
+  setTurbo(emu_TurboRequested());
   setDisplayBoundaries();
   emu_VideoSetInterlace();
 }
@@ -898,12 +1054,27 @@ bool z8x_Step(void)
 {
   zx80 ? execZX80() : execZX81();
 
+#ifdef Z80_TRACE
+  if (z80_traceFrozen())
+  {
+    z80_traceDump();
+  }
+#endif
+
   if (resetRequired)
   {
     resetRequired = false;
     return false;
   }
 
+#ifdef Z80_BREAK
+  // The sound of a frame is generated when it completes
+  if (z80_breakStopped(NULL))
+  {
+    return true;
+  }
+#endif
+
   if (sound_type != SOUND_TYPE_NONE)
   {
     emu_sndGenerateSamples();
@@ -999,7 +1170,7 @@ char *strzx80_to_ascii(int memaddr)
 {
   static unsigned char zx81table[16] = {'_', '$', ':', '?', '(', ')',
     '-', '+', '*', '/', '=', '>', '<', ';', ',', '.'};
-  static char translated[256];
+  static MACHINE_STATE char translated[256];
   unsigned char sinchar;
   char asciichar;
   int index = 0;
@@ -1036,7 +1207,7 @@ char *strzx80_to_ascii(int memaddr)
 bool save_snap_zx8x(void)
 {
   if (!emu_FileWriteBytes(mem, sizeof(byte) * MEMORYRAM_SIZE)) return false;
-  // memptr and memattr recreated when loaded
+  // memptr and memwrite recreated when loaded
 
   if (!emu_FileWriteBytes(keyboard, sizeof(uint8_t) * 8)) return false;
   if (!emu_FileWriteBytes(&ramsize, sizeof(ramsize))) return false;
@@ -1063,7 +1234,7 @@ bool load_snap_zx8x(uint32_t version)
   (void) version;
 
   if (!emu_FileReadBytes(mem, sizeof(byte) * MEMORYRAM_SIZE)) return false;
-  // memptr and memattr recreated when loaded
+  // memptr and memwrite recreated when loaded
 
   if (!emu_FileReadBytes(keyboard, sizeof(uint8_t) * 8)) return false;
   if (!emu_FileReadBytes(&ramsize, sizeof(ramsize))) return false;